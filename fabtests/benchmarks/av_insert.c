@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures the startup cost of populating an address vector.  A large
+ * set of synthetic IPv4 addresses is inserted, optionally in batches,
+ * and then every address is read back with fi_av_lookup.  No data is
+ * transferred, so the addresses do not need to be reachable.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+#define AV_PORT_BASE	1024
+#define AV_PORT_CNT	60000
+
+static size_t addr_cnt = 1000000;
+static size_t batch;
+static int presize = 1;
+
+static struct sockaddr_in *addrs;
+static fi_addr_t *fi_addrs;
+
+static void init_addrs(void)
+{
+	size_t i;
+
+	for (i = 0; i < addr_cnt; i++) {
+		addrs[i].sin_family = AF_INET;
+		addrs[i].sin_port = htons(AV_PORT_BASE + i % AV_PORT_CNT);
+		addrs[i].sin_addr.s_addr =
+			htonl(0x0a000001 + (uint32_t) (i / AV_PORT_CNT));
+	}
+}
+
+static int insert_addrs(void)
+{
+	size_t i, cnt;
+	int ret;
+
+	for (i = 0; i < addr_cnt; i += cnt) {
+		cnt = MIN(addr_cnt - i, batch);
+		ret = fi_av_insert(av, &addrs[i], cnt, &fi_addrs[i], 0, NULL);
+		if (ret != (int) cnt) {
+			FT_PRINTERR("fi_av_insert", ret);
+			return ret < 0 ? ret : -FI_EOTHER;
+		}
+	}
+	return 0;
+}
+
+static int lookup_addrs(void)
+{
+	struct sockaddr_in addr;
+	size_t i, len;
+	int ret;
+
+	for (i = 0; i < addr_cnt; i++) {
+		len = sizeof(addr);
+		ret = fi_av_lookup(av, fi_addrs[i], &addr, &len);
+		if (ret) {
+			FT_PRINTERR("fi_av_lookup", ret);
+			return ret;
+		}
+
+		if (addr.sin_port != addrs[i].sin_port ||
+		    addr.sin_addr.s_addr != addrs[i].sin_addr.s_addr) {
+			FT_ERR("address mismatch at fi_addr %" PRIu64,
+			       fi_addrs[i]);
+			return -FI_EOTHER;
+		}
+	}
+	return 0;
+}
+
+static void show_rate(const char *name)
+{
+	int64_t usec;
+
+	usec = get_elapsed(&start, &end, MICRO);
+	printf("%-10s %10zu %10zu %10.3f %12.0f\n", name, addr_cnt, batch,
+	       usec / 1000000.0, usec ? addr_cnt * 1000000.0 / usec : 0.0);
+}
+
+static int run(void)
+{
+	int ret;
+
+	addrs = calloc(addr_cnt, sizeof(*addrs));
+	fi_addrs = calloc(addr_cnt, sizeof(*fi_addrs));
+	if (!addrs || !fi_addrs)
+		return -FI_ENOMEM;
+
+	init_addrs();
+
+	av_attr.type = FI_AV_TABLE;
+	av_attr.count = presize ? addr_cnt : 0;
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	printf("%-10s %10s %10s %10s %12s\n", "op", "addresses", "batch",
+	       "time (s)", "addr/s");
+
+	ft_start();
+	ret = insert_addrs();
+	ft_stop();
+	if (ret)
+		return ret;
+	show_rate("insert");
+
+	ft_start();
+	ret = lookup_addrs();
+	ft_stop();
+	if (ret)
+		return ret;
+	show_rate("lookup");
+	return 0;
+}
+
+static void usage(char *name)
+{
+	ft_usage(name, "Address vector insertion benchmark.");
+	FT_PRINT_OPTS_USAGE("-N <count>", "number of addresses "
+			    "(default 1000000)");
+	FT_PRINT_OPTS_USAGE("-W <batch>", "addresses per fi_av_insert call "
+			    "(default all)");
+	FT_PRINT_OPTS_USAGE("-U", "open the AV without a count hint");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hN:W:U" INFO_OPTS)) != -1) {
+		switch (op) {
+		case 'N':
+			addr_cnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			batch = strtoul(optarg, NULL, 0);
+			break;
+		case 'U':
+			presize = 0;
+			break;
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!addr_cnt) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (!batch || batch > addr_cnt)
+		batch = addr_cnt;
+
+	if (!hints->ep_attr->type)
+		hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode = ~0;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = FI_SOCKADDR_IN;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		goto out;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	ret = run();
+out:
+	free(addrs);
+	free(fi_addrs);
+	ft_free_res();
+	return ft_exit_code(ret);
+}
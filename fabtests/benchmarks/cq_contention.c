@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures completion queue throughput when several threads write and
+ * read the same CQ.  Each thread owns an endpoint that sends zero byte
+ * messages to itself, but completions are read by whichever thread gets
+ * to them first.  Run with FI_CQ_LOCKLESS=0 and 1 to compare the two
+ * utility CQ implementations.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include <rdma/fi_cm.h>
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+#define CQ_READ_BATCH 16
+
+struct cq_thread {
+	pthread_t	thread;
+	struct fid_ep	*ep;
+	fi_addr_t	addr;
+	size_t		posted;
+	size_t		done;
+	int		ret;
+};
+
+static struct cq_thread *threads;
+static int thread_cnt = 4;
+static size_t window = 64;
+static size_t iterations = 100000;
+
+static int post_pair(struct cq_thread *t)
+{
+	int ret;
+
+	ret = fi_recv(t->ep, NULL, 0, NULL, FI_ADDR_UNSPEC, t);
+	if (ret)
+		return ret;
+
+	do {
+		ret = fi_send(t->ep, NULL, 0, NULL, t->addr, t);
+		if (ret == -FI_EAGAIN)
+			(void) fi_cq_read(txcq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+	return ret;
+}
+
+static void *run_thread(void *arg)
+{
+	struct fi_cq_entry comp[CQ_READ_BATCH];
+	struct cq_thread *t = arg, *owner;
+	ssize_t cnt, i;
+	int ret;
+
+	while (__atomic_load_n(&t->done, __ATOMIC_ACQUIRE) < iterations * 2) {
+		while (t->posted < iterations &&
+		       t->posted * 2 - __atomic_load_n(&t->done,
+				__ATOMIC_RELAXED) < window * 2) {
+			ret = post_pair(t);
+			if (ret == -FI_EAGAIN)
+				break;
+			if (ret) {
+				FT_PRINTERR("post", ret);
+				t->ret = ret;
+				return NULL;
+			}
+			t->posted++;
+		}
+
+		cnt = fi_cq_read(txcq, comp, CQ_READ_BATCH);
+		if (cnt == -FI_EAGAIN)
+			continue;
+		if (cnt < 0) {
+			if (cnt == -FI_EAVAIL)
+				cnt = ft_cq_readerr(txcq);
+			FT_PRINTERR("fi_cq_read", cnt);
+			t->ret = (int) cnt;
+			return NULL;
+		}
+
+		for (i = 0; i < cnt; i++) {
+			owner = comp[i].op_context;
+			__atomic_add_fetch(&owner->done, 1, __ATOMIC_RELEASE);
+		}
+	}
+	return NULL;
+}
+
+static int init_threads(void)
+{
+	char name[FT_MAX_CTRL_MSG];
+	size_t len;
+	int i, ret;
+
+	threads = calloc(thread_cnt, sizeof(*threads));
+	if (!threads)
+		return -FI_ENOMEM;
+
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.wait_obj = FI_WAIT_NONE;
+	cq_attr.size = window * 2 * thread_cnt;
+	ret = fi_cq_open(domain, &cq_attr, &txcq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		return ret;
+	}
+
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		ret = fi_endpoint(domain, fi, &threads[i].ep, NULL);
+		if (ret) {
+			FT_PRINTERR("fi_endpoint", ret);
+			return ret;
+		}
+
+		ret = fi_ep_bind(threads[i].ep, &txcq->fid,
+				 FI_TRANSMIT | FI_RECV);
+		if (ret) {
+			FT_PRINTERR("fi_ep_bind", ret);
+			return ret;
+		}
+
+		ret = fi_ep_bind(threads[i].ep, &av->fid, 0);
+		if (ret) {
+			FT_PRINTERR("fi_ep_bind", ret);
+			return ret;
+		}
+
+		ret = fi_enable(threads[i].ep);
+		if (ret) {
+			FT_PRINTERR("fi_enable", ret);
+			return ret;
+		}
+
+		len = sizeof(name);
+		ret = fi_getname(&threads[i].ep->fid, name, &len);
+		if (ret) {
+			FT_PRINTERR("fi_getname", ret);
+			return ret;
+		}
+
+		ret = fi_av_insert(av, name, 1, &threads[i].addr, 0, NULL);
+		if (ret != 1) {
+			FT_PRINTERR("fi_av_insert", ret);
+			return ret ? ret : -FI_EINVAL;
+		}
+	}
+	return 0;
+}
+
+static void free_threads(void)
+{
+	int i;
+
+	if (!threads)
+		return;
+
+	for (i = 0; i < thread_cnt; i++)
+		FT_CLOSE_FID(threads[i].ep);
+	free(threads);
+}
+
+static int run(void)
+{
+	int i, ret;
+
+	ret = init_threads();
+	if (ret)
+		return ret;
+
+	ft_start();
+	for (i = 0; i < thread_cnt; i++) {
+		ret = pthread_create(&threads[i].thread, NULL, run_thread,
+				     &threads[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", -ret);
+			return -ret;
+		}
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		pthread_join(threads[i].thread, NULL);
+		if (threads[i].ret)
+			ret = threads[i].ret;
+	}
+	ft_stop();
+
+	if (!ret)
+		show_perf(NULL, 0, (int) iterations * thread_cnt, &start, &end,
+			  2);
+	return ret;
+}
+
+static void usage(char *name)
+{
+	ft_usage(name, "Completion queue contention benchmark.");
+	FT_PRINT_OPTS_USAGE("-T <threads>", "number of threads (default 4)");
+	FT_PRINT_OPTS_USAGE("-I <number>", "messages per thread "
+			    "(default 100000)");
+	FT_PRINT_OPTS_USAGE("-W <window>", "messages outstanding per "
+			    "thread (default 64)");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hT:I:W:" INFO_OPTS)) != -1) {
+		switch (op) {
+		case 'T':
+			thread_cnt = atoi(optarg);
+			break;
+		case 'I':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			window = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (thread_cnt <= 0 || !iterations || !window) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode = 0;
+	hints->domain_attr->mr_mode = opts.mr_mode & ~FI_MR_LOCAL;
+	hints->domain_attr->threading = FI_THREAD_SAFE;
+	hints->addr_format = opts.address_format;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		goto out;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	ret = run();
+out:
+	free_threads();
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures the cost of waiting for completions.  The client sends a
+ * message and blocks until the reply arrives.  The server computes for
+ * a fixed think time before replying, so the client spends most of each
+ * round trip waiting.  Both sides report the average round trip beyond
+ * the think time and the share of a CPU the process consumed.  Compare
+ * completion methods with -c, or the provider's spin budget, to trade
+ * latency against CPU time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+static uint64_t think_us = 100;
+
+static uint64_t cpu_time_us(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec +
+	       usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
+}
+
+static void think(void)
+{
+	uint64_t end = ft_gettime_us() + think_us;
+
+	while (ft_gettime_us() < end)
+		;
+}
+
+static int run(void)
+{
+	uint64_t cpu_start = 0, cpu_end;
+	int64_t usec;
+	int i, ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (i == opts.warmup_iterations) {
+			ft_start();
+			cpu_start = cpu_time_us();
+		}
+
+		if (opts.dst_addr) {
+			ret = ft_tx(ep, remote_fi_addr, opts.transfer_size,
+				    &tx_ctx);
+			if (ret)
+				return ret;
+
+			ret = ft_rx(ep, opts.transfer_size);
+			if (ret)
+				return ret;
+		} else {
+			ret = ft_rx(ep, opts.transfer_size);
+			if (ret)
+				return ret;
+
+			think();
+			ret = ft_tx(ep, remote_fi_addr, opts.transfer_size,
+				    &tx_ctx);
+			if (ret)
+				return ret;
+		}
+	}
+	ft_stop();
+	cpu_end = cpu_time_us();
+
+	usec = get_elapsed(&start, &end, MICRO);
+	printf("%-8s %10s %10s %12s %8s\n", "side", "think (us)", "iters",
+	       "latency (us)", "cpu (%)");
+	printf("%-8s %10" PRIu64 " %10d %12.2f %8.1f\n",
+	       opts.dst_addr ? "client" : "server", think_us, opts.iterations,
+	       (double) usec / opts.iterations - think_us,
+	       usec ? (cpu_end - cpu_start) * 100.0 / usec : 0.0);
+
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_SIZE;
+	opts.transfer_size = 64;
+	opts.iterations = 10000;
+	opts.comp_method = FT_COMP_SREAD;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hT:" CS_OPTS INFO_OPTS)) != -1) {
+		switch (op) {
+		case 'T':
+			think_us = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Completion wait latency and CPU "
+				   "usage benchmark.");
+			FT_PRINT_OPTS_USAGE("-T <usec>", "server think time "
+					    "per message (default 100)");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode |= FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Measures how much computation overlaps with large transfers.  The
+ * client sends one large message at a time and the server acknowledges
+ * each one.  While waiting, both sides poll their CQs without blocking
+ * and compute for a short slice between polls.  Each side reports the
+ * bandwidth and the share of the run spent computing.  Providers that
+ * copy asynchronously, e.g. shm with FI_SHM_OFFLOAD_THREADS set, return
+ * from progress sooner and leave more time to compute.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+#define ACK_SIZE	4
+
+static uint64_t slice_us = 10;
+static uint64_t compute_us;
+
+static uint64_t cpu_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Count cpu time, which excludes time the thread was preempted */
+static void compute(void)
+{
+	uint64_t start, cpu_start;
+
+	cpu_start = cpu_time_us();
+	start = ft_gettime_us();
+	while (ft_gettime_us() - start < slice_us)
+		;
+	compute_us += cpu_time_us() - cpu_start;
+}
+
+static int wait_comp(struct fid_cq *cq, uint64_t *cur, uint64_t total)
+{
+	struct fi_cq_tagged_entry comp;
+	int ret;
+
+	while (*cur < total) {
+		ret = fi_cq_read(cq, &comp, 1);
+		if (ret > 0) {
+			(*cur)++;
+		} else if (ret == -FI_EAGAIN) {
+			compute();
+		} else {
+			if (ret == -FI_EAVAIL)
+				ret = ft_cq_readerr(cq);
+			else
+				FT_PRINTERR("fi_cq_read", ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static int xfer(void)
+{
+	int ret;
+
+	if (opts.dst_addr) {
+		ret = ft_post_tx(ep, remote_fi_addr, opts.transfer_size,
+				 NO_CQ_DATA, &tx_ctx);
+		if (ret)
+			return ret;
+
+		ret = wait_comp(txcq, &tx_cq_cntr, tx_seq);
+		if (ret)
+			return ret;
+
+		ret = wait_comp(rxcq, &rx_cq_cntr, rx_seq);
+		if (ret)
+			return ret;
+	} else {
+		ret = wait_comp(rxcq, &rx_cq_cntr, rx_seq);
+		if (ret)
+			return ret;
+
+		ret = ft_post_rx(ep, rx_size, &rx_ctx);
+		if (ret)
+			return ret;
+
+		ret = ft_post_tx(ep, remote_fi_addr, ACK_SIZE, NO_CQ_DATA,
+				 &tx_ctx);
+		if (ret)
+			return ret;
+
+		return wait_comp(txcq, &tx_cq_cntr, tx_seq);
+	}
+
+	return ft_post_rx(ep, rx_size, &rx_ctx);
+}
+
+static int run(void)
+{
+	int64_t usec;
+	int i, ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (i == opts.warmup_iterations) {
+			compute_us = 0;
+			ft_start();
+		}
+
+		ret = xfer();
+		if (ret)
+			return ret;
+	}
+	ft_stop();
+
+	usec = get_elapsed(&start, &end, MICRO);
+	printf("%-8s %10s %10s %10s %12s\n", "side", "bytes", "iters",
+	       "MB/sec", "compute (%)");
+	printf("%-8s %10zu %10d %10.2f %12.1f\n",
+	       opts.dst_addr ? "client" : "server", opts.transfer_size,
+	       opts.iterations,
+	       usec ? (double) opts.transfer_size * opts.iterations / usec :
+		      0.0,
+	       usec ? compute_us * 100.0 / usec : 0.0);
+
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_SIZE;
+	opts.transfer_size = 4 * 1024 * 1024;
+	opts.iterations = 100;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hT:" CS_OPTS INFO_OPTS)) != -1) {
+		switch (op) {
+		case 'T':
+			slice_us = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Bandwidth and compute overlap "
+				   "benchmark.");
+			FT_PRINT_OPTS_USAGE("-T <usec>", "compute slice between "
+					    "CQ polls (default 10)");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode |= FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -32,10 +32,45 @@
 #include <getopt.h>
 
 #include <rdma/fi_errno.h>
+#include <rdma/fi_tagged.h>
 
 #include <shared.h>
 #include "benchmark_shared.h"
 
+static size_t prepost_cnt;
+static struct fi_context *prepost_ctx;
+
+/* Post receives that never match to measure the cost of tag matching
+ * against a deep posted receive queue.
+ */
+static int prepost_recvs(void)
+{
+	size_t i;
+	int ret;
+
+	prepost_ctx = calloc(prepost_cnt, sizeof(*prepost_ctx));
+	if (!prepost_ctx)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < prepost_cnt; i++) {
+		ret = fi_trecv(ep, NULL, 0, NULL, FI_ADDR_UNSPEC,
+			       (1ULL << 63) | i, 0, &prepost_ctx[i]);
+		if (ret) {
+			FT_PRINTERR("fi_trecv", ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static void cancel_recvs(void)
+{
+	size_t i;
+
+	for (i = 0; i < prepost_cnt; i++)
+		(void) fi_cancel(&ep->fid, &prepost_ctx[i]);
+}
+
 static int run(void)
 {
 	int i, ret = 0;
@@ -44,6 +79,12 @@ static int run(void)
 	if (ret)
 		return ret;
 
+	if (prepost_cnt) {
+		ret = prepost_recvs();
+		if (ret)
+			return ret;
+	}
+
 	if (!(opts.options & FT_OPT_SIZE)) {
 		for (i = 0; i < TEST_CNT; i++) {
 			if (!ft_use_size(i, opts.sizes_enabled))
@@ -63,6 +104,8 @@ static int run(void)
 
 	ft_finalize();
 out:
+	if (prepost_ctx)
+		cancel_recvs();
 	return ret;
 }
 
@@ -76,7 +119,7 @@ int main(int argc, char **argv)
 	if (!hints)
 		return EXIT_FAILURE;
 
-	while ((op = getopt_long(argc, argv, "Uh" CS_OPTS INFO_OPTS BENCHMARK_OPTS,
+	while ((op = getopt_long(argc, argv, "Uhq:" CS_OPTS INFO_OPTS BENCHMARK_OPTS,
 				 long_opts, &lopt_idx)) != -1) {
 		switch (op) {
 		default:
@@ -89,10 +132,15 @@ int main(int argc, char **argv)
 		case 'U':
 			hints->tx_attr->op_flags |= FI_DELIVERY_COMPLETE;
 			break;
+		case 'q':
+			prepost_cnt = strtoul(optarg, NULL, 0);
+			break;
 		case '?':
 		case 'h':
 			ft_csusage(argv[0], "Ping pong client and server using tagged messages.");
 			ft_benchmark_usage();
+			FT_PRINT_OPTS_USAGE("-q <count>", "number of non-matching "
+					    "tagged receives to pre-post");
 			ft_longopts_usage();
 			return EXIT_FAILURE;
 		}
@@ -112,5 +160,6 @@ int main(int argc, char **argv)
 	ret = run();
 
 	ft_free_res();
+	free(prepost_ctx);
 	return ft_exit_code(ret);
 }
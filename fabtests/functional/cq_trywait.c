@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks fi_trywait on a completion queue with a wait fd, using zero byte
+ * messages that an endpoint sends to itself.  fi_trywait must fail while
+ * a completion is queued, succeed once the CQ is drained, and the fd must
+ * wake up for the next completion.  FI_CQ_LOCKLESS is set unless the user
+ * set it, so utility CQs use their lock-free ring.  With -S, FI_SOURCE is
+ * requested and receive completions must report the endpoint's address.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <rdma/fi_cm.h>
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+#define TRYWAIT_TIMEOUT	5000	/* ms */
+#define TRYWAIT_RETRIES	100
+
+static struct fid_cq *cq;
+static int cq_fd = -1;
+static fi_addr_t self_addr;
+static size_t iterations = 100;
+static bool check_src;
+
+static int trywait(void)
+{
+	struct fid *fids[1] = { &cq->fid };
+
+	return fi_trywait(fabric, fids, 1);
+}
+
+/* The CQ holds nothing, so fi_trywait must succeed after a few tries */
+static int check_empty(void)
+{
+	ssize_t ret;
+	int i;
+
+	for (i = 0; i < TRYWAIT_RETRIES; i++) {
+		ret = fi_cq_read(cq, NULL, 0);
+		if (ret != -FI_EAGAIN) {
+			FT_ERR("unexpected completion on an idle CQ: %zd", ret);
+			return -FI_EOTHER;
+		}
+
+		ret = trywait();
+		if (!ret)
+			return 0;
+		if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_trywait", ret);
+			return (int) ret;
+		}
+	}
+
+	FT_ERR("fi_trywait keeps failing on an empty CQ");
+	return -FI_EOTHER;
+}
+
+static int wait_comps(int cnt)
+{
+	struct fi_cq_msg_entry comp[2];
+	fi_addr_t src[2];
+	ssize_t ret, i;
+
+	while (cnt) {
+		ret = trywait();
+		if (!ret) {
+			ret = ft_poll_fd(cq_fd, TRYWAIT_TIMEOUT);
+			if (ret == -FI_EAGAIN) {
+				FT_ERR("no wakeup for a pending completion");
+				return -FI_ETIMEDOUT;
+			}
+			if (ret)
+				return (int) ret;
+		} else if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_trywait", ret);
+			return (int) ret;
+		}
+
+		/* A read of 0 entries only reports if one is queued */
+		ret = fi_cq_read(cq, NULL, 0);
+		if (ret == -FI_EAGAIN)
+			continue;
+		if (ret) {
+			if (ret == -FI_EAVAIL)
+				ret = ft_cq_readerr(cq);
+			FT_PRINTERR("fi_cq_read", ret);
+			return (int) ret;
+		}
+
+		ret = trywait();
+		if (ret != -FI_EAGAIN) {
+			FT_ERR("fi_trywait returned %zd with a queued completion",
+			       ret);
+			return -FI_EOTHER;
+		}
+
+		ret = fi_cq_readfrom(cq, comp, cnt, src);
+		if (ret <= 0) {
+			FT_PRINTERR("fi_cq_readfrom", ret);
+			return ret ? (int) ret : -FI_EOTHER;
+		}
+
+		for (i = 0; check_src && i < ret; i++) {
+			if ((comp[i].flags & FI_RECV) && src[i] != self_addr) {
+				FT_ERR("receive source %" PRIu64 ", expected %"
+				       PRIu64, src[i], self_addr);
+				return -FI_EOTHER;
+			}
+		}
+		cnt -= (int) ret;
+	}
+	return 0;
+}
+
+static int init_ep(void)
+{
+	char name[FT_MAX_CTRL_MSG];
+	size_t len;
+	int ret;
+
+	cq_attr.format = FI_CQ_FORMAT_MSG;
+	cq_attr.wait_obj = FI_WAIT_FD;
+	cq_attr.size = 16;
+	ret = fi_cq_open(domain, &cq_attr, &cq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		return ret;
+	}
+
+	ret = fi_control(&cq->fid, FI_GETWAIT, &cq_fd);
+	if (ret) {
+		FT_PRINTERR("fi_control(FI_GETWAIT)", ret);
+		return ret;
+	}
+
+	ret = fi_av_open(domain, &av_attr, &av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	ret = fi_endpoint(domain, fi, &ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	FT_EP_BIND(ep, cq, FI_TRANSMIT | FI_RECV);
+	FT_EP_BIND(ep, av, 0);
+
+	ret = fi_enable(ep);
+	if (ret) {
+		FT_PRINTERR("fi_enable", ret);
+		return ret;
+	}
+
+	len = sizeof(name);
+	ret = fi_getname(&ep->fid, name, &len);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	ret = fi_av_insert(av, name, 1, &self_addr, 0, NULL);
+	if (ret != 1) {
+		FT_PRINTERR("fi_av_insert", ret);
+		return ret ? ret : -FI_EINVAL;
+	}
+	return 0;
+}
+
+static int run(void)
+{
+	size_t i;
+	int ret;
+
+	ret = init_ep();
+	if (ret)
+		return ret;
+
+	for (i = 0; i < iterations; i++) {
+		ret = check_empty();
+		if (ret)
+			return ret;
+
+		ret = fi_recv(ep, NULL, 0, NULL, FI_ADDR_UNSPEC, NULL);
+		if (ret) {
+			FT_PRINTERR("fi_recv", ret);
+			return ret;
+		}
+
+		do {
+			ret = fi_send(ep, NULL, 0, NULL, self_addr, NULL);
+			if (ret == -FI_EAGAIN)
+				(void) fi_cq_read(cq, NULL, 0);
+		} while (ret == -FI_EAGAIN);
+		if (ret) {
+			FT_PRINTERR("fi_send", ret);
+			return ret;
+		}
+
+		ret = wait_comps(2);
+		if (ret)
+			return ret;
+	}
+
+	return check_empty();
+}
+
+static void usage(char *name)
+{
+	ft_usage(name, "Completion queue fi_trywait test.");
+	FT_PRINT_OPTS_USAGE("-I <number>", "messages to send (default 100)");
+	FT_PRINT_OPTS_USAGE("-S", "request FI_SOURCE and check receive sources");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hI:S" INFO_OPTS)) != -1) {
+		switch (op) {
+		case 'I':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			check_src = true;
+			break;
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Must be set before the first fi_getinfo call reads it */
+	if (setenv("FI_CQ_LOCKLESS", "1", 0)) {
+		FT_PRINTERR("setenv", -errno);
+		return EXIT_FAILURE;
+	}
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	if (check_src)
+		hints->caps |= FI_SOURCE;
+	hints->mode = 0;
+	hints->domain_attr->mr_mode = opts.mr_mode & ~FI_MR_LOCAL;
+	hints->domain_attr->threading = FI_THREAD_SAFE;
+	hints->addr_format = opts.address_format;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		goto out;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	ret = run();
+out:
+	FT_CLOSE_FID(ep);
+	FT_CLOSE_FID(cq);
+	ft_free_res();
+	return ft_exit_code(ret);
+}
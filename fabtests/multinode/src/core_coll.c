@@ -450,6 +450,132 @@ out:
 	return err;
 }
 
+static const enum fi_op reduce_bw_ops[] = {
+	FI_SUM, FI_PROD, FI_MIN, FI_MAX, FI_BAND, FI_BOR, FI_BXOR,
+};
+
+static const enum fi_datatype reduce_bw_types[] = {
+	FI_INT8, FI_UINT8, FI_INT16, FI_UINT16, FI_INT32, FI_UINT32,
+	FI_INT64, FI_UINT64, FI_FLOAT, FI_DOUBLE,
+};
+
+/* Fill with ones so that products neither overflow nor underflow */
+static void reduce_bw_fill(void *buf, size_t count, enum fi_datatype datatype)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		switch (datatype) {
+		case FI_INT8:
+		case FI_UINT8:
+			((uint8_t *) buf)[i] = 1;
+			break;
+		case FI_INT16:
+		case FI_UINT16:
+			((uint16_t *) buf)[i] = 1;
+			break;
+		case FI_INT32:
+		case FI_UINT32:
+			((uint32_t *) buf)[i] = 1;
+			break;
+		case FI_INT64:
+		case FI_UINT64:
+			((uint64_t *) buf)[i] = 1;
+			break;
+		case FI_FLOAT:
+			((float *) buf)[i] = 1.0f;
+			break;
+		case FI_DOUBLE:
+			((double *) buf)[i] = 1.0;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static int reduce_bw_run_one(void *data, void *result, enum fi_op op,
+			     enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	size_t count;
+	int i, err;
+
+	count = opts.transfer_size / datatype_to_size(datatype);
+	if (!count)
+		return FI_SUCCESS;
+
+	reduce_bw_fill(data, count, datatype);
+
+	pm_barrier();
+	ft_start();
+	for (i = 0; i < opts.iterations; i++) {
+		err = fi_allreduce(ep, data, count, NULL, result, NULL,
+				   coll_addr, datatype, op, 0, &done_flag);
+		if (err) {
+			FT_PRINTERR("fi_allreduce", err);
+			return err;
+		}
+
+		err = wait_for_comp(&done_flag);
+		if (err)
+			return err;
+	}
+	ft_stop();
+
+	/* fi_tostr returns a static buffer */
+	if (pm_job.my_rank == 0) {
+		printf("%-8s ", fi_tostr(&op, FI_TYPE_ATOMIC_OP));
+		printf("%-10s %8.3f GB/s\n",
+		       fi_tostr(&datatype, FI_TYPE_ATOMIC_TYPE),
+		       (double) count * datatype_to_size(datatype) *
+		       opts.iterations / get_elapsed(&start, &end, NANO));
+	}
+	return FI_SUCCESS;
+}
+
+/*
+ * Reports allreduce bandwidth for each supported operation and datatype
+ * using -S byte buffers and -I iterations.  Large buffers make the
+ * reduction kernels the dominant cost.  Only runs with -T.
+ */
+static int all_reduce_bw_test_run(enum fi_collective_op coll_op,
+				  enum fi_op op, enum fi_datatype datatype)
+{
+	void *data, *result;
+	size_t i, j;
+	int err = FI_SUCCESS;
+
+	assert(coll_op == FI_ALLREDUCE);
+
+	if (!(opts.options & FT_OPT_PERF) || !is_my_rank_participating())
+		return FI_SUCCESS;
+
+	data = malloc(opts.transfer_size);
+	result = malloc(opts.transfer_size);
+	if (!data || !result) {
+		err = -FI_ENOMEM;
+		goto out;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+	for (i = 0; i < ARRAY_SIZE(reduce_bw_ops) && !err; i++) {
+		for (j = 0; j < ARRAY_SIZE(reduce_bw_types) && !err; j++) {
+			if (test_query(FI_ALLREDUCE, reduce_bw_ops[i],
+				       reduce_bw_types[j]))
+				continue;
+
+			err = reduce_bw_run_one(data, result, reduce_bw_ops[i],
+						reduce_bw_types[j]);
+		}
+	}
+
+out:
+	free(data);
+	free(result);
+	return err;
+}
+
 struct coll_test tests[] = {
 	{
 		.name = "join_test",
@@ -514,6 +640,15 @@ struct coll_test tests[] = {
 		.op = FI_NOOP,
 		.datatype = FI_UINT64
 	},
+	{
+		.name = "all_reduce_bw_test",
+		.setup = coll_setup,
+		.run = all_reduce_bw_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLREDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
 	{
 		.name = "empty_test_to_stop_the_sequence_of_execution",
 		.run = NULL,
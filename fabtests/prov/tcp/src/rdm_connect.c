@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the FI_TCP_CONNECT endpoint control.  Addresses that are not in
+ * the AV must fail with -FI_EINVAL without affecting valid addresses in
+ * the same call, and a valid address must be connected.  The endpoint
+ * connects to its own address, so no peer process is needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <netinet/in.h>
+
+#include <rdma/fi_cm.h>
+#include <rdma/fi_ext.h>
+
+#include "shared.h"
+
+static int tcp_connect(const fi_addr_t *addr, size_t count, int expected,
+		       const char *desc)
+{
+	struct fi_tcp_connect connect = {
+		.addr = addr,
+		.count = count,
+	};
+	int ret;
+
+	ret = fi_control(&ep->fid, FI_TCP_CONNECT, &connect);
+	if (ret != expected) {
+		FT_ERR("%s: FI_TCP_CONNECT returned %d, expected %d",
+		       desc, ret, expected);
+		return -FI_EOTHER;
+	}
+	return 0;
+}
+
+static int wait_connected(void)
+{
+	struct fi_tcp_conn_stats stats;
+	struct fi_cq_tagged_entry comp;
+	uint64_t start;
+	int ret;
+
+	start = ft_gettime_ms();
+	do {
+		(void) fi_cq_read(rxcq, &comp, 1);
+		ret = fi_control(&ep->fid, FI_TCP_CONN_STATS, &stats);
+		if (ret) {
+			FT_PRINTERR("fi_control(FI_TCP_CONN_STATS)", ret);
+			return ret;
+		}
+
+		if (stats.failed) {
+			FT_ERR("connection failed");
+			return -FI_ECONNREFUSED;
+		}
+	} while (!stats.connected && ft_gettime_ms() - start < 10000);
+
+	if (!stats.connected) {
+		FT_ERR("connection did not complete");
+		return -FI_ETIMEDOUT;
+	}
+	return 0;
+}
+
+static int run(void)
+{
+	char name[FT_MAX_CTRL_MSG], other[FT_MAX_CTRL_MSG];
+	fi_addr_t self, removed, addr[3];
+	size_t len = sizeof(name);
+	int ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = ft_alloc_active_res(fi);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep_recv();
+	if (ret)
+		return ret;
+
+	ret = fi_getname(&ep->fid, name, &len);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	ret = fi_av_insert(av, name, 1, &self, 0, NULL);
+	if (ret != 1) {
+		FT_PRINTERR("fi_av_insert", ret);
+		return ret < 0 ? ret : -FI_EOTHER;
+	}
+
+	/* sin_port and sin6_port share the same offset */
+	memcpy(other, name, len);
+	((struct sockaddr_in *) other)->sin_port ^= htons(1);
+	ret = fi_av_insert(av, other, 1, &removed, 0, NULL);
+	if (ret != 1) {
+		FT_PRINTERR("fi_av_insert", ret);
+		return ret < 0 ? ret : -FI_EOTHER;
+	}
+
+	ret = fi_av_remove(av, &removed, 1, 0);
+	if (ret) {
+		FT_PRINTERR("fi_av_remove", ret);
+		return ret;
+	}
+
+	addr[0] = FI_ADDR_NOTAVAIL;
+	ret = tcp_connect(addr, 1, -FI_EINVAL, "FI_ADDR_NOTAVAIL");
+	if (ret)
+		return ret;
+
+	addr[0] = self + 1000000;
+	ret = tcp_connect(addr, 1, -FI_EINVAL, "address past the AV");
+	if (ret)
+		return ret;
+
+	addr[0] = removed;
+	ret = tcp_connect(addr, 1, -FI_EINVAL, "removed address");
+	if (ret)
+		return ret;
+
+	addr[0] = FI_ADDR_NOTAVAIL;
+	addr[1] = self;
+	addr[2] = removed;
+	ret = tcp_connect(addr, 3, -FI_EINVAL, "mixed addresses");
+	if (ret)
+		return ret;
+
+	ret = wait_connected();
+	if (ret)
+		return ret;
+
+	return tcp_connect(&self, 1, 0, "connected address");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_SKIP_ADDR_EXCH;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "h" ADDR_OPTS INFO_OPTS)) != -1) {
+		switch (op) {
+		default:
+			ft_parse_addr_opts(op, optarg, &opts);
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case '?':
+		case 'h':
+			ft_usage(argv[0], "FI_TCP_CONNECT address validation "
+				 "test.");
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* The endpoint connects to itself, which needs a routable address */
+	if (!opts.src_addr)
+		opts.src_addr = "127.0.0.1";
+	if (!hints->fabric_attr->prov_name)
+		hints->fabric_attr->prov_name = strdup("tcp");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
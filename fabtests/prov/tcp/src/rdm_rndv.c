@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Sends a window of eager tagged messages followed directly by a tagged
+ * message large enough to use the rendezvous protocol.  The eager sends
+ * fill the socket, so the RTS of the large message is queued behind them
+ * rather than sent directly.  The receiver checks that every message arrives intact.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include <rdma/fi_tagged.h>
+
+#include "shared.h"
+
+static size_t eager_size = 61440;
+static int window = 256;
+
+/* Tags above those used by the common code for address exchange */
+#define TAG_BASE	(1ULL << 32)
+
+static struct fi_context *ctxs;
+static char **bufs;
+static uint64_t tx_total, tx_done, rx_total, rx_done;
+
+static size_t msg_size(int i)
+{
+	return i < window ? eager_size : opts.transfer_size;
+}
+
+static int poll_cq(struct fid_cq *cq, uint64_t *done)
+{
+	struct fi_cq_tagged_entry comp;
+	int ret;
+
+	ret = fi_cq_read(cq, &comp, 1);
+	if (ret > 0) {
+		(*done)++;
+		return 0;
+	}
+	if (ret == -FI_EAVAIL)
+		return ft_cq_readerr(cq);
+	return ret == -FI_EAGAIN ? 0 : ret;
+}
+
+/* The common completion helpers check tags against their own sequence */
+static int wait_cq(struct fid_cq *cq, uint64_t *done, uint64_t total)
+{
+	int ret;
+
+	while (*done < total) {
+		ret = poll_cq(cq, done);
+		if (ret) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static int send_window(uint64_t tag)
+{
+	int i, ret, err;
+
+	for (i = 0; i <= window; i++) {
+		do {
+			ret = fi_tsend(ep, tx_buf, msg_size(i), NULL,
+				       remote_fi_addr, tag + i, &ctxs[i]);
+			if (ret == -FI_EAGAIN) {
+				err = poll_cq(txcq, &tx_done);
+				if (err)
+					return err;
+			}
+		} while (ret == -FI_EAGAIN);
+		if (ret) {
+			FT_PRINTERR("fi_tsend", ret);
+			return ret;
+		}
+	}
+
+	/* The receiver posts only after the whole window is queued */
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	tx_total += window + 1;
+	return wait_cq(txcq, &tx_done, tx_total);
+}
+
+static int recv_window(uint64_t tag)
+{
+	int i, ret;
+
+	/* Leave the sender's socket full while it posts the large send */
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	for (i = 0; i <= window; i++) {
+		ret = fi_trecv(ep, bufs[i], msg_size(i), NULL, remote_fi_addr,
+			       tag + i, 0, &ctxs[i]);
+		if (ret) {
+			FT_PRINTERR("fi_trecv", ret);
+			return ret;
+		}
+	}
+
+	rx_total += window + 1;
+	ret = wait_cq(rxcq, &rx_done, rx_total);
+	if (ret)
+		return ret;
+
+	for (i = 0; i <= window; i++) {
+		ret = ft_check_buf(bufs[i], msg_size(i));
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int run(void)
+{
+	uint64_t tag;
+	int i, ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	ctxs = calloc(window + 1, sizeof(*ctxs));
+	bufs = calloc(window + 1, sizeof(*bufs));
+	if (!ctxs || !bufs)
+		return -FI_ENOMEM;
+
+	for (i = 0; i <= window; i++) {
+		bufs[i] = malloc(msg_size(i));
+		if (!bufs[i])
+			return -FI_ENOMEM;
+	}
+
+	ret = ft_fill_buf(tx_buf, opts.transfer_size);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < opts.iterations; i++) {
+		tag = TAG_BASE + (uint64_t) i * (window + 1);
+		if (opts.dst_addr)
+			ret = send_window(tag);
+		else
+			ret = recv_window(tag);
+		if (ret)
+			return ret;
+	}
+
+	printf("%d iterations of %d x %zu bytes + %zu bytes: passed\n",
+	       opts.iterations, window, eager_size, opts.transfer_size);
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, i, ret;
+
+	opts = INIT_OPTS;
+	opts.options |= FT_OPT_SIZE | FT_OPT_OOB_SYNC;
+	opts.transfer_size = 1024 * 1024;
+	opts.iterations = 10;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, "hW:e:" CS_OPTS INFO_OPTS)) != -1) {
+		switch (op) {
+		case 'W':
+			window = atoi(optarg);
+			break;
+		case 'e':
+			eager_size = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Eager and rendezvous tagged sends "
+				   "issued back-to-back.");
+			FT_PRINT_OPTS_USAGE("-W <count>", "eager sends before "
+					    "each large send (default 256)");
+			FT_PRINT_OPTS_USAGE("-e <size>", "eager message size, "
+					    "below FI_TCP_RNDV_SIZE (default 61440)");
+			FT_PRINT_OPTS_USAGE("-S <size>", "large message size "
+					    "(default 1048576)");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	if (!hints->fabric_attr->prov_name)
+		hints->fabric_attr->prov_name = strdup("tcp");
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_TAGGED;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	if (bufs) {
+		for (i = 0; i <= window; i++)
+			free(bufs[i]);
+		free(bufs);
+	}
+	free(ctxs);
+	ft_free_res();
+	return ft_exit_code(ret);
+}
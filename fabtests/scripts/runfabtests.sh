@@ -233,6 +233,8 @@ unit_tests=(
 	"fi_mr_test"
 	"fi_cntr_test"
 	"fi_setopt_test"
+	"fi_cq_trywait"
+	"fi_cq_trywait -S"
 )
 
 regression_tests=(
@@ -279,6 +281,14 @@ prov_efa_tests=( \
 	"fi_efa_rnr_queue_resend -c 1 -A write -U -S 4"
 )
 
+prov_tcp_unit_tests=(
+	"fi_tcp_rdm_connect"
+)
+
+prov_tcp_tests=(
+	"fi_tcp_rdm_rndv"
+)
+
 function errcho {
 	>&2 echo $*
 }
@@ -750,6 +760,16 @@ function prov_efa_test {
 	done
 }
 
+function prov_tcp_test {
+	for test in "${prov_tcp_unit_tests[@]}"; do
+		unit_test "$test" "0"
+	done
+
+	for test in "${prov_tcp_tests[@]}"; do
+		cs_test "$test"
+	done
+}
+
 function set_core_util {
 	prov_arr=$(echo $PROV | tr ";" " ")
 	CORE=""
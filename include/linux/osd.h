@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 
 #include <linux/errqueue.h>
+#include <linux/futex.h>
 #include <ifaddrs.h>
 #include "unix/osd.h"
 #include "rdma/fi_errno.h"
@@ -69,6 +70,53 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return ofi_mmap_anon_pages(memptr, size, MAP_HUGETLB);
 }
 
+#ifndef MAP_HUGE_SHIFT
+# define MAP_HUGE_SHIFT 26
+#endif
+
+/* Request a specific huge page size, e.g. 1G instead of the default */
+static inline int ofi_alloc_hugepage_buf_sz(void **memptr, size_t size,
+					    size_t page_size)
+{
+	return ofi_mmap_anon_pages(memptr, size, MAP_HUGETLB |
+			(__builtin_ctzl(page_size) << MAP_HUGE_SHIFT));
+}
+
+/*
+ * Sleep while *addr == val.  The word may live in memory shared between
+ * processes.  Returns 0 on a wakeup or value change, -FI_ETIMEDOUT when
+ * timeout (ms, -1 for infinite) expires.
+ */
+static inline int ofi_futex_wait(int32_t *addr, int32_t val, int timeout)
+{
+	struct timespec ts, *tsp = NULL;
+
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		tsp = &ts;
+	}
+
+	if (!syscall(SYS_futex, addr, FUTEX_WAIT, val, tsp, NULL, 0))
+		return 0;
+
+	switch (errno) {
+	case EAGAIN:
+	case EINTR:
+		return 0;
+	case ETIMEDOUT:
+		return -FI_ETIMEDOUT;
+	default:
+		return -errno;
+	}
+}
+
+static inline int ofi_futex_wake(int32_t *addr, int cnt)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAKE, cnt, NULL, NULL, 0) < 0 ?
+	       -errno : 0;
+}
+
 static inline int ofi_hugepage_enabled(void)
 {
 	size_t len;
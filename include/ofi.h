@@ -358,6 +358,8 @@ uint8_t ofi_lsb(uint64_t num);
 
 extern size_t ofi_universe_size;
 extern int ofi_av_remove_cleanup;
+extern int ofi_cq_lockless;
+extern int ofi_srx_tag_index;
 extern char *ofi_offload_coll_prov_name;
 extern int ofi_prefer_sysconfig;
 
@@ -89,6 +89,18 @@ extern void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_CNT][OFI_DATATYPE_CNT])
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags);
 
+/* Non-atomic reductions into private buffers; dst and src must not overlap */
+#define OFI_REDUCE_OP_CNT	(FI_BXOR + 1)
+#define ofi_reduce_isop(op)	(op >= FI_MIN && op <= FI_BXOR)
+
+extern void (*ofi_reduce_handlers[OFI_REDUCE_OP_CNT][OFI_DATATYPE_CNT])
+			(void *dst, const void *src, size_t cnt);
+
+#define ofi_reduce_handler(op, datatype, dst, src, cnt) \
+	ofi_reduce_handlers[op][datatype](dst, src, cnt)
+
+void ofi_reduce_init(void);
+
 
 #ifdef __cplusplus
 }
@@ -86,6 +86,19 @@
  *     . if the entry is a no-op it will be released and another entry
  *       will be fetched off the queue.
  *  . Call _release() after reader is done with the entry
+ *
+ * Batched usage:
+ *  . _next_n() claims up to n consecutive free entries with a single
+ *    update of the write position and returns how many were claimed
+ *  . Use _buf() to get each entry at pos + i, then _commit_n() to post
+ *    them all.  Entries that are not needed may be _discard()ed first.
+ *  . _head_n() claims up to n consecutive ready entries with a single
+ *    update of the read position.  No-op entries are skipped, and never
+ *    returned as part of a batch.
+ *  . Call _release_n() once the reader is done with all of them
+ *
+ * Entries are aligned to a cache line, so that a producer writing one
+ * entry does not share a line with the consumer reading its neighbor.
  */
 
 #ifdef __cplusplus
@@ -99,7 +112,7 @@ struct name ## _entry {						\
 	ofi_atomic64_t	seq;					\
 	bool		noop;					\
 	entrytype	buf;					\
-};								\
+} __attribute__((__aligned__(OFI_CACHE_LINE_SIZE)));		\
 struct name {							\
 	int		size;					\
 	int		size_mask;				\
@@ -226,6 +239,113 @@ static inline void name ## _discard(entrytype *buf,		\
 	ofi_atomic_store_explicit64(&ce->seq, pos + 1,		\
 			      memory_order_release);		\
 }								\
+static inline entrytype *name ## _buf(struct name *aq,		\
+				int64_t pos)			\
+{								\
+	return &aq->entry[pos & aq->size_mask].buf;		\
+}								\
+static inline int name ## _next_n(struct name *aq, int n,	\
+				int64_t *pos)			\
+{								\
+	struct name ## _entry *ce;				\
+	int64_t diff, seq;					\
+	int cnt;						\
+	*pos = ofi_atomic_load_explicit64(&aq->write_pos,	\
+				    memory_order_relaxed);	\
+	for (;;) {						\
+		ce = &aq->entry[*pos & aq->size_mask];		\
+		seq = ofi_atomic_load_explicit64(&(ce->seq),	\
+			memory_order_acquire);			\
+		diff = seq - *pos;				\
+		if (diff == 0) {				\
+			for (cnt = 1; cnt < n; cnt++) {		\
+				ce = &aq->entry[(*pos + cnt) &	\
+						aq->size_mask];	\
+				seq = ofi_atomic_load_explicit64(\
+					&(ce->seq),		\
+					memory_order_acquire);	\
+				if (seq != *pos + cnt)		\
+					break;			\
+			}					\
+			if (ofi_atomic_compare_exchange_weak64(	\
+				&aq->write_pos, pos,		\
+				*pos + cnt))			\
+				break;				\
+		} else if (diff < 0) {				\
+			return -FI_ENOENT;			\
+		} else {					\
+			*pos = ofi_atomic_load_explicit64(	\
+				&aq->write_pos,			\
+				memory_order_relaxed);		\
+		}						\
+	}							\
+	return cnt;						\
+}								\
+static inline void name ## _commit_n(struct name *aq,		\
+				int64_t pos, int cnt)		\
+{								\
+	int i;							\
+	for (i = 0; i < cnt; i++) {				\
+		if (aq->entry[(pos + i) & aq->size_mask].noop)	\
+			continue;				\
+		name ## _commit(name ## _buf(aq, pos + i),	\
+				pos + i);			\
+	}							\
+}								\
+static inline int name ## _head_n(struct name *aq, int n,	\
+				int64_t *pos)			\
+{								\
+	struct name ## _entry *ce;				\
+	int64_t diff, seq;					\
+	int cnt;						\
+again:								\
+	*pos = ofi_atomic_load_explicit64(&aq->read_pos,	\
+			memory_order_relaxed);			\
+	for (;;) {						\
+		ce = &aq->entry[*pos & aq->size_mask];		\
+		seq = ofi_atomic_load_explicit64(&(ce->seq),	\
+			memory_order_acquire);			\
+		diff = seq - (*pos + 1);			\
+		if (diff == 0) {				\
+			for (cnt = 1; cnt < n && !ce->noop;	\
+			     cnt++) {				\
+				ce = &aq->entry[(*pos + cnt) &	\
+						aq->size_mask];	\
+				seq = ofi_atomic_load_explicit64(\
+					&(ce->seq),		\
+					memory_order_acquire);	\
+				if (seq != *pos + cnt + 1 ||	\
+				    ce->noop)			\
+					break;			\
+			}					\
+			if (ofi_atomic_compare_exchange_weak64(	\
+				&aq->read_pos, pos,		\
+				*pos + cnt))			\
+				break;				\
+		} else if (diff < 0) {				\
+			return -FI_ENOENT;			\
+		} else {					\
+			*pos = ofi_atomic_load_explicit64(	\
+				&aq->read_pos,			\
+				memory_order_relaxed);		\
+		}						\
+	}							\
+	ce = &aq->entry[*pos & aq->size_mask];			\
+	if (ce->noop) {						\
+		ce->noop = false;				\
+		name ##_release(aq, &ce->buf, *pos);		\
+		goto again;					\
+	}							\
+	return cnt;						\
+}								\
+static inline void name ## _release_n(struct name *aq,		\
+				int64_t pos, int cnt)		\
+{								\
+	int i;							\
+	for (i = 0; i < cnt; i++)				\
+		name ## _release(aq, name ## _buf(aq, pos + i),	\
+				 pos + i);			\
+}								\
 void dummy ## name (void) /* work-around global ; scope */
 
 #ifdef __cplusplus
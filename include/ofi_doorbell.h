@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _OFI_DOORBELL_H_
+#define _OFI_DOORBELL_H_
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <ofi_osd.h>
+#include <ofi_atom.h>
+#include <ofi_mb.h>
+#include <ofi_list.h>
+#include <ofi_lock.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A doorbell lets the owner of a shared memory region sleep in
+ * fi_cq_sread or fi_cntr_wait until another process gives it work.
+ * Writers ring the bell after committing the work.  Until a sleeping CQ
+ * or counter is bound to the owner's endpoint, ringing is a single load.
+ */
+struct ofi_doorbell {
+	ofi_atomic32_t	ring;
+	ofi_atomic32_t	sleepers;
+	ofi_atomic32_t	enabled;
+};
+
+static inline void ofi_doorbell_init(struct ofi_doorbell *bell)
+{
+	ofi_atomic_initialize32(&bell->ring, 0);
+	ofi_atomic_initialize32(&bell->sleepers, 0);
+	ofi_atomic_initialize32(&bell->enabled, 0);
+}
+
+/* Called by the owner once a sleeping CQ or counter is bound */
+static inline void ofi_doorbell_enable(struct ofi_doorbell *bell)
+{
+	ofi_atomic_set32(&bell->enabled, 1);
+}
+
+/* The write that gave the owner work must come before the call */
+static inline void ofi_doorbell_ring(struct ofi_doorbell *bell)
+{
+	if (OFI_LIKELY(!ofi_atomic_get32(&bell->enabled)))
+		return;
+
+	ofi_mb();
+	if (!ofi_atomic_get32(&bell->sleepers))
+		return;
+
+	ofi_atomic_inc32(&bell->ring);
+	ofi_futex_wake((int32_t *) &bell->ring, INT_MAX);
+}
+
+/* Wakes sleepers until they leave, e.g. before the region is unmapped */
+void ofi_doorbell_drain(struct ofi_doorbell *bell);
+
+struct util_ep;
+
+/* Whether the endpoint is bound to a CQ or counter using the given ops */
+bool ofi_doorbell_ep_sleeps(struct util_ep *ep, const struct fi_ops_cq *cq_ops,
+			    const struct fi_ops_cntr *cntr_ops);
+
+/*
+ * Returns the doorbell of a bound endpoint.  Sets busy if the endpoint has
+ * transfers in flight that need polling to complete.
+ */
+typedef struct ofi_doorbell *(*ofi_doorbell_func)(struct fid *ep_fid,
+						  bool *busy);
+
+/*
+ * Blocking CQ and counter calls for util CQs and counters.  They poll for
+ * spin_us microseconds (forever if negative) and then sleep on the
+ * doorbells of the bound endpoints.
+ */
+ssize_t ofi_doorbell_cq_sreadfrom(struct fid_cq *cq_fid, void *buf,
+				  size_t count, fi_addr_t *src_addr,
+				  int timeout, int spin_us,
+				  ofi_doorbell_func get_bell);
+int ofi_doorbell_cq_signal(struct fid_cq *cq_fid, ofi_doorbell_func get_bell);
+int ofi_doorbell_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold,
+			   int timeout, int spin_us,
+			   ofi_doorbell_func get_bell);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OFI_DOORBELL_H_ */
@@ -181,6 +181,9 @@
  * SOFTWARE.
  */
 
+#ifndef _OFI_MB_H_
+#define _OFI_MB_H_
+
 #include "config.h"
 #include <stdbool.h>
 
@@ -192,6 +195,16 @@ static inline void ofi_wmb(void)
 	atomic_thread_fence(memory_order_release);
 }
 
+static inline void ofi_rmb(void)
+{
+	atomic_thread_fence(memory_order_acquire);
+}
+
+static inline void ofi_mb(void)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
 #elif defined(HAVE_BUILTIN_MM_ATOMICS)
 
 static inline void ofi_wmb(void)
@@ -199,6 +212,18 @@ static inline void ofi_wmb(void)
 	__atomic_thread_fence(__ATOMIC_RELEASE);
 }
 
+static inline void ofi_rmb(void)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+static inline void ofi_mb(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 #else
 #error "Neither built-in atomics nor C11 atomics is supported by compiler."
 #endif
+
+#endif /* _OFI_MB_H_ */
@@ -327,9 +327,43 @@ enum {
 	OFI_BUFPOOL_NO_TRACK		= 1 << 2,
 	OFI_BUFPOOL_HUGEPAGES		= 1 << 3,
 	OFI_BUFPOOL_NONSHARED		= 1 << 4,
+	OFI_BUFPOOL_THREAD_CACHE	= 1 << 5,
+};
+
+/*
+ * Pools created with OFI_BUFPOOL_THREAD_CACHE may be used from multiple
+ * threads without external locking.  Each thread allocates from and frees
+ * to a private cache of buffers.  The shared free list is only locked when
+ * a thread cache is refilled or drained, which moves buffers in batches of
+ * OFI_BUFPOOL_TCACHE_BATCH.  Regions are allocated and zeroed by the thread
+ * that triggers the grow, so pages are placed local to that thread on
+ * first touch.  A thread's caches are returned to their pools when the
+ * thread exits.  Not supported with OFI_BUFPOOL_INDEXED.
+ */
+enum {
+	OFI_BUFPOOL_TCACHE_SLOTS	= 8,
+	OFI_BUFPOOL_TCACHE_BATCH	= 32,
+	OFI_BUFPOOL_TCACHE_MAX		= 2 * OFI_BUFPOOL_TCACHE_BATCH,
 };
 
 struct ofi_bufpool_region;
+struct ofi_bufpool;
+
+struct ofi_bufpool_tcache {
+	struct slist			entries;
+	size_t				cnt;
+	struct ofi_bufpool		*pool;
+	struct dlist_entry		pool_entry;
+};
+
+/* Direct mapped by pool id; a stale id means the cache is no longer ours */
+struct ofi_bufpool_tslot {
+	uint64_t			pool_id;
+	struct ofi_bufpool_tcache	*cache;
+};
+
+extern OFI_THREAD_LOCAL struct ofi_bufpool_tslot
+	ofi_bufpool_tslots[OFI_BUFPOOL_TCACHE_SLOTS];
 
 struct ofi_bufpool_attr {
 	size_t 		size;
@@ -343,6 +377,18 @@ struct ofi_bufpool_attr {
 	int		flags;
 };
 
+/*
+ * Pools never shrink, so entry_cnt is the high-water mark of buffers in
+ * use, rounded up to chunk_cnt.  hugepage_miss counts huge page allocations
+ * that failed and fell back to a smaller page size.
+ */
+struct ofi_bufpool_stats {
+	size_t		region_cnt;
+	size_t		entry_cnt;
+	size_t		hugepage_cnt;
+	size_t		hugepage_miss;
+};
+
 struct ofi_bufpool {
 	union {
 		struct slist		entries;
@@ -357,6 +403,14 @@ struct ofi_bufpool {
 	size_t				alloc_size;
 	size_t				region_size;
 	struct ofi_bufpool_attr		attr;
+	size_t				hugepage_limit;
+	struct ofi_bufpool_stats	stats;
+
+	/* OFI_BUFPOOL_THREAD_CACHE only */
+	uint64_t			id;
+	pthread_mutex_t			lock;
+	struct dlist_entry		tcache_list;
+	struct dlist_entry		entry;
 };
 
 struct ofi_bufpool_region {
@@ -407,6 +461,9 @@ ofi_bufpool_create(struct ofi_bufpool **buf_pool,
 
 void ofi_bufpool_destroy(struct ofi_bufpool *pool);
 
+void ofi_bufpool_get_stats(struct ofi_bufpool *pool,
+			   struct ofi_bufpool_stats *stats);
+
 int ofi_bufpool_grow(struct ofi_bufpool *pool);
 
 static inline struct ofi_bufpool_hdr *ofi_buf_hdr(void *buf)
@@ -432,6 +489,39 @@ static inline struct ofi_bufpool *ofi_buf_pool(void *buf)
 	return ofi_buf_region(buf)->pool;
 }
 
+struct ofi_bufpool_tcache *ofi_bufpool_tcache_get(struct ofi_bufpool *pool);
+int ofi_bufpool_tcache_refill(struct ofi_bufpool_tcache *cache);
+void ofi_bufpool_tcache_drain(struct ofi_bufpool_tcache *cache, size_t cnt);
+void *ofi_buf_alloc_locked(struct ofi_bufpool *pool);
+void ofi_buf_free_locked(void *buf);
+
+static inline struct ofi_bufpool_tcache *
+ofi_bufpool_tcache(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_tslot *slot;
+
+	slot = &ofi_bufpool_tslots[pool->id % OFI_BUFPOOL_TCACHE_SLOTS];
+	if (OFI_LIKELY(slot->pool_id == pool->id))
+		return slot->cache;
+
+	return ofi_bufpool_tcache_get(pool);
+}
+
+static inline void ofi_buf_tcache_free(void *buf)
+{
+	struct ofi_bufpool_tcache *cache;
+
+	cache = ofi_bufpool_tcache(ofi_buf_pool(buf));
+	if (OFI_UNLIKELY(!cache)) {
+		ofi_buf_free_locked(buf);
+		return;
+	}
+
+	slist_insert_head(&ofi_buf_hdr(buf)->entry.slist, &cache->entries);
+	if (++cache->cnt > OFI_BUFPOOL_TCACHE_MAX)
+		ofi_bufpool_tcache_drain(cache, OFI_BUFPOOL_TCACHE_BATCH);
+}
+
 static inline void ofi_buf_free(void *buf)
 {
 	assert(ofi_atomic_dec32(&ofi_buf_region(buf)->use_cnt) >= 0);
@@ -439,6 +529,11 @@ static inline void ofi_buf_free(void *buf)
 	assert(ofi_buf_hdr(buf)->magic == OFI_MAGIC_SIZE_T);
 	assert(ofi_buf_hdr(buf)->ftr->magic == OFI_MAGIC_SIZE_T);
 
+	if (ofi_buf_pool(buf)->attr.flags & OFI_BUFPOOL_THREAD_CACHE) {
+		ofi_buf_tcache_free(buf);
+		return;
+	}
+
 	slist_insert_head(&ofi_buf_hdr(buf)->entry.slist,
 			  &ofi_buf_pool(buf)->free_list.entries);
 }
@@ -482,6 +577,19 @@ static inline void *ofi_bufpool_get_ibuf(struct ofi_bufpool *pool, size_t index)
 	return buf;
 }
 
+/* Returns NULL if index is past the allocated regions.  Otherwise the
+ * buffer is returned whether or not it is in use.
+ */
+static inline void *ofi_bufpool_peek_ibuf(struct ofi_bufpool *pool,
+					  size_t index)
+{
+	if (index >= pool->region_cnt * pool->attr.chunk_cnt)
+		return NULL;
+
+	return pool->region_table[index / pool->attr.chunk_cnt]->mem_region +
+	       (index % pool->attr.chunk_cnt) * pool->entry_size;
+}
+
 static inline int ofi_bufpool_empty(struct ofi_bufpool *pool)
 {
 	return slist_empty(&pool->free_list.entries);
@@ -492,11 +600,35 @@ static inline int ofi_ibufpool_empty(struct ofi_bufpool *pool)
 	return dlist_empty(&pool->free_list.regions);
 }
 
+static inline void *ofi_buf_tcache_alloc(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_tcache *cache;
+	struct ofi_bufpool_hdr *buf_hdr;
+
+	cache = ofi_bufpool_tcache(pool);
+	if (OFI_UNLIKELY(!cache))
+		return ofi_buf_alloc_locked(pool);
+
+	if (slist_empty(&cache->entries)) {
+		if (ofi_bufpool_tcache_refill(cache))
+			return NULL;
+	}
+
+	slist_remove_head_container(&cache->entries, struct ofi_bufpool_hdr,
+				    buf_hdr, entry.slist);
+	cache->cnt--;
+	assert(ofi_atomic_inc32(&buf_hdr->region->use_cnt));
+	return ofi_buf_data(buf_hdr);
+}
+
 static inline void *ofi_buf_alloc(struct ofi_bufpool *pool)
 {
 	struct ofi_bufpool_hdr *buf_hdr;
 
 	assert(!(pool->attr.flags & OFI_BUFPOOL_INDEXED));
+	if (pool->attr.flags & OFI_BUFPOOL_THREAD_CACHE)
+		return ofi_buf_tcache_alloc(pool);
+
 	if (ofi_bufpool_empty(pool)) {
 		if (ofi_bufpool_grow(pool))
 			return NULL;
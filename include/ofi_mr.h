@@ -48,6 +48,7 @@
 #include <ofi_lock.h>
 #include <ofi_list.h>
 #include <ofi_tree.h>
+#include <rdma/fi_ext.h>
 
 int ofi_open_mr_cache(uint32_t version, void *attr, size_t attr_len,
 		      uint64_t flags, struct fid **fid, void *context);
@@ -132,8 +133,9 @@ union ofi_mr_hmem_info {
 struct ofi_mr_entry {
 	struct ofi_mr_info		info;
 	struct ofi_rbnode		*node;
-	int				use_cnt;
+	ofi_atomic32_t			use_cnt;
 	struct dlist_entry		list_entry;
+	uint64_t			lru_seq;
 	union ofi_mr_hmem_info		hmem_info;
 	uint8_t				data[];
 };
@@ -322,10 +324,51 @@ struct ofi_mr_cache_params {
 	int				cuda_monitor_enabled;
 	int				rocr_monitor_enabled;
 	int				ze_monitor_enabled;
+	int				merge_regions;
+	int				reclaim;
+	size_t				low_watermark;
+	char *				stats_file;
+	size_t				stats_interval;
 };
 
 extern struct ofi_mr_cache_params	cache_params;
 
+/*
+ * Each thread remembers the last entry it hit in a cache, direct mapped by
+ * cache id.  The entry is only reused while the cache generation, which is
+ * bumped whenever an entry leaves the tree, matches the recorded one.  This
+ * lets searches of a region that is already in use take a reference without
+ * acquiring mm_lock.
+ */
+enum {
+	OFI_MR_CACHE_TSLOTS	= 8,
+};
+
+struct ofi_mr_cache_tslot {
+	uint64_t			cache_id;
+	uint64_t			gen;
+	struct ofi_mr_entry		*entry;
+	/* Fast path hits and lockless deletes, added under mm_lock */
+	size_t				hits;
+	size_t				deletes;
+};
+
+extern OFI_THREAD_LOCAL struct ofi_mr_cache_tslot
+	ofi_mr_cache_tslots[OFI_MR_CACHE_TSLOTS];
+
+/*
+ * Idle entries are kept on one LRU list per size class.  Classes grow by a
+ * factor of 16 starting at OFI_MR_CACHE_LRU_MIN bytes, with the last class
+ * holding everything larger.  With reclaim enabled, a background thread
+ * evicts idle entries in batches of OFI_MR_CACHE_RECLAIM_BATCH once the
+ * cache grows past the low watermark.
+ */
+enum {
+	OFI_MR_CACHE_LRU_CLASSES	= 4,
+	OFI_MR_CACHE_LRU_MIN		= 64 * 1024,
+	OFI_MR_CACHE_RECLAIM_BATCH	= 32,
+};
+
 #define OFI_HMEM_MAX 6
 
 struct ofi_mr_cache {
@@ -336,9 +379,22 @@ struct ofi_mr_cache {
 	size_t				entry_data_size;
 
 	struct ofi_rbmap		tree;
-	struct dlist_entry		lru_list;
+	struct dlist_entry		lru_list[OFI_MR_CACHE_LRU_CLASSES];
+	uint64_t			lru_seq;
 	struct dlist_entry		dead_region_list;
 	pthread_mutex_t 		lock;
+	uint64_t			id;
+	ofi_atomic64_t			gen;
+
+	/* Reclaim and stats thread state, protected by mm_lock */
+	pthread_t			thread;
+	pthread_cond_t			thread_cond;
+	bool				thread_running;
+	bool				thread_stop;
+	bool				reclaim;
+	size_t				low_cnt;
+	size_t				low_size;
+	uint64_t			stats_time;
 
 	size_t				cached_cnt;
 	size_t				cached_size;
@@ -348,12 +404,22 @@ struct ofi_mr_cache {
 	size_t				delete_cnt;
 	size_t				hit_cnt;
 	size_t				notify_cnt;
+	size_t				merge_cnt;
+	size_t				evict_cnt;
+	size_t				evict_size;
+	size_t				reclaim_cnt;
+	size_t				fast_hit_cnt;
+	size_t				evict[FI_MR_CACHE_EVICT_MAX];
+	size_t				hit_nsec[FI_MR_CACHE_HIST_SIZE];
+	size_t				miss_nsec[FI_MR_CACHE_HIST_SIZE];
 	struct ofi_bufpool		*entry_pool;
 
 	int				(*add_region)(struct ofi_mr_cache *cache,
 						      struct ofi_mr_entry *entry);
 	void				(*delete_region)(struct ofi_mr_cache *cache,
 							 struct ofi_mr_entry *entry);
+	/* Set by providers whose delete_region may run on the cache thread */
+	bool				delete_region_mt;
 };
 
 int ofi_mr_cache_init(struct util_domain *domain,
@@ -377,6 +443,8 @@ static inline bool ofi_mr_cache_full(struct ofi_mr_cache *cache)
 }
 
 bool ofi_mr_cache_flush(struct ofi_mr_cache *cache, bool flush_lru);
+int ofi_mr_cache_get_stats(struct ofi_mr_cache *cache,
+			   struct fi_mr_cache_stats *stats);
 
 /**
  * @brief Given an ofi_mr_info (with an iov range, ipc_info)
@@ -152,6 +152,9 @@ typedef struct {
 struct ofi_sockctx {
 	void *context;
 	bool uring_sqe_inuse;
+	/* Zero copy sends generate a separate notification completion */
+	bool uring_sqe_zc;
+	struct msghdr msg;
 };
 
 struct ofi_sockapi_uring {
@@ -187,6 +190,7 @@ ofi_sockctx_init(struct ofi_sockctx *sockctx, void *context)
 {
 	sockctx->context = context;
 	sockctx->uring_sqe_inuse = false;
+	sockctx->uring_sqe_zc = false;
 }
 
 static inline int
@@ -324,6 +328,7 @@ int ofi_sockctx_uring_poll_add(struct ofi_sockapi_uring *uring,
 
 int ofi_uring_init(ofi_io_uring_t *io_uring, size_t entries);
 int ofi_uring_destroy(ofi_io_uring_t *io_uring);
+bool ofi_uring_send_zc_supported(ofi_io_uring_t *io_uring);
 
 static inline int ofi_uring_get_fd(ofi_io_uring_t *io_uring)
 {
@@ -429,6 +434,7 @@ ofi_sockctx_uring_poll_add(struct ofi_sockapi_uring *uring,
 
 #define ofi_uring_init(io_uring, entries) -FI_ENOSYS
 #define ofi_uring_destroy(io_uring) -FI_ENOSYS
+#define ofi_uring_send_zc_supported(io_uring) false
 #define ofi_uring_get_fd(io_uring) INVALID_SOCKET
 #define ofi_uring_sq_ready(io_uring) 0
 #define ofi_uring_sq_space_left(io_uring) 0
@@ -438,6 +444,95 @@ ofi_sockctx_uring_poll_add(struct ofi_sockapi_uring *uring,
 #define ofi_uring_cq_advance(io_uring, count) do {} while(0)
 #endif
 
+/*
+ * Provided buffer ring - receive buffers selected by the kernel
+ */
+#ifdef HAVE_LIBURING_BUF_RING
+typedef struct io_uring_buf_ring ofi_io_uring_buf_ring_t;
+#else
+typedef void ofi_io_uring_buf_ring_t;
+#endif
+
+#ifndef IORING_CQE_F_BUFFER
+#define IORING_CQE_F_BUFFER	(1U << 0)
+#define IORING_CQE_BUFFER_SHIFT	16
+#endif
+
+#ifndef IORING_CQE_F_NOTIF
+#define IORING_CQE_F_NOTIF	(1U << 3)
+#endif
+
+struct ofi_uring_buf {
+	struct slist_entry entry;
+	uint32_t offset;
+	uint32_t len;
+};
+
+struct ofi_uring_bufring {
+	ofi_io_uring_buf_ring_t *br;
+	struct ofi_uring_buf *bufs;
+	uint8_t *data;
+	size_t buf_size;
+	unsigned int cnt;
+	unsigned int avail;
+	int bgid;
+};
+
+static inline uint16_t
+ofi_uring_buf_id(struct ofi_uring_bufring *bufring, struct ofi_uring_buf *buf)
+{
+	return (uint16_t) (buf - bufring->bufs);
+}
+
+static inline uint8_t *
+ofi_uring_buf_data(struct ofi_uring_bufring *bufring, struct ofi_uring_buf *buf)
+{
+	return &bufring->data[ofi_uring_buf_id(bufring, buf) *
+			      bufring->buf_size] + buf->offset;
+}
+
+#ifdef HAVE_LIBURING_BUF_RING
+int ofi_uring_bufring_init(ofi_io_uring_t *io_uring,
+			   struct ofi_uring_bufring *bufring,
+			   unsigned int cnt, size_t buf_size, int bgid);
+void ofi_uring_bufring_destroy(ofi_io_uring_t *io_uring,
+			       struct ofi_uring_bufring *bufring);
+void ofi_uring_bufring_put(struct ofi_uring_bufring *bufring,
+			   struct ofi_uring_buf *buf);
+int ofi_sockctx_uring_recv_multishot(struct ofi_sockapi_uring *uring,
+				     SOCKET sock,
+				     struct ofi_uring_bufring *bufring,
+				     struct ofi_sockctx *ctx);
+#else
+static inline int
+ofi_uring_bufring_init(ofi_io_uring_t *io_uring,
+		       struct ofi_uring_bufring *bufring,
+		       unsigned int cnt, size_t buf_size, int bgid)
+{
+	return -FI_ENOSYS;
+}
+
+static inline void
+ofi_uring_bufring_destroy(ofi_io_uring_t *io_uring,
+			  struct ofi_uring_bufring *bufring)
+{
+}
+
+static inline void
+ofi_uring_bufring_put(struct ofi_uring_bufring *bufring,
+		      struct ofi_uring_buf *buf)
+{
+}
+
+static inline int
+ofi_sockctx_uring_recv_multishot(struct ofi_sockapi_uring *uring, SOCKET sock,
+				 struct ofi_uring_bufring *bufring,
+				 struct ofi_sockctx *ctx)
+{
+	return -FI_ENOSYS;
+}
+#endif
+
 /*
  * Byte queue - streaming socket staging buffer
  */
@@ -542,6 +637,12 @@ struct ofi_bsock {
 	uint32_t async_index;
 	uint32_t done_index;
 	bool async_prefetch;
+
+	/* Received data held in provided buffers, if used */
+	struct ofi_uring_bufring *bufring;
+	struct slist rx_bufs;
+	size_t rx_buf_bytes;
+	int rx_buf_status;
 };
 
 static inline void
@@ -557,21 +658,29 @@ ofi_bsock_init(struct ofi_bsock *bsock, struct ofi_sockapi *sockapi,
 	ofi_byteq_init(&bsock->rq, rbuf_size);
 	bsock->zerocopy_size = SIZE_MAX;
 	bsock->async_prefetch = false;
+	bsock->bufring = NULL;
+	slist_init(&bsock->rx_bufs);
+	bsock->rx_buf_bytes = 0;
+	bsock->rx_buf_status = -FI_EAGAIN;
 
 	/* first async op will wrap back to 0 as the starting index */
 	bsock->async_index = UINT32_MAX;
 	bsock->done_index = UINT32_MAX;
 }
 
+void ofi_bsock_discard_bufs(struct ofi_bsock *bsock);
+
 static inline void ofi_bsock_discard(struct ofi_bsock *bsock)
 {
 	ofi_byteq_discard(&bsock->rq);
 	ofi_byteq_discard(&bsock->sq);
+	if (bsock->bufring)
+		ofi_bsock_discard_bufs(bsock);
 }
 
 static inline size_t ofi_bsock_readable(struct ofi_bsock *bsock)
 {
-	return ofi_byteq_readable(&bsock->rq);
+	return ofi_byteq_readable(&bsock->rq) + bsock->rx_buf_bytes;
 }
 
 static inline size_t ofi_bsock_tosend(struct ofi_bsock *bsock)
@@ -598,7 +707,9 @@ static inline int ofi_bsock_recv_unbuffered(struct ofi_bsock *bsock, void *buf,
 int ofi_bsock_flush(struct ofi_bsock *bsock);
 int ofi_bsock_flush_sync(struct ofi_bsock *bsock);
 /* For sends started asynchronously, the return value will be -EINPROGRESS_ASYNC,
- * and len will be set to the number of bytes that were queued.
+ * and len will be set to the number of bytes that were queued.  Zero copy
+ * sends posted to io_uring return -OFI_EINPROGRESS_URING, but still advance
+ * async_index, which the caller tracks through the notification completion.
  */
 int ofi_bsock_send(struct ofi_bsock *bsock, const void *buf, size_t *len);
 int ofi_bsock_sendv(struct ofi_bsock *bsock, const struct iovec *iov,
@@ -609,6 +720,11 @@ int ofi_bsock_recvv(struct ofi_bsock *bsock, struct iovec *iov,
 uint32_t ofi_bsock_async_done(const struct fi_provider *prov,
 			      struct ofi_bsock *bsock);
 void ofi_bsock_prefetch_done(struct ofi_bsock *bsock, size_t len);
+/* Queue data received into a provided buffer by a multishot receive.
+ * A res of 0 or an error is returned by later receive calls once all
+ * queued data has been read.
+ */
+void ofi_bsock_recv_buf_done(struct ofi_bsock *bsock, int res, uint32_t flags);
 
 
 /*
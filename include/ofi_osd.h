@@ -77,6 +77,18 @@ typedef long double long_double;
 #define OFI_UNLIKELY(x)	(x)
 #endif
 
+#ifdef _MSC_VER
+#define OFI_RESTRICT	__restrict
+#else
+#define OFI_RESTRICT	restrict
+#endif
+
+#ifdef _WIN32
+#define OFI_THREAD_LOCAL	__declspec(thread)
+#else
+#define OFI_THREAD_LOCAL	__thread
+#endif
+
 enum {
 	OFI_ENDIAN_UNKNOWN,
 	OFI_ENDIAN_BIG,
@@ -60,6 +60,7 @@
 #include <ofi_list.h>
 #include <ofi_mem.h>
 #include <ofi_rbuf.h>
+#include <ofi_atomic_queue.h>
 #include <ofi_signal.h>
 #include <ofi_enosys.h>
 #include <ofi_osd.h>
@@ -90,6 +91,9 @@ extern "C" {
 /* Memory registration should not be cached */
 #define OFI_MR_NOCACHE		BIT_ULL(60)
 
+/* Provider accesses the CQ cirq directly, do not use the lock-free ring */
+#define OFI_CQ_DIRECT		BIT_ULL(62)
+
 #define OFI_INFO_FIELD(provider, prov_attr, user_attr, prov_str, user_str, type) \
 	do {									\
 		FI_INFO(provider, FI_LOG_CORE, prov_str ": %s\n",		\
@@ -496,6 +500,13 @@ struct util_cq_aux_entry {
 
 OFI_DECLARE_CIRQUE(struct fi_cq_tagged_entry, util_comp_cirq);
 
+struct util_cq_comp {
+	struct fi_cq_tagged_entry	comp;
+	fi_addr_t			src;
+};
+
+OFI_DECLARE_ATOMIC_Q(struct util_cq_comp, util_comp_ring);
+
 typedef void (*ofi_cq_progress_func)(struct util_cq *cq);
 
 struct util_cq {
@@ -519,6 +530,14 @@ struct util_cq {
 	fi_addr_t		*src;
 	struct slist		aux_queue;
 	fi_cq_read_func		read_entry;
+
+	/* Lock-free storage, replaces cirq and src when set.  Only the
+	 * aux_queue is protected by cq_lock.  Once an entry is queued
+	 * there, writers keep appending to it until it drains, so that
+	 * completions are not reordered.
+	 */
+	struct util_comp_ring	*ring;
+	ofi_atomic32_t		aux_cnt;
 };
 
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
@@ -546,6 +565,29 @@ const char *ofi_cq_strerror(struct fid_cq *cq, int prov_errno,
 int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 			  size_t len, void *buf, uint64_t data, uint64_t tag,
 			  fi_addr_t src);
+int ofi_cq_write_ring(struct util_cq *cq, void *context, uint64_t flags,
+		      size_t len, void *buf, uint64_t data, uint64_t tag,
+		      fi_addr_t src);
+ssize_t ofi_cq_read_ring(struct util_cq *cq, void *buf, size_t count,
+			 fi_addr_t *src_addr);
+
+static inline bool ofi_cq_isempty(struct util_cq *cq)
+{
+	if (cq->ring)
+		return !ofi_atomic_get32(&cq->aux_cnt) &&
+		       ofi_atomic_get64(&cq->ring->read_pos) ==
+		       ofi_atomic_get64(&cq->ring->write_pos);
+	return ofi_cirque_isempty(cq->cirq);
+}
+
+static inline bool ofi_cq_isfull(struct util_cq *cq)
+{
+	if (cq->ring)
+		return ofi_atomic_get64(&cq->ring->write_pos) -
+		       ofi_atomic_get64(&cq->ring->read_pos) >=
+		       cq->ring->size;
+	return ofi_cirque_isfull(cq->cirq);
+}
 
 static inline
 ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
@@ -555,6 +597,9 @@ ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
 	struct util_cq_aux_entry *aux_entry;
 	ssize_t i;
 
+	if (cq->ring)
+		return ofi_cq_read_ring(cq, buf, count, src_addr);
+
 	ofi_genlock_lock(&cq->cq_lock);
 	if (ofi_cirque_isempty(cq->cirq)) {
 		i = -FI_EAGAIN;
@@ -634,6 +679,10 @@ ofi_cq_write(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 {
 	int ret;
 
+	if (cq->ring)
+		return ofi_cq_write_ring(cq, context, flags, len, buf, data,
+					 tag, FI_ADDR_NOTAVAIL);
+
 	ofi_genlock_lock(&cq->cq_lock);
 	if (ofi_cirque_freecnt(cq->cirq) > 1) {
 		ofi_cq_write_entry(cq, context, flags, len, buf, data, tag);
@@ -652,6 +701,10 @@ ofi_cq_write_src(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 {
 	int ret;
 
+	if (cq->ring)
+		return ofi_cq_write_ring(cq, context, flags, len, buf, data,
+					 tag, src);
+
 	ofi_genlock_lock(&cq->cq_lock);
 	if (ofi_cirque_freecnt(cq->cirq) > 1) {
 		ofi_cq_write_src_entry(cq, context, flags, len, buf, data,
@@ -978,6 +1031,7 @@ int ofi_ip_av_create(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 void *ofi_av_get_addr(struct util_av *av, fi_addr_t fi_addr);
 #define ofi_ip_av_get_addr ofi_av_get_addr
 void *ofi_av_addr_context(struct util_av *av, fi_addr_t fi_addr);
+bool ofi_av_addr_valid(struct util_av *av, fi_addr_t fi_addr);
 
 fi_addr_t ofi_ip_av_get_fi_addr(struct util_av *av, const void *addr);
 
@@ -1262,6 +1316,7 @@ struct ofi_ops_dynamic_rbuf {
 			    size_t *count);
 };
 
+/* Must stay below FI_TCP_CONNECT */
 enum {
 	OFI_OPT_TCP_FI_ADDR = -FI_PROV_SPECIFIC_TCP
 };
@@ -1271,6 +1326,8 @@ struct util_rx_entry {
 	uint64_t		seq_no;
 	uint64_t		ignore;
 	int			multi_recv_ref;
+	/* unexpected tag bucket, only linked when the tag index is enabled */
+	struct dlist_entry	tag_entry;
 	/* extra memory allocated at the end of each entry to hold iovecs and
 	 * MR descriptors. The amount of memory is determined by the provider's
 	 * iov limit.
@@ -1287,10 +1344,17 @@ typedef void(*ofi_update_func_t)(struct util_srx_ctx *srx,
 struct util_unexp_peer {
 	struct dlist_entry	entry;
 	struct slist		msg_queue;
-	struct slist		tag_queue;
+	struct dlist_entry	tag_queue;
 	int			cnt;
 };
 
+/* Number of queue entries examined per tag match */
+struct util_srx_match_stats {
+	uint64_t		search_cnt;
+	uint64_t		depth;
+	uint64_t		max_depth;
+};
+
 struct util_srx_ctx {
 	struct fid_peer_srx	peer_srx;
 	bool			dir_recv;
@@ -1314,6 +1378,17 @@ struct util_srx_ctx {
 	struct dlist_entry	unexp_peers;
 	struct ofi_dyn_arr	src_unexp_peers;
 
+	/* Optional tag index (FI_SRX_TAG_INDEX).  Posted receives from any
+	 * source with an exact tag are hashed by tag; those with ignore bits
+	 * stay in tag_queue.  Unexpected tagged messages are additionally
+	 * linked into a bucket by tag.  Sequence numbers keep the order.
+	 */
+	size_t			tag_bucket_cnt;
+	struct slist		*tag_buckets;
+	struct dlist_entry	*unexp_tag_buckets;
+	struct util_srx_match_stats posted_stats;
+	struct util_srx_match_stats unexp_stats;
+
 	struct ofi_bufpool	*rx_pool;
 	struct ofi_genlock	*lock;
 };
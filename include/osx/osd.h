@@ -89,6 +89,22 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return -FI_ENOSYS;
 }
 
+static inline int ofi_alloc_hugepage_buf_sz(void **memptr, size_t size,
+					    size_t page_size)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_futex_wait(int32_t *addr, int32_t val, int timeout)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_futex_wake(int32_t *addr, int cnt)
+{
+	return -FI_ENOSYS;
+}
+
 static inline size_t ofi_ifaddr_get_speed(struct ifaddrs *ifa)
 {
 	return 0;
@@ -65,6 +65,7 @@ extern "C" {
 
 #define FI_PROV_SPECIFIC_EFA   (0xefa << 16)
 #define FI_PROV_SPECIFIC_TCP   (0x7cb << 16)
+#define FI_PROV_SPECIFIC_UTIL  (0x0f1 << 16)
 
 
 /* negative options are provider specific */
@@ -78,6 +79,82 @@ enum {
 	FI_OPT_EFA_WRITE_IN_ORDER_ALIGNED_128_BYTES, /* bool */
 };
 
+/* TCP rdm endpoint commands, issued using fi_control().  The first 256
+ * TCP specific values are reserved for internal use.
+ */
+enum {
+	FI_TCP_CONNECT = -FI_PROV_SPECIFIC_TCP + 256,	/* struct fi_tcp_connect */
+	FI_TCP_CONN_STATS,			/* struct fi_tcp_conn_stats */
+};
+
+struct fi_tcp_connect {
+	const fi_addr_t	*addr;
+	size_t		count;
+};
+
+#define FI_TCP_CONN_HIST_SIZE	32
+
+/* Bucket 0 of setup_usec counts connections established in under 1
+ * microsecond.  Bucket i counts times in [2^(i-1), 2^i) microseconds,
+ * with the last bucket also counting longer times.
+ */
+struct fi_tcp_conn_stats {
+	uint64_t	started;
+	uint64_t	connected;
+	uint64_t	failed;
+	uint64_t	setup_usec[FI_TCP_CONN_HIST_SIZE];
+};
+
+/* Domain commands of providers using the common registration cache,
+ * issued using fi_control()
+ */
+enum {
+	FI_MR_CACHE_STATS = -FI_PROV_SPECIFIC_UTIL,	/* struct fi_mr_cache_stats */
+};
+
+/* Reasons a region leaves the registration cache */
+enum {
+	FI_MR_CACHE_EVICT_FLUSH,	/* idle, flushed while the cache was full */
+	FI_MR_CACHE_EVICT_RECLAIM,	/* idle, evicted by the reclaim thread */
+	FI_MR_CACHE_EVICT_NOTIFY,	/* memory monitor reported a change */
+	FI_MR_CACHE_EVICT_INVALID,	/* memory monitor rejected it on lookup */
+	FI_MR_CACHE_EVICT_OVERLAP,	/* replaced by an overlapping region */
+	FI_MR_CACHE_EVICT_MERGE,	/* merged into a larger region */
+	FI_MR_CACHE_EVICT_MAX,
+};
+
+#define FI_MR_CACHE_HIST_SIZE	32
+
+/* Set size to sizeof(struct fi_mr_cache_stats) before the call.  Only
+ * counters that fit in size bytes are returned, and size is updated to the
+ * number of bytes written.  New counters are only added at the end.
+ *
+ * Bucket 0 of hit_nsec and miss_nsec counts lookups that took under 1
+ * nanosecond.  Bucket i counts times in [2^(i-1), 2^i) nanoseconds, with
+ * the last bucket also counting longer times.  Misses include the time to
+ * register the region.  Lookups that hit without taking the cache lock
+ * are only counted in fast_hit_cnt.
+ */
+struct fi_mr_cache_stats {
+	size_t		size;
+	uint64_t	cached_cnt;
+	uint64_t	cached_size;
+	uint64_t	uncached_cnt;
+	uint64_t	uncached_size;
+	uint64_t	search_cnt;
+	uint64_t	hit_cnt;
+	uint64_t	delete_cnt;
+	uint64_t	notify_cnt;
+	uint64_t	merge_cnt;
+	uint64_t	evict_cnt;
+	uint64_t	evict_size;
+	uint64_t	reclaim_cnt;
+	uint64_t	fast_hit_cnt;
+	uint64_t	evict[FI_MR_CACHE_EVICT_MAX];
+	uint64_t	hit_nsec[FI_MR_CACHE_HIST_SIZE];
+	uint64_t	miss_nsec[FI_MR_CACHE_HIST_SIZE];
+};
+
 struct fi_fid_export {
 	struct fid **fid;
 	uint64_t flags;
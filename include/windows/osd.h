@@ -963,6 +963,22 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return -FI_ENOSYS;
 }
 
+static inline int ofi_alloc_hugepage_buf_sz(void **memptr, size_t size,
+					    size_t page_size)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_futex_wait(int32_t *addr, int32_t val, int timeout)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_futex_wake(int32_t *addr, int cnt)
+{
+	return -FI_ENOSYS;
+}
+
 static inline int ofi_hugepage_enabled(void)
 {
 	return 0;
@@ -1067,8 +1083,18 @@ OFI_DEF_COMPLEX(long_double)
 
 
 /* atomics primitives */
+
+/* Interlocked calls are full barriers, so orderings are ignored */
+#define memory_order_relaxed 0
+#define memory_order_consume 0
+#define memory_order_acquire 0
+#define memory_order_release 0
+#define memory_order_acq_rel 0
+#define memory_order_seq_cst 0
+
 #ifdef HAVE_BUILTIN_ATOMICS
 #define InterlockedAdd32 InterlockedAdd
+#define InterlockedExchange32 InterlockedExchange
 #define InterlockedCompareExchange32 InterlockedCompareExchange
 typedef LONG ofi_atomic_int_32_t;
 typedef LONGLONG ofi_atomic_int_64_t;
@@ -1078,13 +1104,32 @@ typedef LONGLONG ofi_atomic_int_64_t;
 #define ofi_atomic_cas_bool(radix, ptr, expected, desired)					\
 	(InterlockedCompareExchange##radix((ofi_atomic_int_##radix##_t volatile *)ptr, desired, expected) == expected)
 
+/* Updates *expected with the current value on failure, as C11 does */
+#define OFI_DEF_WIN_CAS(radix)								\
+static inline bool									\
+ofi_win_compare_exchange##radix(volatile void *ptr, int##radix##_t *expected,		\
+				int##radix##_t desired)					\
+{											\
+	int##radix##_t old;								\
+											\
+	old = (int##radix##_t) InterlockedCompareExchange##radix(			\
+		(ofi_atomic_int_##radix##_t volatile *) ptr, desired, *expected);	\
+	if (old == *expected)								\
+		return true;								\
+	*expected = old;								\
+	return false;									\
+}
+
+OFI_DEF_WIN_CAS(32)
+OFI_DEF_WIN_CAS(64)
+
 #define ofi_atomic_compare_exchange_weak(radix, ptr, expected, desired, \
 					 succ_memmodel, fail_memmodel) \
-	InterlockedCompareExchange((ofi_atomic_int_##radix##_t volatile *)ptr, desired, expected)
+	ofi_win_compare_exchange##radix(ptr, expected, desired)
 #define ofi_atomic_store_explicit(radix, ptr, value, memmodel) \
-	InterlockedExchange((ofi_atomic_int_##radix##_t volatile *)ptr, value)
+	InterlockedExchange##radix((ofi_atomic_int_##radix##_t volatile *)ptr, value)
 #define ofi_atomic_load_explicit(radix, ptr, memmodel) \
-	InterlockedAdd((ofi_atomic_int_##radix##_t volatile *)ptr, 0)
+	InterlockedAdd##radix((ofi_atomic_int_##radix##_t volatile *)ptr, 0)
 #endif /* HAVE_BUILTIN_ATOMICS */
 
 static inline int ofi_set_thread_affinity(const char *s)
@@ -756,13 +756,13 @@ void coll_collective_comp(struct util_coll_operation *coll_op)
 
 static ssize_t coll_process_reduce_item(struct util_coll_reduce_item *reduce_item)
 {
-	if (reduce_item->op < FI_MIN || reduce_item->op > FI_BXOR)
+	if (!ofi_reduce_isop(reduce_item->op))
 		return -FI_ENOSYS;
 
-	ofi_atomic_write_handler(reduce_item->op, reduce_item->datatype,
-				 reduce_item->inout_buf,
-				 reduce_item->in_buf,
-				 reduce_item->count);
+	ofi_reduce_handler(reduce_item->op, reduce_item->datatype,
+			   reduce_item->inout_buf,
+			   reduce_item->in_buf,
+			   reduce_item->count);
 	return FI_SUCCESS;
 }
 
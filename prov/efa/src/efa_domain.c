@@ -47,11 +47,28 @@ struct dlist_entry g_efa_domain_list;
 
 static int efa_domain_close(fid_t fid);
 
+static int efa_domain_control(struct fid *fid, int command, void *arg)
+{
+	struct efa_domain *efa_domain;
+
+	efa_domain = container_of(fid, struct efa_domain,
+				  util_domain.domain_fid.fid);
+
+	switch (command) {
+	case FI_MR_CACHE_STATS:
+		if (!efa_domain->cache)
+			return -FI_ENOSYS;
+		return ofi_mr_cache_get_stats(efa_domain->cache, arg);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
 static struct fi_ops efa_ops_domain_fid = {
 	.size = sizeof(struct fi_ops),
 	.close = efa_domain_close,
 	.bind = fi_no_bind,
-	.control = fi_no_control,
+	.control = efa_domain_control,
 	.ops_open = fi_no_ops_open,
 };
 
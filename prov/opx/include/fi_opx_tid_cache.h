@@ -112,7 +112,7 @@ static inline int opx_tid_cache_open_region(struct fi_opx_tid_domain *opx_tid_do
 	opx_tid_mr->entry = entry;
 	assert(opx_tid_mr->ep == NULL || opx_tid_mr->ep == opx_ep);
 	opx_tid_mr->ep = opx_ep;
-	FI_DBG(&fi_opx_provider, FI_LOG_MR,"ENTRY opx_tid_mr %p, entry %p, entry->data %p, endpoint %p, use count %d, KEY %#lX\n",opx_tid_mr, entry, entry->data, opx_tid_mr->ep, entry->use_cnt, requested_key);
+	FI_DBG(&fi_opx_provider, FI_LOG_MR,"ENTRY opx_tid_mr %p, entry %p, entry->data %p, endpoint %p, use count %d, KEY %#lX\n",opx_tid_mr, entry, entry->data, opx_tid_mr->ep, ofi_atomic_get32(&entry->use_cnt), requested_key);
 	assert(opx_tid_mr->ep == opx_ep);
 	*p_opx_tid_mr = opx_tid_mr;
 	return 0;
@@ -121,7 +121,7 @@ static inline int opx_tid_cache_open_region(struct fi_opx_tid_domain *opx_tid_do
 static inline int opx_tid_cache_close_region(struct fi_opx_tid_mr *opx_tid_mr)
 {
 	struct ofi_mr_entry	*entry = opx_tid_mr->entry;
-	FI_DBG(&fi_opx_provider, FI_LOG_MR, "ENTRY domain %p, cache %p, opx_tid_mr %p, entry %p, iov_base %p, iov_len %zd, use count %d\n", opx_tid_mr->domain, opx_tid_mr->domain->tid_cache, opx_tid_mr, entry, entry ? entry->info.iov.iov_base : NULL, entry ? entry->info.iov.iov_len : -99UL, entry ? entry->use_cnt : -99);
+	FI_DBG(&fi_opx_provider, FI_LOG_MR, "ENTRY domain %p, cache %p, opx_tid_mr %p, entry %p, iov_base %p, iov_len %zd, use count %d\n", opx_tid_mr->domain, opx_tid_mr->domain->tid_cache, opx_tid_mr, entry, entry ? entry->info.iov.iov_base : NULL, entry ? entry->info.iov.iov_len : -99UL, entry ? ofi_atomic_get32(&entry->use_cnt) : -99);
 	ofi_mr_cache_delete(opx_tid_mr->domain->tid_cache, entry);
 	return 0;
 }
@@ -98,7 +98,7 @@ static ssize_t rxd_generic_write_inject(struct rxd_ep *rxd_ep,
 
 	ofi_genlock_lock(&rxd_ep->util_ep.lock);
 
-	if (ofi_cirque_isfull(rxd_ep->util_ep.tx_cq->cirq))
+	if (ofi_cq_isfull(rxd_ep->util_ep.tx_cq))
 		goto out;
 
 	rxd_addr = (intptr_t) ofi_idx_lookup(&(rxd_ep_av(rxd_ep)->fi_addr_idx),
@@ -149,7 +149,7 @@ rxd_generic_rma(struct rxd_ep *rxd_ep, const struct iovec *iov,
 
 	ofi_genlock_lock(&rxd_ep->util_ep.lock);
 
-	if (ofi_cirque_isfull(rxd_ep->util_ep.tx_cq->cirq))
+	if (ofi_cq_isfull(rxd_ep->util_ep.tx_cq))
 		goto out;
 	rxd_addr = (intptr_t) ofi_idx_lookup(&(rxd_ep_av(rxd_ep)->fi_addr_idx),
 					     RXD_IDX_OFFSET((int) addr));
@@ -77,8 +77,18 @@ struct smr_env {
 	int use_dsa_sar;
 	size_t max_gdrcopy_size;
 	int use_xpmem;
+	size_t max_peers;
+	int wait_spin;
+	int calibrate;
+	int sar_pipeline;
+	size_t sar_nt_threshold;
+	int offload_threads;
+	char *offload_affinity;
 };
 
+/* Segments a pipelined SAR send copies before posting the command */
+#define SMR_SAR_PIPE_PREFILL	2
+
 extern struct smr_env smr_env;
 extern struct fi_provider smr_prov;
 extern struct fi_info smr_info;
@@ -112,6 +122,7 @@ int smr_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 		enum fi_op op, struct fi_atomic_attr *attr, uint64_t flags);
 
 #define SMR_IOV_LIMIT		4
+#define SMR_CMD_BATCH		16
 
 struct smr_tx_entry {
 	struct smr_cmd	cmd;
@@ -207,7 +218,7 @@ struct smr_sock_info {
 	pthread_t		listener_thread;
 	int			*my_fds;
 	int			nfds;
-	struct smr_cmap_entry	peers[SMR_MAX_PEERS];
+	struct smr_cmap_entry	*peers;
 };
 
 struct smr_unexp_buf {
@@ -235,6 +246,7 @@ struct smr_ep {
 	enum ofi_shm_p2p_type	p2p_type;
 	struct smr_sock_info	*sock_info;
 	void			*dsa_context;
+	void			*offload_context;
 	void 			(*smr_progress_ipc_list)(struct smr_ep *ep);
 };
 
@@ -281,8 +293,9 @@ size_t smr_copy_from_sar(struct smr_freestack *sar_pool, struct smr_resp *resp,
 			 struct smr_cmd *cmd, struct ofi_mr **mr,
 			 const struct iovec *iov, size_t count,
 			 size_t *bytes_done);
-int smr_select_proto(void **desc, size_t iov_count, bool cma_avail,
-		     uint32_t op, uint64_t total_len, uint64_t op_flags);
+int smr_select_proto(void **desc, size_t iov_count, bool vma_avail,
+		     bool cma_copy, uint32_t op, uint64_t total_len,
+		     uint64_t op_flags);
 typedef ssize_t (*smr_proto_func)(struct smr_ep *ep, struct smr_region *peer_smr,
 		int64_t id, int64_t peer_id, uint32_t op, uint64_t tag,
 		uint64_t data, uint64_t op_flags, struct ofi_mr **desc,
@@ -309,6 +322,11 @@ static inline uint64_t smr_rx_cq_flags(uint32_t op, uint64_t rx_flags,
 
 void smr_ep_progress(struct util_ep *util_ep);
 
+/* Blocking CQ and counter waits sleep on the bound endpoints' doorbells */
+extern struct fi_ops_cq smr_cq_sleep_ops;
+extern struct fi_ops_cntr smr_cntr_sleep_ops;
+struct ofi_doorbell *smr_ep_doorbell(struct fid *ep_fid, bool *busy);
+
 static inline bool smr_vma_enabled(struct smr_ep *ep,
 				   struct smr_region *peer_smr)
 {
@@ -320,6 +338,41 @@ static inline bool smr_vma_enabled(struct smr_ep *ep,
 			peer_smr->xpmem_cap_self == SMR_VMA_CAP_ON);
 }
 
+/* The receiver will copy the data with CMA rather than XPMEM */
+static inline bool smr_cma_copy(struct smr_ep *ep, struct smr_region *peer_smr)
+{
+	if (ep->region == peer_smr)
+		return ep->region->cma_cap_self == SMR_VMA_CAP_ON &&
+		       ep->region->xpmem_cap_self != SMR_VMA_CAP_ON;
+	else
+		return ep->region->cma_cap_peer == SMR_VMA_CAP_ON &&
+		       peer_smr->xpmem_cap_self != SMR_VMA_CAP_ON;
+}
+
+/* Buckets of the calibrated CMA/SAR choice, 8KB to 4MB and up */
+#define SMR_CALIB_MIN_SIZE	(SMR_INJECT_SIZE * 2)
+#define SMR_CALIB_BUCKETS	10
+#define SMR_CALIB_MAX_SIZE	(SMR_CALIB_MIN_SIZE << (SMR_CALIB_BUCKETS - 1))
+
+extern uint8_t smr_calib_proto[SMR_CALIB_BUCKETS];
+
+static inline int smr_calib_select(uint64_t total_len)
+{
+	int i;
+
+	if (total_len >= SMR_CALIB_MAX_SIZE)
+		return smr_calib_proto[SMR_CALIB_BUCKETS - 1];
+
+	/* bucket i holds sizes up to SMR_CALIB_MIN_SIZE << i */
+	for (i = 0; (SMR_CALIB_MIN_SIZE << i) < total_len; i++)
+		;
+	return smr_calib_proto[i];
+}
+
+void smr_calib_init(void);
+void smr_calib_cleanup(void);
+void smr_calibrate(void);
+
 static inline bool smr_ze_ipc_enabled(struct smr_region *smr,
 				      struct smr_region *peer_smr)
 {
@@ -190,7 +190,7 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 
 	id = smr_verify_peer(ep, addr);
 	if (id < 0)
-		return -FI_EAGAIN;
+		return id;
 
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
@@ -259,6 +259,7 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 
 	smr_format_rma_ioc(&ce->rma_cmd, rma_ioc, rma_count);
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 unlock:
 	ofi_genlock_unlock(&ep->util_ep.lock);
 	return ret;
@@ -338,7 +339,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 
 	id = smr_verify_peer(ep, dest_addr);
 	if (id < 0)
-		return -FI_EAGAIN;
+		return id;
 
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
@@ -378,6 +379,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 
 	smr_format_rma_ioc(&ce->rma_cmd, &rma_ioc, 1);
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, ofi_op_atomic);
 out:
 	return ret;
@@ -55,7 +55,8 @@ static fi_addr_t smr_get_addr(struct fi_peer_rx_entry *rx_entry)
 {
 	struct smr_cmd_ctx *cmd_ctx = rx_entry->peer_context;
 
-	return cmd_ctx->ep->region->map->peers[cmd_ctx->cmd.msg.hdr.id].fiaddr;
+	return smr_map_peer(cmd_ctx->ep->region->map,
+			    cmd_ctx->cmd.msg.hdr.id)->fiaddr;
 }
 
 
@@ -84,7 +85,8 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 		FI_INFO(&smr_prov, FI_LOG_AV, "%s\n", (const char *) addr);
 
 		util_addr = FI_ADDR_NOTAVAIL;
-		if (smr_av->used < SMR_MAX_PEERS) {
+		shm_id = -1;
+		if (smr_av->used < smr_av->smr_map->max_peers) {
 			ret = smr_map_add(&smr_prov, smr_av->smr_map,
 					  addr, &shm_id);
 			if (!ret) {
@@ -112,12 +114,14 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			continue;
 		}
 
-		assert(shm_id >= 0 && shm_id < SMR_MAX_PEERS);
+		assert(shm_id >= 0 && shm_id < smr_av->smr_map->max_peers);
 		if (flags & FI_AV_USER_ID) {
 			assert(fi_addr);
-			smr_av->smr_map->peers[shm_id].fiaddr = fi_addr[i];
+			smr_map_peer(smr_av->smr_map, shm_id)->fiaddr =
+				fi_addr[i];
 		} else {
-			smr_av->smr_map->peers[shm_id].fiaddr = util_addr;
+			smr_map_peer(smr_av->smr_map, shm_id)->fiaddr =
+				util_addr;
 		}
 		succ_count++;
 		smr_av->used++;
@@ -132,7 +136,8 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			smr_ep = container_of(util_ep, struct smr_ep, util_ep);
 			smr_map_to_endpoint(smr_ep->region, shm_id);
 			smr_ep->region->max_sar_buf_per_peer =
-				SMR_MAX_PEERS / smr_av->smr_map->num_peers;
+				smr_sar_bufs_per_peer(
+					smr_av->smr_map->num_peers);
 			srx = smr_get_peer_srx(smr_ep);
 			srx->owner_ops->foreach_unspec_addr(srx, &smr_get_addr);
 		}
@@ -176,13 +181,9 @@ static int smr_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr, size_t count
 			util_ep = container_of(av_entry, struct util_ep, av_entry);
 			smr_ep = container_of(util_ep, struct smr_ep, util_ep);
 			smr_unmap_from_endpoint(smr_ep->region, id);
-			if (smr_av->smr_map->num_peers > 0)
-				smr_ep->region->max_sar_buf_per_peer =
-					SMR_MAX_PEERS /
-					smr_av->smr_map->num_peers;
-			else
-				smr_ep->region->max_sar_buf_per_peer =
-					SMR_BUF_BATCH_MAX;
+			smr_ep->region->max_sar_buf_per_peer =
+				smr_sar_bufs_per_peer(
+					smr_av->smr_map->num_peers);
 		}
 		smr_av->used--;
 	}
@@ -203,7 +204,7 @@ static int smr_av_lookup(struct fid_av *av, fi_addr_t fi_addr, void *addr,
 	smr_av = container_of(util_av, struct smr_av, util_av);
 
 	id = smr_addr_lookup(util_av, fi_addr);
-	name = smr_av->smr_map->peers[id].peer.name;
+	name = smr_map_peer(smr_av->smr_map, id)->peer.name;
 
 	strncpy((char *) addr, name, *addrlen);
 
@@ -271,7 +272,7 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 	util_attr.addrlen = sizeof(int64_t);
 	util_attr.context_len = 0;
 	util_attr.flags = 0;
-	if (attr->count > SMR_MAX_PEERS) {
+	if (attr->count > smr_env.max_peers) {
 		FI_INFO(&smr_prov, FI_LOG_AV,
 			"count %d exceeds max peers\n", (int) attr->count);
 		ret = -FI_ENOSYS;
@@ -287,7 +288,7 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 	(*av)->fid.ops = &smr_av_fi_ops;
 	(*av)->ops = &smr_av_ops;
 
-	ret = smr_map_create(&smr_prov, SMR_MAX_PEERS,
+	ret = smr_map_create(&smr_prov, smr_env.max_peers,
 			     util_domain->info_domain_caps & FI_HMEM ?
 			     SMR_FLAG_HMEM_ENABLED : 0, &smr_av->smr_map);
 	if (ret)
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "smr.h"
+#include "ofi_cma.h"
+
+/*
+ * Protocol calibration.
+ *
+ * Above the inject size, host memory messages go either through CMA,
+ * where the receiver copies straight out of the sender's buffer with
+ * one system call, or through SAR, where both sides copy through 32KB
+ * bounce buffers.  The system call and page pinning make CMA slow for
+ * medium messages on some hosts, while SAR pays for a second copy.
+ *
+ * Once per process, time both for each power of two size bucket and
+ * find the crossover, the smallest size at which CMA wins.  SAR is used
+ * below it.  The SAR time covers the two copies through a bounce buffer
+ * but not the handshakes between the peers, so SAR must be twice as
+ * fast, and larger sizes, where cache effects skew the comparison, are
+ * not considered once CMA has won.  SAR also needs both peers to run at
+ * the same time, so it is not considered on a single cpu.  XPMEM copies
+ * are plain memcpys and are always preferred over SAR.
+ */
+
+#define SMR_CALIB_BYTES		(2 * 1024 * 1024)
+#define SMR_CALIB_REPEAT	3
+/* SAR must take at most this share (in percent) of the CMA time */
+#define SMR_CALIB_SAR_PCT	50
+
+uint8_t smr_calib_proto[SMR_CALIB_BUCKETS];
+
+static ofi_mutex_t smr_calib_lock;
+static bool smr_calib_done;
+
+static void smr_calib_sar_copy(char *dst, const char *src, char *bounce,
+			       size_t len)
+{
+	size_t seg;
+
+	for (; len; len -= seg, src += seg, dst += seg) {
+		seg = MIN(len, SMR_SAR_SIZE);
+		memcpy(bounce, src, seg);
+		memcpy(dst, bounce, seg);
+	}
+}
+
+static int smr_calib_cma_copy(char *dst, char *src, size_t len)
+{
+	struct iovec local, remote;
+
+	local.iov_base = dst;
+	local.iov_len = len;
+	remote.iov_base = src;
+	remote.iov_len = len;
+	return cma_copy(&local, 1, &remote, 1, len, getpid(), false, NULL);
+}
+
+/* Best time in ns of copying len bytes, or 0 if CMA failed */
+static uint64_t smr_calib_time(char *dst, char *src, char *bounce,
+			       size_t len, bool cma)
+{
+	uint64_t start, best = UINT64_MAX;
+	size_t i, iters;
+	int r;
+
+	iters = MAX(SMR_CALIB_BYTES / len, 1);
+	for (r = 0; r < SMR_CALIB_REPEAT; r++) {
+		start = ofi_gettime_ns();
+		for (i = 0; i < iters; i++) {
+			if (!cma)
+				smr_calib_sar_copy(dst, src, bounce, len);
+			else if (smr_calib_cma_copy(dst, src, len))
+				return 0;
+		}
+		best = MIN(best, (ofi_gettime_ns() - start) / iters);
+	}
+	return MAX(best, 1);
+}
+
+static void smr_calib_run(void)
+{
+	uint64_t cma_ns, sar_ns;
+	char *src, *dst, *bounce;
+	size_t len;
+	int i;
+
+	src = malloc(SMR_CALIB_MAX_SIZE);
+	dst = malloc(SMR_CALIB_MAX_SIZE);
+	bounce = malloc(SMR_SAR_SIZE);
+	if (!src || !dst || !bounce)
+		goto out;
+
+	memset(src, 0xa5, SMR_CALIB_MAX_SIZE);
+	memset(dst, 0, SMR_CALIB_MAX_SIZE);
+	memset(bounce, 0, SMR_SAR_SIZE);
+
+	for (i = 0; i < SMR_CALIB_BUCKETS; i++) {
+		len = SMR_CALIB_MIN_SIZE << i;
+		cma_ns = smr_calib_time(dst, src, bounce, len, true);
+		if (!cma_ns) {
+			FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+				"CMA unavailable, skipping calibration\n");
+			goto out;
+		}
+		sar_ns = smr_calib_time(dst, src, bounce, len, false);
+
+		FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+			"%zu bytes: cma %" PRIu64 " ns, sar %" PRIu64 " ns\n",
+			len, cma_ns, sar_ns);
+		if (sar_ns * 100 > cma_ns * SMR_CALIB_SAR_PCT)
+			break;
+		smr_calib_proto[i] = smr_src_sar;
+	}
+	FI_INFO(&smr_prov, FI_LOG_EP_CTRL, "using sar up to %zu bytes\n",
+		i ? (size_t) SMR_CALIB_MIN_SIZE << (i - 1) :
+		(size_t) SMR_INJECT_SIZE);
+out:
+	free(src);
+	free(dst);
+	free(bounce);
+}
+
+void smr_calibrate(void)
+{
+	ofi_mutex_lock(&smr_calib_lock);
+	if (!smr_calib_done) {
+		if (ofi_sysconf(_SC_NPROCESSORS_ONLN) > 1)
+			smr_calib_run();
+		smr_calib_done = true;
+	}
+	ofi_mutex_unlock(&smr_calib_lock);
+}
+
+void smr_calib_init(void)
+{
+	int i;
+
+	ofi_mutex_init(&smr_calib_lock);
+	for (i = 0; i < SMR_CALIB_BUCKETS; i++)
+		smr_calib_proto[i] = smr_src_iov;
+}
+
+void smr_calib_cleanup(void)
+{
+	ofi_mutex_destroy(&smr_calib_lock);
+}
@@ -32,14 +32,35 @@
 
 #include "smr.h"
 
+static int smr_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold,
+			 int timeout)
+{
+	return ofi_doorbell_cntr_wait(cntr_fid, threshold, timeout,
+				      smr_env.wait_spin, smr_ep_doorbell);
+}
+
+struct fi_ops_cntr smr_cntr_sleep_ops = {
+	.size = sizeof(struct fi_ops_cntr),
+	.read = ofi_cntr_read,
+	.readerr = ofi_cntr_readerr,
+	.add = ofi_cntr_add,
+	.adderr = ofi_cntr_adderr,
+	.set = ofi_cntr_set,
+	.seterr = ofi_cntr_seterr,
+	.wait = smr_cntr_wait,
+};
+
 int smr_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 		  struct fid_cntr **cntr_fid, void *context)
 {
 	int ret;
 	struct util_cntr *cntr;
+	bool sleep = false;
 
 	switch (attr->wait_obj) {
 	case FI_WAIT_UNSPEC:
+		/* See smr_cq_open */
+		sleep = !(attr->flags & FI_PEER);
 		attr->wait_obj = FI_WAIT_YIELD;
 		/* fall through */
 	case FI_WAIT_NONE:
@@ -59,6 +80,9 @@ int smr_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 	if (ret)
 		goto free;
 
+	if (sleep)
+		cntr->cntr_fid.ops = &smr_cntr_sleep_ops;
+
 	*cntr_fid = &cntr->cntr_fid;
 	return FI_SUCCESS;
 
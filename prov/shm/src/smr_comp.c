@@ -40,14 +40,16 @@
 int smr_complete_tx(struct smr_ep *ep, void *context, uint32_t op,
 		    uint64_t flags)
 {
-	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
+	int ret = 0;
 
-	if (!(flags & FI_COMPLETION))
-		return 0;
+	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
 
-	return ofi_peer_cq_write(ep->util_ep.tx_cq, context,
-				 ofi_tx_cq_flags(op), 0, NULL, 0, 0,
-				 FI_ADDR_NOTAVAIL);
+	if (flags & FI_COMPLETION)
+		ret = ofi_peer_cq_write(ep->util_ep.tx_cq, context,
+					ofi_tx_cq_flags(op), 0, NULL, 0, 0,
+					FI_ADDR_NOTAVAIL);
+	ofi_doorbell_ring(&ep->region->doorbell);
+	return ret;
 }
 
 int smr_write_err_comp(struct util_cq *cq, void *context,
@@ -68,13 +70,15 @@ int smr_complete_rx(struct smr_ep *ep, void *context, uint32_t op,
 		    uint64_t flags, size_t len, void *buf, int64_t id,
 		    uint64_t tag, uint64_t data)
 {
-	ofi_ep_peer_rx_cntr_inc(&ep->util_ep, op);
+	int ret = 0;
 
-	if (!(flags & (FI_REMOTE_CQ_DATA | FI_COMPLETION)))
-		return 0;
-
-	flags &= ~FI_COMPLETION;
+	ofi_ep_peer_rx_cntr_inc(&ep->util_ep, op);
 
-	return ofi_peer_cq_write(ep->util_ep.rx_cq, context, flags, len, buf,
-				 data, tag, ep->region->map->peers[id].fiaddr);
+	if (flags & (FI_REMOTE_CQ_DATA | FI_COMPLETION))
+		ret = ofi_peer_cq_write(ep->util_ep.rx_cq, context,
+					flags & ~FI_COMPLETION, len, buf, data,
+					tag,
+					smr_map_peer(ep->region->map, id)->fiaddr);
+	ofi_doorbell_ring(&ep->region->doorbell);
+	return ret;
 }
\ No newline at end of file
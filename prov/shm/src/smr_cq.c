@@ -35,14 +35,49 @@
 
 #include "smr.h"
 
+static ssize_t smr_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
+				fi_addr_t *src_addr, const void *cond,
+				int timeout)
+{
+	return ofi_doorbell_cq_sreadfrom(cq_fid, buf, count, src_addr, timeout,
+					 smr_env.wait_spin, smr_ep_doorbell);
+}
+
+static ssize_t smr_cq_sread(struct fid_cq *cq_fid, void *buf, size_t count,
+			    const void *cond, int timeout)
+{
+	return smr_cq_sreadfrom(cq_fid, buf, count, NULL, cond, timeout);
+}
+
+static int smr_cq_signal(struct fid_cq *cq_fid)
+{
+	return ofi_doorbell_cq_signal(cq_fid, smr_ep_doorbell);
+}
+
+struct fi_ops_cq smr_cq_sleep_ops = {
+	.size = sizeof(struct fi_ops_cq),
+	.read = ofi_cq_read,
+	.readfrom = ofi_cq_readfrom,
+	.readerr = ofi_cq_readerr,
+	.sread = smr_cq_sread,
+	.sreadfrom = smr_cq_sreadfrom,
+	.signal = smr_cq_signal,
+	.strerror = ofi_cq_strerror,
+};
+
 int smr_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		struct fid_cq **cq_fid, void *context)
 {
 	struct util_cq *cq;
+	bool sleep = false;
 	int ret;
 
 	switch (attr->wait_obj) {
 	case FI_WAIT_UNSPEC:
+		/* Sleeps on a futex, which is not a wait object the app can
+		 * use, so it is reported as a yield wait.  A peer CQ is
+		 * waited on through its owner. */
+		sleep = !(attr->flags & FI_PEER);
 		attr->wait_obj = FI_WAIT_YIELD;
 		/* fall through */
 	case FI_WAIT_NONE:
@@ -62,6 +97,9 @@ int smr_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	if (ret)
 		return ret;
 
+	if (sleep)
+		cq->cq_fid.ops = &smr_cq_sleep_ops;
+
 	(*cq_fid) = &cq->cq_fid;
 
 	return FI_SUCCESS;
@@ -42,8 +42,13 @@
 #include "smr_signal.h"
 #include "smr.h"
 #include "smr_dsa.h"
+#include "smr_offload.h"
 #include "ofi_xpmem.h"
 
+#if defined(__x86_64__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 extern struct fi_ops_msg smr_msg_ops, smr_no_recv_msg_ops;
 extern struct fi_ops_tagged smr_tag_ops, smr_no_recv_tag_ops;
 extern struct fi_ops_rma smr_rma_ops;
@@ -207,6 +212,7 @@ static void smr_send_name(struct smr_ep *ep, int64_t id)
 
 	smr_peer_data(ep->region)[id].name_sent = 1;
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 }
 
 int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
@@ -215,20 +221,26 @@ int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
 	int ret;
 
 	id = smr_addr_lookup(ep->util_ep.av, fi_addr);
-	assert(id < SMR_MAX_PEERS);
+	assert(id < ep->region->max_peers);
 
+	smr_peer_data_reserve(ep->region, id);
 	if (smr_peer_data(ep->region)[id].addr.id >= 0)
 		return id;
 
-	if (ep->region->map->peers[id].peer.id < 0) {
+	if (smr_map_peer(ep->region->map, id)->peer.id < 0) {
 		ret = smr_map_to_region(&smr_prov, ep->region->map, id);
-		if (ret == -ENOENT)
-			return -1;
+		/* A peer that is not up yet may be retried, a mismatched
+		 * one never maps */
+		if (ret)
+			return ret == -FI_EINVAL ? ret : -FI_EAGAIN;
 	}
 
+	if (!smr_peer_data(ep->region)[id].addr.name[0])
+		smr_map_to_endpoint(ep->region, id);
+
 	smr_send_name(ep, id);
 
-	return -1;
+	return -FI_EAGAIN;
 }
 
 void smr_format_pend_resp(struct smr_tx_entry *pend, struct smr_cmd *cmd,
@@ -443,6 +455,141 @@ remove_entry:
 	return ret;
 }
 
+#if defined(__x86_64__) && defined(__SSE2__)
+/* Stores bypass the cache; callers must fence before publishing */
+static void smr_memcpy_nt(void *dst, const void *src, size_t len)
+{
+	__m128i v0, v1, v2, v3;
+	const char *s = src;
+	char *d = dst;
+	size_t head;
+
+	head = MIN(len, (size_t) (-(uintptr_t) d & 15));
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	for (; len >= 64; len -= 64, d += 64, s += 64) {
+		v0 = _mm_loadu_si128((const __m128i *) s);
+		v1 = _mm_loadu_si128((const __m128i *) (s + 16));
+		v2 = _mm_loadu_si128((const __m128i *) (s + 32));
+		v3 = _mm_loadu_si128((const __m128i *) (s + 48));
+		_mm_stream_si128((__m128i *) d, v0);
+		_mm_stream_si128((__m128i *) (d + 16), v1);
+		_mm_stream_si128((__m128i *) (d + 32), v2);
+		_mm_stream_si128((__m128i *) (d + 48), v3);
+	}
+	memcpy(d, s, len);
+}
+
+static inline void smr_nt_fence(void)
+{
+	_mm_sfence();
+}
+#else
+#define smr_memcpy_nt memcpy
+
+static inline void smr_nt_fence(void)
+{
+}
+#endif
+
+static size_t smr_copy_from_iov_nt(void *buf, size_t size,
+				   const struct iovec *iov, size_t count,
+				   size_t offset)
+{
+	size_t done = 0, len, i;
+	char *iov_buf;
+
+	for (i = 0; i < count && size; i++) {
+		len = ofi_iov_bytes_to_copy(&iov[i], &size, &offset, &iov_buf);
+		if (!len)
+			continue;
+		smr_memcpy_nt((char *) buf + done, iov_buf, len);
+		done += len;
+	}
+	return done;
+}
+
+/*
+ * Fill up to max_segs free buffers of a pipelined transfer.  Copies
+ * into the peer's region are not read again by this process, so large
+ * host transfers use non-temporal stores to keep the cache for the
+ * application.
+ */
+static size_t smr_pipe_copy_to_sar(struct smr_freestack *sar_pool,
+				   struct smr_cmd *cmd, struct ofi_mr **mr,
+				   const struct iovec *iov, size_t count,
+				   size_t *bytes_done, size_t max_segs)
+{
+	struct smr_sar_buf *sar_buf;
+	size_t start = *bytes_done, seg, len;
+	bool nt;
+
+	nt = cmd->msg.hdr.size >= smr_env.sar_nt_threshold &&
+	     ofi_mr_all_host(mr, count);
+
+	for (seg = *bytes_done / SMR_SAR_SIZE;
+	     *bytes_done < cmd->msg.hdr.size && max_segs; seg++, max_segs--) {
+		sar_buf = smr_freestack_get_entry_from_index(sar_pool,
+			cmd->msg.data.sar[seg % cmd->msg.data.buf_batch_size]);
+		if (sar_buf->seq)
+			break;
+
+		ofi_rmb();
+		len = MIN(cmd->msg.hdr.size - *bytes_done, SMR_SAR_SIZE);
+		if (nt)
+			smr_copy_from_iov_nt(sar_buf->buf, len, iov, count,
+					     *bytes_done);
+		else
+			ofi_copy_from_mr_iov(sar_buf->buf, len, mr, iov, count,
+					     *bytes_done);
+		*bytes_done += len;
+
+		if (nt)
+			smr_nt_fence();
+		ofi_wmb();
+		sar_buf->seq = seg + 1;
+	}
+
+	return *bytes_done - start;
+}
+
+static size_t smr_pipe_copy_from_sar(struct smr_freestack *sar_pool,
+				     struct smr_resp *resp, struct smr_cmd *cmd,
+				     struct ofi_mr **mr,
+				     const struct iovec *iov, size_t count,
+				     size_t *bytes_done)
+{
+	struct smr_sar_buf *sar_buf;
+	size_t start = *bytes_done, seg, len;
+
+	for (seg = *bytes_done / SMR_SAR_SIZE;
+	     *bytes_done < cmd->msg.hdr.size; seg++) {
+		sar_buf = smr_freestack_get_entry_from_index(sar_pool,
+			cmd->msg.data.sar[seg % cmd->msg.data.buf_batch_size]);
+		if (sar_buf->seq != seg + 1)
+			break;
+
+		ofi_rmb();
+		len = MIN(cmd->msg.hdr.size - *bytes_done, SMR_SAR_SIZE);
+		ofi_copy_to_mr_iov(mr, iov, count, *bytes_done, sar_buf->buf,
+				   len);
+		*bytes_done += len;
+
+		/* The copy must finish before the writer may reuse the buffer */
+		ofi_wmb();
+		sar_buf->seq = 0;
+	}
+
+	if (*bytes_done == cmd->msg.hdr.size && *bytes_done != start) {
+		ofi_wmb();
+		resp->status = SMR_STATUS_SAR_EMPTY;
+	}
+	return *bytes_done - start;
+}
+
 size_t smr_copy_to_sar(struct smr_freestack *sar_pool, struct smr_resp *resp,
 		       struct smr_cmd *cmd, struct ofi_mr **mr,
 		       const struct iovec *iov, size_t count,
@@ -452,6 +599,10 @@ size_t smr_copy_to_sar(struct smr_freestack *sar_pool, struct smr_resp *resp,
 	size_t start = *bytes_done;
 	int next_sar_buf = 0;
 
+	if (cmd->msg.hdr.op_flags & SMR_SAR_PIPE)
+		return smr_pipe_copy_to_sar(sar_pool, cmd, mr, iov, count,
+					    bytes_done, SIZE_MAX);
+
 	if (resp->status != SMR_STATUS_SAR_EMPTY)
 		return 0;
 
@@ -483,6 +634,10 @@ size_t smr_copy_from_sar(struct smr_freestack *sar_pool, struct smr_resp *resp,
 	size_t start = *bytes_done;
 	int next_sar_buf = 0;
 
+	if (cmd->msg.hdr.op_flags & SMR_SAR_PIPE)
+		return smr_pipe_copy_from_sar(sar_pool, resp, cmd, mr, iov,
+					      count, bytes_done);
+
 	if (resp->status != SMR_STATUS_SAR_FULL)
 		return 0;
 
@@ -509,6 +664,7 @@ static int smr_format_sar(struct smr_ep *ep, struct smr_cmd *cmd,
 		   struct smr_region *peer_smr, int64_t id,
 		   struct smr_tx_entry *pending, struct smr_resp *resp)
 {
+	struct smr_sar_buf *sar_buf;
 	int i, ret;
 	uint32_t sar_needed;
 
@@ -549,11 +705,36 @@ static int smr_format_sar(struct smr_ep *ep, struct smr_cmd *cmd,
 	if (!cmd->msg.hdr.size)
 		goto out;
 
+	if (smr_env.sar_pipeline && !smr_env.use_dsa_sar &&
+	    !ep->offload_context) {
+		cmd->msg.hdr.op_flags |= SMR_SAR_PIPE;
+		resp->status = SMR_STATUS_SAR_PIPE;
+		for (i = 0; i < cmd->msg.data.buf_batch_size; i++) {
+			sar_buf = smr_freestack_get_entry_from_index(
+				smr_sar_pool(peer_smr), cmd->msg.data.sar[i]);
+			sar_buf->seq = 0;
+		}
+
+		/* Post the command early so that the peer can start
+		 * draining while the rest is copied in */
+		if (cmd->msg.hdr.op != ofi_op_read_req)
+			smr_pipe_copy_to_sar(smr_sar_pool(peer_smr), cmd, mr,
+					     iov, count, &pending->bytes_done,
+					     SMR_SAR_PIPE_PREFILL);
+		goto out;
+	}
+
 	if (cmd->msg.hdr.op != ofi_op_read_req) {
-		if (smr_env.use_dsa_sar && ofi_mr_all_host(mr, count)) {
-			ret = smr_dsa_copy_to_sar(ep, smr_sar_pool(peer_smr),
-					resp, cmd, iov,	count,
-					&pending->bytes_done, pending);
+		if ((smr_env.use_dsa_sar || ep->offload_context) &&
+		    ofi_mr_all_host(mr, count)) {
+			if (smr_env.use_dsa_sar)
+				ret = smr_dsa_copy_to_sar(ep,
+					smr_sar_pool(peer_smr), resp, cmd, iov,
+					count, &pending->bytes_done, pending);
+			else
+				ret = smr_offload_copy_to_sar(ep,
+					smr_sar_pool(peer_smr), resp, cmd, iov,
+					count, &pending->bytes_done, pending);
 			if (ret != FI_SUCCESS) {
 				for (i = cmd->msg.data.buf_batch_size - 1;
 				     i >= 0; i--) {
@@ -573,8 +754,8 @@ out:
 	return FI_SUCCESS;
 }
 
-int smr_select_proto(void **desc, size_t iov_count,
-                     bool vma_avail, uint32_t op, uint64_t total_len,
+int smr_select_proto(void **desc, size_t iov_count, bool vma_avail,
+		     bool cma_copy, uint32_t op, uint64_t total_len,
 		     uint64_t op_flags)
 {
 	struct ofi_mr *smr_desc;
@@ -619,7 +800,8 @@ int smr_select_proto(void **desc, size_t iov_count,
 	if (use_ipc)
 		return smr_src_ipc;
 
-	if (total_len > SMR_INJECT_SIZE && vma_avail)
+	if (total_len > SMR_INJECT_SIZE && vma_avail &&
+	    !(cma_copy && smr_calib_select(total_len) == smr_src_sar))
 		return smr_src_iov;
 
 	if (op_flags & FI_DELIVERY_COMPLETE)
@@ -819,6 +1001,8 @@ static int smr_ep_close(struct fid *fid)
 
 	if (smr_env.use_dsa_sar)
 		smr_dsa_context_cleanup(ep);
+	else if (ep->offload_context)
+		smr_offload_context_cleanup(ep);
 
 	if (ep->sock_info) {
 		fd_signal_set(&ep->sock_info->signal);
@@ -826,6 +1010,7 @@ static int smr_ep_close(struct fid *fid)
 		close(ep->sock_info->listen_sock);
 		unlink(ep->sock_info->name);
 		smr_cleanup_epoll(ep->sock_info);
+		free(ep->sock_info->peers);
 		free(ep->sock_info);
 	}
 
@@ -834,8 +1019,11 @@ static int smr_ep_close(struct fid *fid)
 
 	ofi_endpoint_close(&ep->util_ep);
 
-	if (ep->region)
+	if (ep->region) {
+		/* waits armed before the CQ and counter unbind must let go */
+		ofi_doorbell_drain(&ep->region->doorbell);
 		smr_free(ep->region);
+	}
 
 	if (ep->cmd_ctx_pool)
 		ofi_bufpool_destroy(ep->cmd_ctx_pool);
@@ -993,7 +1181,8 @@ static void *smr_start_listener(void *args)
 {
 	struct smr_ep *ep = (struct smr_ep *) args;
 	struct sockaddr_un sockaddr;
-	struct ofi_epollfds_event events[SMR_MAX_PEERS + 1];
+	/* listen socket and close signal */
+	struct ofi_epollfds_event events[2];
 	int i, ret, poll_fds, sock = -1;
 	int peer_fds[ZE_MAX_DEVICES];
 	socklen_t len = sizeof(sockaddr);
@@ -1002,7 +1191,7 @@ static void *smr_start_listener(void *args)
 	ep->region->flags |= SMR_FLAG_IPC_SOCK;
 	while (1) {
 		poll_fds = ofi_epoll_wait(ep->sock_info->epollfd, events,
-					  SMR_MAX_PEERS + 1, -1);
+					  ARRAY_SIZE(events), -1);
 
 		if (poll_fds < 0) {
 			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
@@ -1165,6 +1354,11 @@ static void smr_init_ipc_socket(struct smr_ep *ep)
 	if (!ep->sock_info)
 		goto err_out;
 
+	ep->sock_info->peers = calloc(ep->region->max_peers,
+				      sizeof(*ep->sock_info->peers));
+	if (!ep->sock_info->peers)
+		goto free;
+
 	ep->sock_info->listen_sock = socket(AF_UNIX, SOCK_STREAM, 0);
 	if (ep->sock_info->listen_sock < 0)
 		goto free;
@@ -1181,7 +1375,7 @@ static void smr_init_ipc_socket(struct smr_ep *ep)
 	if (ret)
 		goto close;
 
-	ret = listen(ep->sock_info->listen_sock, SMR_MAX_PEERS);
+	ret = listen(ep->sock_info->listen_sock, SOMAXCONN);
 	if (ret)
 		goto close;
 
@@ -1223,6 +1417,7 @@ close:
 	close(ep->sock_info->listen_sock);
 	unlink(sockaddr.sun_path);
 free:
+	free(ep->sock_info->peers);
 	free(ep->sock_info);
 	ep->sock_info = NULL;
 err_out:
@@ -1346,6 +1541,10 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 		if (ret)
 			return ret;
 
+		if (ofi_doorbell_ep_sleeps(&ep->util_ep, &smr_cq_sleep_ops,
+					   &smr_cntr_sleep_ops))
+			ofi_doorbell_enable(&ep->region->doorbell);
+
 		if (ep->util_ep.caps & FI_HMEM || smr_env.disable_cma) {
 			ep->region->cma_cap_peer = SMR_VMA_CAP_OFF;
 			ep->region->cma_cap_self = SMR_VMA_CAP_OFF;
@@ -1392,6 +1591,11 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 
 		if (smr_env.use_dsa_sar)
 			smr_dsa_context_init(ep);
+		if (!smr_env.use_dsa_sar && smr_env.offload_threads)
+			smr_offload_context_init(ep);
+		if (!smr_env.use_dsa_sar && !ep->offload_context &&
+		    smr_env.calibrate)
+			smr_calibrate();
 
 		/* if XPMEM is on after exchanging peer info, then set the
 		 * endpoint p2p to XPMEM so it can be used on the fast
@@ -36,6 +36,7 @@
 #include "smr.h"
 #include "smr_signal.h"
 #include "smr_dsa.h"
+#include "smr_offload.h"
 #include <ofi_hmem.h>
 
 struct sigaction *old_action = NULL;
@@ -46,6 +47,11 @@ struct smr_env smr_env = {
 	.use_dsa_sar = false,
 	.max_gdrcopy_size = 3072,
 	.use_xpmem = false,
+	.max_peers = SMR_MAX_PEERS,
+	.wait_spin = 50,
+	.calibrate = true,
+	.sar_pipeline = false,
+	.sar_nt_threshold = 4 * 1024 * 1024,
 };
 
 static void smr_init_env(void)
@@ -56,6 +62,27 @@ static void smr_init_env(void)
 	fi_param_get_bool(&smr_prov, "disable_cma", &smr_env.disable_cma);
 	fi_param_get_bool(&smr_prov, "use_dsa_sar", &smr_env.use_dsa_sar);
 	fi_param_get_bool(&smr_prov, "use_xpmem", &smr_env.use_xpmem);
+	fi_param_get_size_t(&smr_prov, "max_peers", &smr_env.max_peers);
+	if (!smr_env.max_peers || smr_env.max_peers > INT32_MAX) {
+		FI_WARN(&smr_prov, FI_LOG_CORE,
+			"invalid max_peers %zu, using %d\n",
+			smr_env.max_peers, SMR_MAX_PEERS);
+		smr_env.max_peers = SMR_MAX_PEERS;
+	}
+	/* Spinning only delays the peer when there is a single cpu */
+	if (ofi_sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+		smr_env.wait_spin = 0;
+	fi_param_get_int(&smr_prov, "wait_spin", &smr_env.wait_spin);
+	fi_param_get_bool(&smr_prov, "calibrate", &smr_env.calibrate);
+	fi_param_get_bool(&smr_prov, "sar_pipeline", &smr_env.sar_pipeline);
+	fi_param_get_size_t(&smr_prov, "sar_nt_threshold",
+			    &smr_env.sar_nt_threshold);
+	fi_param_get_int(&smr_prov, "offload_threads",
+			 &smr_env.offload_threads);
+	fi_param_get_str(&smr_prov, "offload_affinity",
+			 &smr_env.offload_affinity);
+	if (smr_env.offload_threads < 0)
+		smr_env.offload_threads = 0;
 }
 
 static void smr_resolve_addr(const char *node, const char *service,
@@ -107,7 +134,7 @@ static int smr_shm_space_check(size_t tx_count, size_t rx_count)
 	}
 	shm_size_needed = num_of_core *
 			  smr_calculate_size_offsets(tx_count, rx_count,
-						     NULL, NULL, NULL,
+						     smr_env.max_peers, NULL, NULL, NULL,
 						     NULL, NULL, NULL,
 						     NULL);
 	err = statvfs(shm_fs, &stat);
@@ -181,6 +208,8 @@ static void smr_fini(void)
 	ofi_hmem_cleanup();
 #endif
 	smr_dsa_cleanup();
+	smr_offload_cleanup();
+	smr_calib_cleanup();
 	smr_cleanup();
 	free(old_action);
 }
@@ -226,8 +255,40 @@ SHM_INI
 	fi_param_define(&smr_prov, "use_xpmem", FI_PARAM_BOOL,
 			"Enable XPMEM over CMA when possible "
 			"(default: false)");
+	fi_param_define(&smr_prov, "max_peers", FI_PARAM_SIZE_T,
+			"Maximum number of peers per address vector, "
+			"including peers that connect without being "
+			"inserted.  Must match across processes "
+			"(default: 4096)");
+	fi_param_define(&smr_prov, "wait_spin", FI_PARAM_INT,
+			"Time in microseconds that a blocking CQ or counter "
+			"wait polls before sleeping.  Set to -1 to never "
+			"sleep (default: 50, or 0 with a single cpu)");
+	fi_param_define(&smr_prov, "calibrate", FI_PARAM_BOOL,
+			"Time CMA against SAR copies for each message size "
+			"when the first endpoint is enabled, and use the "
+			"faster one (default: true)");
+	fi_param_define(&smr_prov, "sar_pipeline", FI_PARAM_BOOL,
+			"Hand over SAR buffers one at a time so that the "
+			"sender and receiver copy in parallel.  Not used "
+			"with DSA (default: false)");
+	fi_param_define(&smr_prov, "sar_nt_threshold", FI_PARAM_SIZE_T,
+			"Message size from which pipelined SAR sends copy "
+			"into the peer with non-temporal stores "
+			"(default: 4194304)");
+	fi_param_define(&smr_prov, "offload_threads", FI_PARAM_INT,
+			"Number of helper threads that copy SAR buffers "
+			"asynchronously when DSA is not used.  0 copies "
+			"inline in progress (default: 0)");
+	fi_param_define(&smr_prov, "offload_affinity", FI_PARAM_STRING,
+			"Bind the copy threads to the indicated range(s) of "
+			"Linux virtual processor ID(s) instead of the cpus of "
+			"the local NUMA node. "
+			"Usage: id_start[-id_end[:stride]][,]");
 
 	smr_init_env();
+	smr_calib_init();
+	smr_offload_init();
 
 	if (smr_env.use_dsa_sar)
 		smr_dsa_init();
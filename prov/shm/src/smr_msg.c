@@ -94,7 +94,7 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 
 	id = smr_verify_peer(ep, addr);
 	if (id < 0)
-		return -FI_EAGAIN;
+		return id;
 
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
@@ -112,7 +112,8 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 	assert(!(op_flags & FI_INJECT) || total_len <= SMR_INJECT_SIZE);
 
 	proto = smr_select_proto(desc, iov_count, smr_vma_enabled(ep, peer_smr),
-	                         op, total_len, op_flags);
+				 smr_cma_copy(ep, peer_smr), op, total_len,
+				 op_flags);
 
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, op, tag, data, op_flags,
 				   (struct ofi_mr **)desc, iov, iov_count, total_len,
@@ -122,6 +123,7 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 		goto unlock;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 
 	if (proto != smr_src_inline && proto != smr_src_inject)
 		goto unlock;
@@ -198,7 +200,7 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 
 	id = smr_verify_peer(ep, dest_addr);
 	if (id < 0)
-		return -FI_EAGAIN;
+		return id;
 
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
@@ -218,6 +220,7 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 		return -FI_EAGAIN;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
 
 	return FI_SUCCESS;
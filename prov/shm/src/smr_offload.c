@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <glob.h>
+#include <sched.h>
+
+#include "ofi_file.h"
+#include "ofi_mb.h"
+#include "smr.h"
+#include "smr_offload.h"
+
+/*
+ * Software copy offload.
+ *
+ * A copy call splits a batch of SAR buffers into descriptors, one per
+ * contiguous piece, and queues them to a process-wide pool of helper
+ * threads.  The helpers are bound to the cpus of the NUMA node of the
+ * thread that enabled the first endpoint, unless FI_SHM_OFFLOAD_AFFINITY
+ * says otherwise.  Progress completes a command once all of its
+ * descriptors are copied and hands the buffers to the peer, the same
+ * way the DSA path does.
+ */
+
+#define SMR_OFFLOAD_CMD_COUNT	32
+#define SMR_OFFLOAD_MAX_DESC	(SMR_BUF_BATCH_MAX + SMR_IOV_LIMIT)
+#define SMR_OFFLOAD_CPULIST_LEN	1024
+
+struct smr_offload_cmd;
+
+struct smr_offload_desc {
+	struct slist_entry	entry;
+	struct smr_offload_cmd	*cmd;
+	void			*dst;
+	const void		*src;
+	size_t			len;
+};
+
+struct smr_offload_cmd {
+	struct smr_offload_desc	desc[SMR_OFFLOAD_MAX_DESC];
+	ofi_atomic32_t		pending;
+	size_t			bytes_in_progress;
+	int			dir;
+	uint32_t		op;
+	bool			busy;
+	/* struct smr_tx_entry or struct smr_pend_entry, see dsa_cmd_context */
+	void			*entry_ptr;
+};
+
+struct smr_offload_context {
+	struct smr_offload_cmd	cmd[SMR_OFFLOAD_CMD_COUNT];
+	int			busy_cnt;
+	unsigned long		copy_stats[2];
+};
+
+static struct {
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+	struct slist	queue;
+	pthread_t	*threads;
+	int		thread_cnt;
+	bool		stop;
+	char		affinity[SMR_OFFLOAD_CPULIST_LEN];
+} smr_offload_pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *smr_offload_thread(void *arg)
+{
+	struct smr_offload_desc *desc;
+	struct slist_entry *entry;
+	int ret;
+
+	if (*smr_offload_pool.affinity) {
+		ret = ofi_set_thread_affinity(smr_offload_pool.affinity);
+		if (ret)
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"unable to bind copy thread to cpus %s (%d)\n",
+				smr_offload_pool.affinity, ret);
+	}
+
+	pthread_mutex_lock(&smr_offload_pool.lock);
+	while (!smr_offload_pool.stop) {
+		if (slist_empty(&smr_offload_pool.queue)) {
+			pthread_cond_wait(&smr_offload_pool.cond,
+					  &smr_offload_pool.lock);
+			continue;
+		}
+		entry = slist_remove_head(&smr_offload_pool.queue);
+		pthread_mutex_unlock(&smr_offload_pool.lock);
+
+		desc = container_of(entry, struct smr_offload_desc, entry);
+		memcpy(desc->dst, desc->src, desc->len);
+		ofi_atomic_dec32(&desc->cmd->pending);
+
+		pthread_mutex_lock(&smr_offload_pool.lock);
+	}
+	pthread_mutex_unlock(&smr_offload_pool.lock);
+	return NULL;
+}
+
+/* The cpus of the NUMA node that the calling thread runs on */
+static void smr_offload_local_cpus(char *buf, size_t size)
+{
+	char path[64], dir[64];
+	glob_t node;
+	int cpu, len;
+
+	*buf = '\0';
+	cpu = sched_getcpu();
+	if (cpu < 0)
+		return;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node*",
+		 cpu);
+	if (glob(path, 0, NULL, &node))
+		return;
+
+	snprintf(dir, sizeof(dir), "/sys/devices/system/node/%s",
+		 strrchr(node.gl_pathv[0], '/') + 1);
+	globfree(&node);
+
+	len = fi_read_file(dir, "cpulist", buf, size - 1);
+	buf[len > 0 ? len : 0] = '\0';
+}
+
+/* Called with the pool lock held */
+static int smr_offload_start(void)
+{
+	int i, ret;
+
+	if (smr_offload_pool.thread_cnt)
+		return 0;
+
+	if (smr_env.offload_affinity)
+		snprintf(smr_offload_pool.affinity,
+			 sizeof(smr_offload_pool.affinity), "%s",
+			 smr_env.offload_affinity);
+	else
+		smr_offload_local_cpus(smr_offload_pool.affinity,
+				       sizeof(smr_offload_pool.affinity));
+
+	smr_offload_pool.threads = calloc(smr_env.offload_threads,
+					  sizeof(*smr_offload_pool.threads));
+	if (!smr_offload_pool.threads)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < smr_env.offload_threads; i++) {
+		ret = pthread_create(&smr_offload_pool.threads[i], NULL,
+				     smr_offload_thread, NULL);
+		if (ret) {
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"unable to create copy thread (%d)\n", ret);
+			break;
+		}
+	}
+	smr_offload_pool.thread_cnt = i;
+	if (!i) {
+		free(smr_offload_pool.threads);
+		smr_offload_pool.threads = NULL;
+		return -FI_EOTHER;
+	}
+
+	FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+		"started %d copy threads on cpus %s\n", i,
+		*smr_offload_pool.affinity ? smr_offload_pool.affinity : "any");
+	return 0;
+}
+
+static struct smr_offload_cmd *
+smr_offload_alloc_cmd(struct smr_offload_context *ctx)
+{
+	int i;
+
+	for (i = 0; i < SMR_OFFLOAD_CMD_COUNT; i++) {
+		if (!ctx->cmd[i].busy) {
+			ctx->cmd[i].busy = true;
+			ctx->busy_cnt++;
+			return &ctx->cmd[i];
+		}
+	}
+	return NULL;
+}
+
+static void smr_offload_free_cmd(struct smr_offload_context *ctx,
+				 struct smr_offload_cmd *ocmd)
+{
+	ocmd->busy = false;
+	ctx->busy_cnt--;
+}
+
+/* Split the next batch of the transfer into one descriptor per piece */
+static int smr_offload_prep(struct smr_offload_cmd *ocmd,
+			    struct smr_freestack *sar_pool,
+			    struct smr_cmd *cmd, const struct iovec *iov,
+			    size_t count, size_t bytes_done)
+{
+	struct smr_offload_desc *desc;
+	struct smr_sar_buf *sar_buf;
+	size_t offset, size, len, i;
+	char *sar, *iov_buf;
+	int seg, cnt = 0;
+
+	ocmd->bytes_in_progress = 0;
+	for (seg = 0; seg < cmd->msg.data.buf_batch_size &&
+	     bytes_done < cmd->msg.hdr.size; seg++) {
+		sar_buf = smr_freestack_get_entry_from_index(sar_pool,
+						cmd->msg.data.sar[seg]);
+		sar = (char *) sar_buf->buf;
+		size = MIN(cmd->msg.hdr.size - bytes_done, SMR_SAR_SIZE);
+		offset = bytes_done;
+
+		for (i = 0; i < count && size; i++) {
+			len = ofi_iov_bytes_to_copy(&iov[i], &size, &offset,
+						    &iov_buf);
+			if (!len)
+				continue;
+
+			assert(cnt < SMR_OFFLOAD_MAX_DESC);
+			desc = &ocmd->desc[cnt++];
+			desc->cmd = ocmd;
+			desc->len = len;
+			if (ocmd->dir == OFI_COPY_IOV_TO_BUF) {
+				desc->dst = sar;
+				desc->src = iov_buf;
+			} else {
+				desc->dst = iov_buf;
+				desc->src = sar;
+			}
+			sar += len;
+			bytes_done += len;
+			ocmd->bytes_in_progress += len;
+		}
+	}
+	return cnt;
+}
+
+static void smr_offload_submit(struct smr_offload_cmd *ocmd, int cnt)
+{
+	int i;
+
+	ofi_atomic_set32(&ocmd->pending, cnt);
+	pthread_mutex_lock(&smr_offload_pool.lock);
+	for (i = 0; i < cnt; i++)
+		slist_insert_tail(&ocmd->desc[i].entry,
+				  &smr_offload_pool.queue);
+	if (cnt > 1)
+		pthread_cond_broadcast(&smr_offload_pool.cond);
+	else
+		pthread_cond_signal(&smr_offload_pool.cond);
+	pthread_mutex_unlock(&smr_offload_pool.lock);
+}
+
+static ssize_t smr_offload_copy_sar(struct smr_ep *ep,
+		struct smr_freestack *sar_pool, struct smr_resp *resp,
+		struct smr_cmd *cmd, const struct iovec *iov, size_t count,
+		size_t *bytes_done, void *entry_ptr, int dir)
+{
+	struct smr_offload_context *ctx = ep->offload_context;
+	struct smr_offload_cmd *ocmd;
+	int cnt;
+
+	ocmd = smr_offload_alloc_cmd(ctx);
+	if (!ocmd)
+		return -FI_ENOMEM;
+
+	ocmd->dir = dir;
+	ocmd->op = cmd->msg.hdr.op;
+	ocmd->entry_ptr = entry_ptr;
+	cnt = smr_offload_prep(ocmd, sar_pool, cmd, iov, count, *bytes_done);
+	assert(cnt);
+
+	resp->status = SMR_STATUS_BUSY;
+	ctx->copy_stats[dir]++;
+	smr_offload_submit(ocmd, cnt);
+	return FI_SUCCESS;
+}
+
+ssize_t smr_offload_copy_to_sar(struct smr_ep *ep,
+		struct smr_freestack *sar_pool, struct smr_resp *resp,
+		struct smr_cmd *cmd, const struct iovec *iov, size_t count,
+		size_t *bytes_done, void *entry_ptr)
+{
+	assert(ep->offload_context);
+
+	if (resp->status != SMR_STATUS_SAR_EMPTY)
+		return -FI_EAGAIN;
+
+	return smr_offload_copy_sar(ep, sar_pool, resp, cmd, iov, count,
+				    bytes_done, entry_ptr,
+				    OFI_COPY_IOV_TO_BUF);
+}
+
+ssize_t smr_offload_copy_from_sar(struct smr_ep *ep,
+		struct smr_freestack *sar_pool, struct smr_resp *resp,
+		struct smr_cmd *cmd, const struct iovec *iov, size_t count,
+		size_t *bytes_done, void *entry_ptr)
+{
+	assert(ep->offload_context);
+
+	if (resp->status != SMR_STATUS_SAR_FULL)
+		return -FI_EAGAIN;
+
+	return smr_offload_copy_sar(ep, sar_pool, resp, cmd, iov, count,
+				    bytes_done, entry_ptr,
+				    OFI_COPY_BUF_TO_IOV);
+}
+
+/*
+ * The initiator of a transfer fills the SAR buffers of a send and drains
+ * those of a read.  Its resp lives in its own region and the peer waits
+ * on it.  The target's resp lives in the peer's region.
+ */
+static void smr_offload_complete(struct smr_ep *ep,
+				 struct smr_offload_cmd *ocmd)
+{
+	struct smr_tx_entry *tx_entry;
+	struct smr_pend_entry *sar_entry;
+	struct smr_region *peer_smr;
+	struct smr_resp *resp;
+	bool initiator;
+
+	initiator = (ocmd->op == ofi_op_read_req) ?
+		    ocmd->dir == OFI_COPY_BUF_TO_IOV :
+		    ocmd->dir == OFI_COPY_IOV_TO_BUF;
+
+	if (initiator) {
+		tx_entry = ocmd->entry_ptr;
+		tx_entry->bytes_done += ocmd->bytes_in_progress;
+		peer_smr = smr_peer_region(ep->region, tx_entry->peer_id);
+		resp = smr_get_ptr(ep->region, tx_entry->cmd.msg.hdr.src_data);
+	} else {
+		sar_entry = ocmd->entry_ptr;
+		sar_entry->bytes_done += ocmd->bytes_in_progress;
+		peer_smr = smr_peer_region(ep->region,
+					   sar_entry->cmd.msg.hdr.id);
+		resp = smr_get_ptr(peer_smr, sar_entry->cmd.msg.hdr.src_data);
+	}
+
+	assert(resp->status == SMR_STATUS_BUSY);
+	ofi_wmb();
+	resp->status = (ocmd->dir == OFI_COPY_IOV_TO_BUF ?
+			SMR_STATUS_SAR_FULL : SMR_STATUS_SAR_EMPTY);
+	ofi_doorbell_ring(&peer_smr->doorbell);
+}
+
+void smr_offload_progress(struct smr_ep *ep)
+{
+	struct smr_offload_context *ctx = ep->offload_context;
+	struct smr_offload_cmd *ocmd;
+	int i;
+
+	if (!ctx->busy_cnt)
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	for (i = 0; i < SMR_OFFLOAD_CMD_COUNT; i++) {
+		ocmd = &ctx->cmd[i];
+		if (!ocmd->busy || ofi_atomic_get32(&ocmd->pending))
+			continue;
+
+		/* Order the helpers' copies before the handoff */
+		ofi_rmb();
+		smr_offload_complete(ep, ocmd);
+		smr_offload_free_cmd(ctx, ocmd);
+	}
+	ofi_genlock_unlock(&ep->util_ep.lock);
+}
+
+void smr_offload_context_init(struct smr_ep *ep)
+{
+	struct smr_offload_context *ctx;
+	int i, ret;
+
+	pthread_mutex_lock(&smr_offload_pool.lock);
+	ret = smr_offload_start();
+	pthread_mutex_unlock(&smr_offload_pool.lock);
+	if (ret)
+		goto err;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"calloc failed for offload_context\n");
+		goto err;
+	}
+
+	for (i = 0; i < SMR_OFFLOAD_CMD_COUNT; i++)
+		ofi_atomic_initialize32(&ctx->cmd[i].pending, 0);
+	ep->offload_context = ctx;
+	return;
+
+err:
+	smr_env.offload_threads = 0;
+}
+
+void smr_offload_context_cleanup(struct smr_ep *ep)
+{
+	struct smr_offload_context *ctx = ep->offload_context;
+	int i;
+
+	if (!ctx)
+		return;
+
+	FI_INFO(&smr_prov, FI_LOG_EP_CTRL,
+		"offloaded copies: %lu to sar, %lu from sar\n",
+		ctx->copy_stats[OFI_COPY_IOV_TO_BUF],
+		ctx->copy_stats[OFI_COPY_BUF_TO_IOV]);
+
+	/* The helpers may still be copying descriptors of this context */
+	for (i = 0; i < SMR_OFFLOAD_CMD_COUNT; i++) {
+		while (ctx->cmd[i].busy &&
+		       ofi_atomic_get32(&ctx->cmd[i].pending))
+			sched_yield();
+	}
+
+	free(ep->offload_context);
+	ep->offload_context = NULL;
+}
+
+void smr_offload_init(void)
+{
+	slist_init(&smr_offload_pool.queue);
+}
+
+void smr_offload_cleanup(void)
+{
+	int i;
+
+	pthread_mutex_lock(&smr_offload_pool.lock);
+	smr_offload_pool.stop = true;
+	pthread_cond_broadcast(&smr_offload_pool.cond);
+	pthread_mutex_unlock(&smr_offload_pool.lock);
+
+	for (i = 0; i < smr_offload_pool.thread_cnt; i++)
+		pthread_join(smr_offload_pool.threads[i], NULL);
+
+	free(smr_offload_pool.threads);
+	smr_offload_pool.threads = NULL;
+	smr_offload_pool.thread_cnt = 0;
+}
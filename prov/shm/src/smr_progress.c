@@ -42,6 +42,7 @@
 #include "ofi_shm_p2p.h"
 #include "smr.h"
 #include "smr_dsa.h"
+#include "smr_offload.h"
 
 static inline void
 smr_try_progress_to_sar(struct smr_ep *ep, struct smr_region *smr,
@@ -50,14 +51,25 @@ smr_try_progress_to_sar(struct smr_ep *ep, struct smr_region *smr,
 			struct iovec *iov, size_t iov_count,
                         size_t *bytes_done, void *entry_ptr)
 {
+	size_t done;
+
 	if (*bytes_done < cmd->msg.hdr.size) {
-		if (smr_env.use_dsa_sar && ofi_mr_all_host(mr, iov_count)) {
+		if (smr_env.use_dsa_sar && !(cmd->msg.hdr.op_flags & SMR_SAR_PIPE) &&
+		    ofi_mr_all_host(mr, iov_count)) {
 			(void) smr_dsa_copy_to_sar(ep, sar_pool, resp, cmd, iov,
 					    iov_count, bytes_done, entry_ptr);
 			return;
+		} else if (ep->offload_context &&
+			   !(cmd->msg.hdr.op_flags & SMR_SAR_PIPE) &&
+			   ofi_mr_all_host(mr, iov_count)) {
+			(void) smr_offload_copy_to_sar(ep, sar_pool, resp, cmd,
+					iov, iov_count, bytes_done, entry_ptr);
 		} else {
+			done = *bytes_done;
 			smr_copy_to_sar(sar_pool, resp, cmd, mr, iov, iov_count,
 					bytes_done);
+			if (*bytes_done != done)
+				ofi_doorbell_ring(&smr->doorbell);
 		}
 	}
 }
@@ -69,14 +81,26 @@ smr_try_progress_from_sar(struct smr_ep *ep, struct smr_region *smr,
 			  struct iovec *iov, size_t iov_count,
                           size_t *bytes_done, void *entry_ptr)
 {
+	size_t done;
+
 	if (*bytes_done < cmd->msg.hdr.size) {
-		if (smr_env.use_dsa_sar && ofi_mr_all_host(mr, iov_count)) {
+		if (smr_env.use_dsa_sar && !(cmd->msg.hdr.op_flags & SMR_SAR_PIPE) &&
+		    ofi_mr_all_host(mr, iov_count)) {
 			(void) smr_dsa_copy_from_sar(ep, sar_pool, resp, cmd,
 					iov, iov_count, bytes_done, entry_ptr);
 			return;
+		} else if (ep->offload_context &&
+			   !(cmd->msg.hdr.op_flags & SMR_SAR_PIPE) &&
+			   ofi_mr_all_host(mr, iov_count)) {
+			(void) smr_offload_copy_from_sar(ep, sar_pool, resp,
+					cmd, iov, iov_count, bytes_done,
+					entry_ptr);
 		} else {
+			done = *bytes_done;
 			smr_copy_from_sar(sar_pool, resp, cmd, mr,
 					  iov, iov_count, bytes_done);
+			if (*bytes_done != done)
+				ofi_doorbell_ring(&smr->doorbell);
 		}
 	}
 }
@@ -349,7 +373,7 @@ static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 	ssize_t hmem_copy_ret;
 
 	num = smr_mmap_name(shm_name,
-			ep->region->map->peers[cmd->msg.hdr.id].peer.name,
+			smr_map_peer(ep->region->map, cmd->msg.hdr.id)->peer.name,
 			cmd->msg.hdr.msg_id);
 	if (num < 0) {
 		FI_WARN(&smr_prov, FI_LOG_AV, "generating shm file name failed\n");
@@ -872,16 +896,23 @@ static void smr_progress_connreq(struct smr_ep *ep, struct smr_cmd *cmd)
 
 	ret = smr_map_add(&smr_prov, ep->region->map,
 			  (char *) tx_buf->data, &idx);
-	if (ret)
+	if (!ret)
+		ret = smr_map_to_region(&smr_prov, ep->region->map, idx);
+	if (ret) {
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
 			"Error processing mapping request\n");
+		smr_release_txbuf(ep->region, tx_buf);
+		return;
+	}
 
+	smr_peer_data_reserve(ep->region, idx);
 	peer_smr = smr_peer_region(ep->region, idx);
 
 	if (peer_smr->pid != (int) cmd->msg.hdr.data) {
 		//TODO track and update/complete in error any transfers
 		//to or from old mapping
 		munmap(peer_smr, peer_smr->total_size);
+		smr_map_peer(ep->region->map, idx)->region = NULL;
 		smr_map_to_region(&smr_prov, ep->region->map, idx);
 		peer_smr = smr_peer_region(ep->region, idx);
 	}
@@ -890,8 +921,8 @@ static void smr_progress_connreq(struct smr_ep *ep, struct smr_cmd *cmd)
 
 	smr_release_txbuf(ep->region, tx_buf);
 	assert(ep->region->map->num_peers > 0);
-	ep->region->max_sar_buf_per_peer = SMR_MAX_PEERS /
-		ep->region->map->num_peers;
+	ep->region->max_sar_buf_per_peer =
+		smr_sar_bufs_per_peer(ep->region->map->num_peers);
 }
 
 static int smr_alloc_cmd_ctx(struct smr_ep *ep,
@@ -952,7 +983,7 @@ static int smr_progress_cmd_msg(struct smr_ep *ep, struct smr_cmd *cmd)
 	fi_addr_t addr;
 	int ret;
 
-	addr = ep->region->map->peers[cmd->msg.hdr.id].fiaddr;
+	addr = smr_map_peer(ep->region->map, cmd->msg.hdr.id)->fiaddr;
 	if (cmd->msg.hdr.op == ofi_op_tagged) {
 		ret = peer_srx->owner_ops->get_tag(peer_srx, addr,
 				cmd->msg.hdr.size, cmd->msg.hdr.tag, &rx_entry);
@@ -1162,10 +1193,45 @@ out:
 	return err;
 }
 
+static int smr_progress_cmd_entry(struct smr_ep *ep,
+				  struct smr_cmd_entry *ce)
+{
+	int ret = 0;
+
+	switch (ce->cmd.msg.hdr.op) {
+	case ofi_op_msg:
+	case ofi_op_tagged:
+		ret = smr_progress_cmd_msg(ep, &ce->cmd);
+		break;
+	case ofi_op_write:
+	case ofi_op_read_req:
+		ret = smr_progress_cmd_rma(ep, &ce->cmd, &ce->rma_cmd);
+		break;
+	case ofi_op_write_async:
+	case ofi_op_read_async:
+		ofi_ep_rx_cntr_inc_func(&ep->util_ep, ce->cmd.msg.hdr.op);
+		ofi_doorbell_ring(&ep->region->doorbell);
+		break;
+	case ofi_op_atomic:
+	case ofi_op_atomic_fetch:
+	case ofi_op_atomic_compare:
+		ret = smr_progress_cmd_atomic(ep, &ce->cmd, &ce->rma_cmd);
+		break;
+	case SMR_OP_MAX + ofi_ctrl_connreq:
+		smr_progress_connreq(ep, &ce->cmd);
+		break;
+	default:
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unidentified operation type\n");
+		ret = -FI_EINVAL;
+	}
+	return ret;
+}
+
 static void smr_progress_cmd(struct smr_ep *ep)
 {
 	struct smr_cmd_entry *ce;
-	int ret = 0;
+	int ret, err = 0, cnt, i;
 	int64_t pos;
 
 	/* ep->util_ep.lock is used to serialize the message/tag matching.
@@ -1181,47 +1247,26 @@ static void smr_progress_cmd(struct smr_ep *ep)
 	 * for locking the queue.
 	 */
 	ofi_genlock_lock(&ep->util_ep.lock);
-	while (1) {
-		ret = smr_cmd_queue_head(smr_cmd_queue(ep->region), &ce, &pos);
-		if (ret == -FI_ENOENT)
-			break;
-		switch (ce->cmd.msg.hdr.op) {
-		case ofi_op_msg:
-		case ofi_op_tagged:
-			ret = smr_progress_cmd_msg(ep, &ce->cmd);
-			break;
-		case ofi_op_write:
-		case ofi_op_read_req:
-			ret = smr_progress_cmd_rma(ep, &ce->cmd,
-				&ce->rma_cmd);
+	while (!err) {
+		cnt = smr_cmd_queue_head_n(smr_cmd_queue(ep->region),
+					   SMR_CMD_BATCH, &pos);
+		if (cnt == -FI_ENOENT)
 			break;
-		case ofi_op_write_async:
-		case ofi_op_read_async:
-			ofi_ep_rx_cntr_inc_func(&ep->util_ep,
-						ce->cmd.msg.hdr.op);
-			break;
-		case ofi_op_atomic:
-		case ofi_op_atomic_fetch:
-		case ofi_op_atomic_compare:
-			ret = smr_progress_cmd_atomic(ep, &ce->cmd,
-				&ce->rma_cmd);
-			break;
-		case SMR_OP_MAX + ofi_ctrl_connreq:
-			smr_progress_connreq(ep, &ce->cmd);
-			break;
-		default:
-			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-				"unidentified operation type\n");
-			ret = -FI_EINVAL;
-		}
-		smr_cmd_queue_release(smr_cmd_queue(ep->region), ce, pos);
-		if (ret) {
-			if (ret != -FI_EAGAIN) {
-				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-					"error processing command\n");
+		/* Claimed entries cannot be handed back, so the whole batch
+		 * is processed even if one of the commands fails. */
+		for (i = 0; i < cnt; i++) {
+			ce = smr_cmd_queue_buf(smr_cmd_queue(ep->region),
+					       pos + i);
+			ret = smr_progress_cmd_entry(ep, ce);
+			if (ret) {
+				if (ret != -FI_EAGAIN) {
+					FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+						"error processing command\n");
+				}
+				err = ret;
 			}
-			break;
 		}
+		smr_cmd_queue_release_n(smr_cmd_queue(ep->region), pos, cnt);
 	}
 	ofi_genlock_unlock(&ep->util_ep.lock);
 }
@@ -1293,6 +1338,44 @@ void smr_progress_ipc_list(struct smr_ep *ep)
 	}
 }
 
+static void smr_buffer_sar_pipe(struct smr_ep *ep, struct smr_resp *resp,
+				struct smr_pend_entry *sar_entry)
+{
+	struct smr_cmd *cmd = &sar_entry->cmd;
+	struct smr_sar_buf *sar_buf;
+	struct smr_unexp_buf *buf;
+	size_t bytes, seg;
+
+	for (seg = sar_entry->bytes_done / SMR_SAR_SIZE;
+	     sar_entry->bytes_done < cmd->msg.hdr.size; seg++) {
+		sar_buf = smr_freestack_get_entry_from_index(
+				smr_sar_pool(ep->region),
+				cmd->msg.data.sar[seg % cmd->msg.data.buf_batch_size]);
+		if (sar_buf->seq != seg + 1)
+			return;
+
+		buf = ofi_buf_alloc(ep->unexp_buf_pool);
+		if (!buf) {
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"Error allocating buffer\n");
+			assert(0);
+			return;
+		}
+		slist_insert_tail(&buf->entry, &sar_entry->cmd_ctx->buf_list);
+
+		ofi_rmb();
+		bytes = MIN(cmd->msg.hdr.size - sar_entry->bytes_done,
+			    SMR_SAR_SIZE);
+		memcpy(buf->buf, sar_buf->buf, bytes);
+		sar_entry->bytes_done += bytes;
+
+		ofi_wmb();
+		sar_buf->seq = 0;
+	}
+	ofi_wmb();
+	resp->status = SMR_STATUS_SAR_EMPTY;
+}
+
 static void smr_buffer_sar(struct smr_ep *ep, struct smr_region *peer_smr,
 		      struct smr_resp *resp, struct smr_pend_entry *sar_entry)
 {
@@ -1301,6 +1384,12 @@ static void smr_buffer_sar(struct smr_ep *ep, struct smr_region *peer_smr,
 	size_t bytes;
 	int next_buf = 0;
 
+	if (sar_entry->cmd.msg.hdr.op_flags & SMR_SAR_PIPE) {
+		smr_buffer_sar_pipe(ep, resp, sar_entry);
+		ofi_doorbell_ring(&peer_smr->doorbell);
+		return;
+	}
+
 	while (next_buf < sar_entry->cmd.msg.data.buf_batch_size &&
 	       sar_entry->bytes_done < sar_entry->cmd.msg.hdr.size) {
 		buf = ofi_buf_alloc(ep->unexp_buf_pool);
@@ -1326,6 +1415,7 @@ static void smr_buffer_sar(struct smr_ep *ep, struct smr_region *peer_smr,
 	}
 	ofi_wmb();
 	resp->status = SMR_STATUS_SAR_EMPTY;
+	ofi_doorbell_ring(&peer_smr->doorbell);
 }
 
 static void smr_progress_sar_list(struct smr_ep *ep)
@@ -1350,7 +1440,9 @@ static void smr_progress_sar_list(struct smr_ep *ep)
 					&sar_entry->bytes_done, sar_entry);
 		} else {
 			if (sar_entry->cmd_ctx) {
-				if (resp->status != SMR_STATUS_SAR_FULL)
+				if (!(sar_entry->cmd.msg.hdr.op_flags &
+				      SMR_SAR_PIPE) &&
+				    resp->status != SMR_STATUS_SAR_FULL)
 					continue;
 				smr_buffer_sar(ep, peer_smr, resp, sar_entry);
 			} else {
@@ -1410,6 +1502,8 @@ void smr_ep_progress(struct util_ep *util_ep)
 
 	if (smr_env.use_dsa_sar)
 		smr_dsa_progress(ep);
+	else if (ep->offload_context)
+		smr_offload_progress(ep);
 	smr_progress_resp(ep);
 	smr_progress_sar_list(ep);
 	smr_progress_cmd(ep);
@@ -1418,3 +1512,20 @@ void smr_ep_progress(struct util_ep *util_ep)
 	 * independent of any action by the provider */
 	ep->smr_progress_ipc_list(ep);
 }
+
+/* Nothing is in flight that could complete without a new command */
+static bool smr_ep_idle(struct smr_ep *ep)
+{
+	return ofi_cirque_isempty(smr_resp_queue(ep->region)) &&
+	       dlist_empty(&ep->sar_list) &&
+	       dlist_empty(&ep->ipc_cpy_pend_list);
+}
+
+struct ofi_doorbell *smr_ep_doorbell(struct fid *ep_fid, bool *busy)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid.fid);
+	*busy = !smr_ep_idle(ep);
+	return &ep->region->doorbell;
+}
@@ -95,6 +95,7 @@ static ssize_t smr_rma_fast(struct smr_ep *ep, struct smr_region *peer_smr,
 			    (op == ofi_op_write) ? ofi_op_write_async :
 			    ofi_op_read_async, op_flags);
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 	return FI_SUCCESS;
 }
 
@@ -121,7 +122,7 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 
 	id = smr_verify_peer(ep, addr);
 	if (id < 0)
-		return -FI_EAGAIN;
+		return id;
 
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
@@ -171,7 +172,8 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 	assert(!(op_flags & FI_INJECT) || total_len <= SMR_INJECT_SIZE);
 
 	proto = smr_select_proto(desc, iov_count, smr_vma_enabled(ep, peer_smr),
-	                         op, total_len, op_flags);
+				 smr_cma_copy(ep, peer_smr), op, total_len,
+				 op_flags);
 
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, op, 0, data,
 				   op_flags, (struct ofi_mr **)desc, iov,
@@ -183,6 +185,7 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 
 	smr_add_rma_cmd(peer_smr, rma_iov, rma_count, ce);
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 
 	if (proto != smr_src_inline && proto != smr_src_inject)
 		goto unlock;
@@ -326,7 +329,7 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 
 	id = smr_verify_peer(ep, dest_addr);
 	if (id < 0)
-		return -FI_EAGAIN;
+		return id;
 
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
@@ -362,6 +365,7 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	}
 	smr_add_rma_cmd(peer_smr, &rma_iov, 1, ce);
 	smr_cmd_queue_commit(ce, pos);
+	ofi_doorbell_ring(&peer_smr->doorbell);
 
 out:
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, ofi_op_write);
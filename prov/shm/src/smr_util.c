@@ -41,6 +41,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <ofi_xpmem.h>
+#include <ofi_mb.h>
 
 #include "smr_util.h"
 #include "smr.h"
@@ -96,10 +97,10 @@ void smr_cma_check(struct smr_region *smr, struct smr_region *peer_smr)
 }
 
 size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
-				  size_t *cmd_offset, size_t *resp_offset,
-				  size_t *inject_offset, size_t *sar_offset,
-				  size_t *peer_offset, size_t *name_offset,
-				  size_t *sock_offset)
+				  size_t max_peers, size_t *cmd_offset,
+				  size_t *resp_offset, size_t *inject_offset,
+				  size_t *sar_offset, size_t *peer_offset,
+				  size_t *name_offset, size_t *sock_offset)
 {
 	size_t cmd_queue_offset, resp_queue_offset, inject_pool_offset;
 	size_t sar_pool_offset, peer_data_offset, ep_name_offset;
@@ -117,9 +118,9 @@ size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
 	sar_pool_offset = inject_pool_offset +
 		freestack_size(sizeof(struct smr_inject_buf), rx_size);
 	peer_data_offset = sar_pool_offset +
-		freestack_size(sizeof(struct smr_sar_buf), SMR_MAX_PEERS);
+		freestack_size(sizeof(struct smr_sar_buf), SMR_SAR_BUF_CNT);
 	ep_name_offset = peer_data_offset + sizeof(struct smr_peer_data) *
-		SMR_MAX_PEERS;
+		max_peers;
 
 	sock_name_offset = ep_name_offset + SMR_NAME_MAX;
 
@@ -201,13 +202,14 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	size_t total_size, cmd_queue_offset, peer_data_offset;
 	size_t resp_queue_offset, inject_pool_offset, name_offset;
 	size_t sar_pool_offset, sock_name_offset;
-	int fd, ret, i;
+	int fd, ret;
 	void *mapped_addr;
 	size_t tx_size, rx_size;
 
 	tx_size = roundup_power_of_two(attr->tx_count);
 	rx_size = roundup_power_of_two(attr->rx_count);
-	total_size = smr_calculate_size_offsets(tx_size, rx_size, &cmd_queue_offset,
+	total_size = smr_calculate_size_offsets(tx_size, rx_size,
+					map->max_peers, &cmd_queue_offset,
 					&resp_queue_offset, &inject_pool_offset,
 					&sar_pool_offset, &peer_data_offset,
 					&name_offset, &sock_name_offset);
@@ -304,19 +306,16 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	(*smr)->name_offset = name_offset;
 	(*smr)->sock_name_offset = sock_name_offset;
 	(*smr)->max_sar_buf_per_peer = SMR_BUF_BATCH_MAX;
+	(*smr)->max_peers = map->max_peers;
+	(*smr)->peer_data_cnt = 0;
+	ofi_doorbell_init(&(*smr)->doorbell);
 
 	smr_cmd_queue_init(smr_cmd_queue(*smr), rx_size);
 	smr_resp_queue_init(smr_resp_queue(*smr), tx_size);
 	smr_freestack_init(smr_inject_pool(*smr), rx_size,
 			sizeof(struct smr_inject_buf));
-	smr_freestack_init(smr_sar_pool(*smr), SMR_MAX_PEERS,
+	smr_freestack_init(smr_sar_pool(*smr), SMR_SAR_BUF_CNT,
 			sizeof(struct smr_sar_buf));
-	for (i = 0; i < SMR_MAX_PEERS; i++) {
-		smr_peer_addr_init(&smr_peer_data(*smr)[i].addr);
-		smr_peer_data(*smr)[i].sar_status = 0;
-		smr_peer_data(*smr)[i].name_sent = 0;
-		smr_peer_data(*smr)[i].xpmem.cap = SMR_VMA_CAP_OFF;
-	}
 
 	strncpy((char *) smr_name(*smr), attr->name, total_size - name_offset);
 
@@ -334,6 +333,33 @@ close:
 	return ret;
 }
 
+/*
+ * Peers write into our peer data only at ids we handed out, and every id
+ * is reserved before it is first used, so untouched pages of the peer
+ * data array are never faulted in.
+ */
+void smr_peer_data_grow(struct smr_region *smr, int64_t id)
+{
+	struct smr_peer_data *peer_data = smr_peer_data(smr);
+	uint32_t i, cnt;
+
+	assert(id >= 0 && id < smr->max_peers);
+	pthread_spin_lock(&smr->lock);
+	cnt = MIN(ofi_get_aligned_size(id + 1, SMR_PEER_CHUNK),
+		  smr->max_peers);
+	for (i = smr->peer_data_cnt; i < cnt; i++) {
+		smr_peer_addr_init(&peer_data[i].addr);
+		peer_data[i].sar_status = 0;
+		peer_data[i].name_sent = 0;
+		peer_data[i].xpmem.cap = SMR_VMA_CAP_OFF;
+	}
+	if (cnt > smr->peer_data_cnt) {
+		ofi_wmb();
+		smr->peer_data_cnt = cnt;
+	}
+	pthread_spin_unlock(&smr->lock);
+}
+
 void smr_free(struct smr_region *smr)
 {
 	if (smr->flags & SMR_FLAG_HMEM_ENABLED)
@@ -348,24 +374,23 @@ static int smr_name_compare(struct ofi_rbmap *map, void *key, void *data)
 
 	smr_map = container_of(map, struct smr_map, rbmap);
 
-	return strncmp(smr_map->peers[(uintptr_t) data].peer.name,
+	return strncmp(smr_map_peer(smr_map, (uintptr_t) data)->peer.name,
 		       (char *) key, SMR_NAME_MAX);
 }
 
 int smr_map_create(const struct fi_provider *prov, int peer_count,
 		   uint16_t flags, struct smr_map **map)
 {
-	int i;
-
 	(*map) = calloc(1, sizeof(struct smr_map));
-	if (!*map) {
-		FI_WARN(prov, FI_LOG_DOMAIN, "failed to create SHM region group\n");
-		return -FI_ENOMEM;
-	}
+	if (!*map)
+		goto err;
 
-	for (i = 0; i < peer_count; i++) {
-		smr_peer_addr_init(&(*map)->peers[i].peer);
-		(*map)->peers[i].fiaddr = FI_ADDR_NOTAVAIL;
+	(*map)->max_peers = peer_count;
+	(*map)->peers = calloc(ofi_div_ceil(peer_count, SMR_PEER_CHUNK),
+			       sizeof(*(*map)->peers));
+	if (!(*map)->peers) {
+		free(*map);
+		goto err;
 	}
 	(*map)->flags = flags;
 
@@ -373,6 +398,26 @@ int smr_map_create(const struct fi_provider *prov, int peer_count,
 	ofi_spin_init(&(*map)->lock);
 
 	return 0;
+err:
+	FI_WARN(prov, FI_LOG_DOMAIN, "failed to create SHM region group\n");
+	return -FI_ENOMEM;
+}
+
+static struct smr_peer *smr_map_alloc_chunk(struct smr_map *map, int64_t id)
+{
+	struct smr_peer *chunk;
+	int i;
+
+	chunk = calloc(SMR_PEER_CHUNK, sizeof(*chunk));
+	if (!chunk)
+		return NULL;
+
+	for (i = 0; i < SMR_PEER_CHUNK; i++) {
+		smr_peer_addr_init(&chunk[i].peer);
+		chunk[i].fiaddr = FI_ADDR_NOTAVAIL;
+	}
+	map->peers[id / SMR_PEER_CHUNK] = chunk;
+	return chunk;
 }
 
 static int smr_match_name(struct dlist_entry *item, const void *args)
@@ -384,7 +429,7 @@ static int smr_match_name(struct dlist_entry *item, const void *args)
 int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 		      int64_t id)
 {
-	struct smr_peer *peer_buf = &map->peers[id];
+	struct smr_peer *peer_buf = smr_map_peer(map, id);
 	struct smr_region *peer;
 	size_t size;
 	int fd, ret = 0;
@@ -401,6 +446,7 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 	if (entry) {
 		peer_buf->region = container_of(entry, struct smr_ep_name,
 						entry)->region;
+		peer_buf->peer.id = id;
 		pthread_mutex_unlock(&ep_list_lock);
 		return FI_SUCCESS;
 	}
@@ -439,11 +485,27 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 		goto out;
 	}
 
+	/* Peer data is indexed by ids from the other side's map */
+	if (peer->max_peers != map->max_peers) {
+		FI_WARN_ONCE(prov, FI_LOG_AV,
+			     "peer %s uses FI_SHM_MAX_PEERS %u, not %" PRId64
+			     "\n", name, peer->max_peers, map->max_peers);
+		munmap(peer, sizeof(*peer));
+		ret = -FI_EINVAL;
+		goto out;
+	}
+
 	size = peer->total_size;
 	munmap(peer, sizeof(*peer));
 
 	peer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (peer == MAP_FAILED) {
+		FI_WARN(prov, FI_LOG_AV, "mmap error\n");
+		ret = -errno;
+		goto out;
+	}
 	peer_buf->region = peer;
+	peer_buf->peer.id = id;
 
 	if (map->flags & SMR_FLAG_HMEM_ENABLED) {
 		ret = ofi_hmem_host_register(peer, peer->total_size);
@@ -463,13 +525,14 @@ void smr_map_to_endpoint(struct smr_region *region, int64_t id)
 	struct smr_region *peer_smr;
 	struct smr_peer_data *local_peers;
 
-	if (region->map->peers[id].peer.id < 0)
+	if (smr_map_peer(region->map, id)->peer.id < 0)
 		return;
 
+	smr_peer_data_reserve(region, id);
 	local_peers = smr_peer_data(region);
 
 	strncpy(local_peers[id].addr.name,
-		region->map->peers[id].peer.name, SMR_NAME_MAX - 1);
+		smr_map_peer(region->map, id)->peer.name, SMR_NAME_MAX - 1);
 	local_peers[id].addr.name[SMR_NAME_MAX - 1] = '\0';
 
 	peer_smr = smr_peer_region(region, id);
@@ -503,16 +566,21 @@ void smr_unmap_from_endpoint(struct smr_region *region, int64_t id)
 	struct smr_peer_data *local_peers, *peer_peers;
 	int64_t peer_id;
 
+	smr_peer_data_reserve(region, id);
 	local_peers = smr_peer_data(region);
 
 	memset(local_peers[id].addr.name, 0, SMR_NAME_MAX);
-	peer_id = region->map->peers[id].peer.id;
+	local_peers[id].addr.id = -1;
+	local_peers[id].name_sent = 0;
+	peer_id = smr_map_peer(region->map, id)->peer.id;
 	if (peer_id < 0)
 		return;
 
 	peer_smr = smr_peer_region(region, id);
-	peer_peers = smr_peer_data(peer_smr);
+	if (peer_id >= peer_smr->max_peers)
+		return;
 
+	peer_peers = smr_peer_data(peer_smr);
 	peer_peers[peer_id].addr.id = -1;
 	peer_peers[peer_id].name_sent = 0;
 
@@ -521,16 +589,29 @@ void smr_unmap_from_endpoint(struct smr_region *region, int64_t id)
 
 void smr_exchange_all_peers(struct smr_region *region)
 {
+	struct smr_map *map = region->map;
 	int64_t i;
-	for (i = 0; i < SMR_MAX_PEERS; i++)
+
+	for (i = 0; i < map->max_peers; i++) {
+		if (!map->peers[i / SMR_PEER_CHUNK]) {
+			i += SMR_PEER_CHUNK - 1;
+			continue;
+		}
 		smr_map_to_endpoint(region, i);
+	}
 }
 
+/*
+ * Assign an id to the peer.  Its region is mapped on first use, see
+ * smr_map_to_region().
+ */
 int smr_map_add(const struct fi_provider *prov, struct smr_map *map,
 		const char *name, int64_t *id)
 {
 	struct ofi_rbnode *node;
-	int tries = 0, ret = 0;
+	struct smr_peer *peer;
+	int64_t tries;
+	int ret;
 
 	ofi_spin_lock(&map->lock);
 	ret = ofi_rbmap_insert(&map->rbmap, (void *) name,
@@ -542,53 +623,73 @@ int smr_map_add(const struct fi_provider *prov, struct smr_map *map,
 		return 0;
 	}
 
-	while (map->peers[map->cur_id].peer.id != -1 &&
-	       tries < SMR_MAX_PEERS) {
-		if (++map->cur_id == SMR_MAX_PEERS)
+	for (tries = 0; tries < map->max_peers; tries++) {
+		if (!map->peers[map->cur_id / SMR_PEER_CHUNK] &&
+		    !smr_map_alloc_chunk(map, map->cur_id)) {
+			ret = -FI_ENOMEM;
+			goto err;
+		}
+		if (!smr_map_peer(map, map->cur_id)->peer.name[0])
+			break;
+		if (++map->cur_id == map->max_peers)
 			map->cur_id = 0;
-		tries++;
 	}
 
-	assert(map->cur_id < SMR_MAX_PEERS && tries < SMR_MAX_PEERS);
+	if (tries == map->max_peers) {
+		FI_WARN(prov, FI_LOG_AV, "shm peer map is full (%" PRId64
+			" peers), see FI_SHM_MAX_PEERS\n", map->max_peers);
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
 	*id = map->cur_id;
 	node->data = (void *) (intptr_t) *id;
-	strncpy(map->peers[*id].peer.name, name, SMR_NAME_MAX);
-	map->peers[*id].peer.name[SMR_NAME_MAX - 1] = '\0';
-	map->peers[*id].region = NULL;
-
-	ret = smr_map_to_region(prov, map, *id);
-	if (!ret)
-		map->peers[*id].peer.id = *id;
+	peer = smr_map_peer(map, *id);
+	strncpy(peer->peer.name, name, SMR_NAME_MAX);
+	peer->peer.name[SMR_NAME_MAX - 1] = '\0';
+	peer->peer.id = -1;
+	peer->region = NULL;
 
 	map->num_peers++;
 	ofi_spin_unlock(&map->lock);
-	return ret == -ENOENT ? 0 : ret;
+	return 0;
+
+err:
+	ofi_rbmap_delete(&map->rbmap, node);
+	ofi_spin_unlock(&map->lock);
+	return ret;
 }
 
 void smr_map_del(struct smr_map *map, int64_t id)
 {
 	struct dlist_entry *entry;
+	struct smr_peer *peer;
+
+	if (id >= map->max_peers || id < 0 ||
+	    !map->peers[id / SMR_PEER_CHUNK])
+		return;
 
-	if (id >= SMR_MAX_PEERS || id < 0 || map->peers[id].peer.id < 0)
+	peer = smr_map_peer(map, id);
+	if (!peer->peer.name[0])
 		return;
 
 	pthread_mutex_lock(&ep_list_lock);
 	entry = dlist_find_first_match(&ep_name_list, smr_match_name,
-				       smr_no_prefix(map->peers[id].peer.name));
+				       smr_no_prefix(peer->peer.name));
 	pthread_mutex_unlock(&ep_list_lock);
 
 	ofi_spin_lock(&map->lock);
-	if (!entry) {
+	if (!entry && peer->region) {
 		if (map->flags & SMR_FLAG_HMEM_ENABLED)
-			(void) ofi_hmem_host_unregister(map->peers[id].region);
-		munmap(map->peers[id].region, map->peers[id].region->total_size);
+			(void) ofi_hmem_host_unregister(peer->region);
+		munmap(peer->region, peer->region->total_size);
 	}
 
-	(void) ofi_rbmap_find_delete(&map->rbmap,
-				     (void *) map->peers[id].peer.name);
+	(void) ofi_rbmap_find_delete(&map->rbmap, (void *) peer->peer.name);
 
-	map->peers[id].fiaddr = FI_ADDR_NOTAVAIL;
-	map->peers[id].peer.id = -1;
+	smr_peer_addr_init(&peer->peer);
+	peer->fiaddr = FI_ADDR_NOTAVAIL;
+	peer->region = NULL;
 	map->num_peers--;
 
 	ofi_spin_unlock(&map->lock);
@@ -598,17 +699,20 @@ void smr_map_free(struct smr_map *map)
 {
 	int64_t i;
 
-	for (i = 0; i < SMR_MAX_PEERS; i++)
+	for (i = 0; i < map->max_peers; i++)
 		smr_map_del(map, i);
 
+	for (i = 0; i < ofi_div_ceil(map->max_peers, SMR_PEER_CHUNK); i++)
+		free(map->peers[i]);
+	free(map->peers);
 	ofi_rbmap_cleanup(&map->rbmap);
 	free(map);
 }
 
 struct smr_region *smr_map_get(struct smr_map *map, int64_t id)
 {
-	if (id < 0 || id >= SMR_MAX_PEERS)
+	if (id < 0 || id >= map->max_peers || !map->peers[id / SMR_PEER_CHUNK])
 		return NULL;
 
-	return map->peers[id].region;
+	return smr_map_peer(map, id)->region;
 }
@@ -41,6 +41,7 @@
 
 #include <ofi_xpmem.h>
 #include <ofi_atom.h>
+#include <ofi_doorbell.h>
 #include <ofi_proto.h>
 #include <ofi_mem.h>
 #include <ofi_rbuf.h>
@@ -54,7 +55,7 @@
 extern "C" {
 #endif
 
-#define SMR_VERSION	6
+#define SMR_VERSION	10
 
 #define SMR_FLAG_ATOMIC	(1 << 0)
 #define SMR_FLAG_DEBUG	(1 << 1)
@@ -83,6 +84,7 @@ enum {
 #define SMR_TX_COMPLETION	(1 << 2)
 #define SMR_RX_COMPLETION	(1 << 3)
 #define SMR_MULTI_RECV		(1 << 4)
+#define SMR_SAR_PIPE		(1 << 5)
 
 /* CMA/XPMEM capability. Generic acronym used:
  * VMA: Virtual Memory Address */
@@ -207,7 +209,16 @@ struct smr_peer {
 	struct smr_region	*region;
 };
 
-#define SMR_MAX_PEERS	256
+/*
+ * Default limit on the number of peers in a map, see FI_SHM_MAX_PEERS.
+ * Map entries are allocated SMR_PEER_CHUNK at a time as ids are handed
+ * out, so the limit only reserves address space.
+ */
+#define SMR_MAX_PEERS	4096
+#define SMR_PEER_CHUNK	256
+
+/* SAR buffers in each region, shared by all peers sending to it */
+#define SMR_SAR_BUF_CNT	256
 
 struct smr_map {
 	ofi_spin_t		lock;
@@ -215,9 +226,15 @@ struct smr_map {
 	int 			num_peers;
 	uint16_t		flags;
 	struct ofi_rbmap	rbmap;
-	struct smr_peer		peers[SMR_MAX_PEERS];
+	int64_t			max_peers;
+	struct smr_peer		**peers;
 };
 
+static inline struct smr_peer *smr_map_peer(struct smr_map *map, int64_t id)
+{
+	return &map->peers[id / SMR_PEER_CHUNK][id % SMR_PEER_CHUNK];
+}
+
 struct smr_region {
 	uint8_t		version;
 	uint8_t		resv;
@@ -226,6 +243,11 @@ struct smr_region {
 	uint8_t		cma_cap_peer;
 	uint8_t		cma_cap_self;
 	uint32_t	max_sar_buf_per_peer;
+	uint32_t	max_peers;
+	/* peer data entries initialized so far, owner only */
+	uint32_t	peer_data_cnt;
+	/* owner threads blocked in a CQ or counter wait sleep on doorbell */
+	struct ofi_doorbell doorbell;
 	uint8_t		xpmem_cap_self;
 	struct xpmem_pinfo xpmem_self;
 	struct xpmem_pinfo xpmem_peer;
@@ -271,10 +293,20 @@ enum smr_status {
 	SMR_STATUS_OFFSET = 1024, 	/* Beginning of shm-specific codes */
 	SMR_STATUS_SAR_EMPTY, 	/* buffer can be written into */
 	SMR_STATUS_SAR_FULL, 	/* buffer can be read from */
+	SMR_STATUS_SAR_PIPE, 	/* pipelined transfer, see smr_sar_buf */
 };
 
+/*
+ * With SMR_SAR_PIPE, segment n of a message goes through buffer
+ * n % buf_batch_size and each buffer is handed over on its own.  seq is
+ * n + 1 while the buffer holds segment n and 0 once it has been drained.
+ * The reader sets the resp status to SMR_STATUS_SAR_EMPTY after the last
+ * segment.
+ */
 struct smr_sar_buf {
 	uint8_t		buf[SMR_SAR_SIZE];
+	uint64_t	seq;
+	uint8_t		pad[64 - sizeof(uint64_t)];
 };
 
 /* TODO it is expected that a future patch will expand the smr_cmd
@@ -295,7 +327,7 @@ OFI_DECLARE_ATOMIC_Q(struct smr_cmd_entry, smr_cmd_queue);
 
 static inline struct smr_region *smr_peer_region(struct smr_region *smr, int i)
 {
-	return smr->map->peers[i].region;
+	return smr_map_peer(smr->map, i)->region;
 }
 static inline struct smr_cmd_queue *smr_cmd_queue(struct smr_region *smr)
 {
@@ -313,6 +345,20 @@ static inline struct smr_peer_data *smr_peer_data(struct smr_region *smr)
 {
 	return (struct smr_peer_data *) ((char *) smr + smr->peer_data_offset);
 }
+void smr_peer_data_grow(struct smr_region *smr, int64_t id);
+
+/* Peer data is initialized in chunks as ids come into use */
+static inline void smr_peer_data_reserve(struct smr_region *smr, int64_t id)
+{
+	if (OFI_UNLIKELY(id >= (int64_t) smr->peer_data_cnt))
+		smr_peer_data_grow(smr, id);
+}
+static inline uint32_t smr_sar_bufs_per_peer(int num_peers)
+{
+	return num_peers ? MAX(SMR_SAR_BUF_CNT / num_peers, 1) :
+			   SMR_BUF_BATCH_MAX;
+}
+
 static inline struct smr_freestack *smr_sar_pool(struct smr_region *smr)
 {
 	return (struct smr_freestack *) ((char *) smr + smr->sar_pool_offset);
@@ -340,10 +386,10 @@ struct smr_attr {
 };
 
 size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
-				  size_t *cmd_offset, size_t *resp_offset,
-				  size_t *inject_offset, size_t *sar_offset,
-				  size_t *peer_offset, size_t *name_offset,
-				  size_t *sock_offset);
+				  size_t max_peers, size_t *cmd_offset,
+				  size_t *resp_offset, size_t *inject_offset,
+				  size_t *sar_offset, size_t *peer_offset,
+				  size_t *name_offset, size_t *sock_offset);
 void	smr_cma_check(struct smr_region *region, struct smr_region *peer_region);
 void	smr_cleanup(void);
 int	smr_map_create(const struct fi_provider *prov, int peer_count,
@@ -75,7 +75,7 @@
 #define SM2_IOV_LIMIT		4
 #define SM2_PREFIX		"fi_sm2://"
 #define SM2_PREFIX_NS		"fi_ns://"
-#define SM2_VERSION		1
+#define SM2_VERSION		2
 #define SM2_IOV_LIMIT		4
 #define SM2_INJECT_SIZE		(SM2_XFER_ENTRY_SIZE - sizeof(struct sm2_xfer_hdr))
 
@@ -272,6 +272,12 @@ static inline uint64_t sm2_rx_cq_flags(uint32_t op, uint64_t rx_flags,
 
 void sm2_ep_progress(struct util_ep *util_ep);
 
+extern int sm2_wait_spin;
+extern struct fi_ops_cq sm2_cq_sleep_ops;
+extern struct fi_ops_cntr sm2_cntr_sleep_ops;
+
+struct ofi_doorbell *sm2_ep_doorbell(struct fid *ep_fid, bool *busy);
+
 void sm2_progress_recv(struct sm2_ep *ep);
 
 int sm2_unexp_start(struct fi_peer_rx_entry *rx_entry);
@@ -33,14 +33,35 @@
 
 #include "sm2.h"
 
+static int sm2_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold,
+			 int timeout)
+{
+	return ofi_doorbell_cntr_wait(cntr_fid, threshold, timeout,
+				      sm2_wait_spin, sm2_ep_doorbell);
+}
+
+struct fi_ops_cntr sm2_cntr_sleep_ops = {
+	.size = sizeof(struct fi_ops_cntr),
+	.read = ofi_cntr_read,
+	.readerr = ofi_cntr_readerr,
+	.add = ofi_cntr_add,
+	.adderr = ofi_cntr_adderr,
+	.set = ofi_cntr_set,
+	.seterr = ofi_cntr_seterr,
+	.wait = sm2_cntr_wait,
+};
+
 int sm2_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 		  struct fid_cntr **cntr_fid, void *context)
 {
 	int ret;
 	struct util_cntr *cntr;
+	bool sleep = false;
 
 	switch (attr->wait_obj) {
 	case FI_WAIT_UNSPEC:
+		/* See sm2_cq_open */
+		sleep = !(attr->flags & FI_PEER);
 		attr->wait_obj = FI_WAIT_YIELD;
 		/* fall through */
 	case FI_WAIT_NONE:
@@ -60,6 +81,9 @@ int sm2_cntr_open(struct fid_domain *domain, struct fi_cntr_attr *attr,
 	if (ret)
 		goto free;
 
+	if (sleep)
+		cntr->cntr_fid.ops = &sm2_cntr_sleep_ops;
+
 	*cntr_fid = &cntr->cntr_fid;
 	return FI_SUCCESS;
 
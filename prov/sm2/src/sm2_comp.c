@@ -37,18 +37,21 @@
 
 #include "ofi_iov.h"
 #include "sm2.h"
+#include "sm2_fifo.h"
 
 int sm2_complete_tx(struct sm2_ep *ep, void *context, uint32_t op,
 		    uint64_t flags)
 {
-	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
+	int ret = 0;
 
-	if (!(flags & FI_COMPLETION))
-		return 0;
+	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
 
-	return ofi_peer_cq_write(ep->util_ep.tx_cq, context,
-				 ofi_tx_cq_flags(op), 0, NULL, 0, 0,
-				 FI_ADDR_NOTAVAIL);
+	if (flags & FI_COMPLETION)
+		ret = ofi_peer_cq_write(ep->util_ep.tx_cq, context,
+					ofi_tx_cq_flags(op), 0, NULL, 0, 0,
+					FI_ADDR_NOTAVAIL);
+	ofi_doorbell_ring(&ep->self_region->doorbell);
+	return ret;
 }
 
 int sm2_write_err_comp(struct util_cq *cq, void *context, uint64_t flags,
@@ -69,16 +72,16 @@ int sm2_complete_rx(struct sm2_ep *ep, void *context, uint32_t op,
 		    uint64_t tag, uint64_t data)
 {
 	struct sm2_av *sm2_av;
+	int ret = 0;
 
 	ofi_ep_peer_rx_cntr_inc(&ep->util_ep, op);
 
-	if (!(flags & (FI_REMOTE_CQ_DATA | FI_COMPLETION)))
-		return 0;
-
-	flags &= ~FI_COMPLETION;
-
-	sm2_av = container_of(ep->util_ep.av, struct sm2_av, util_av);
-
-	return ofi_peer_cq_write(ep->util_ep.rx_cq, context, flags, len, buf,
-				 data, tag, sm2_av->reverse_lookup[gid]);
+	if (flags & (FI_REMOTE_CQ_DATA | FI_COMPLETION)) {
+		sm2_av = container_of(ep->util_ep.av, struct sm2_av, util_av);
+		ret = ofi_peer_cq_write(ep->util_ep.rx_cq, context,
+					flags & ~FI_COMPLETION, len, buf, data,
+					tag, sm2_av->reverse_lookup[gid]);
+	}
+	ofi_doorbell_ring(&ep->self_region->doorbell);
+	return ret;
 }
@@ -40,6 +40,7 @@
 #include <sys/un.h>
 
 #include <ofi_atom.h>
+#include <ofi_doorbell.h>
 #include <ofi_hmem.h>
 #include <ofi_mem.h>
 #include <ofi_proto.h>
@@ -87,6 +88,9 @@ struct sm2_region {
 	uint8_t resv;
 	uint16_t flags;
 
+	/* owner threads blocked in a CQ or counter wait sleep on doorbell */
+	struct ofi_doorbell doorbell;
+
 	/* offsets from start of sm2_region */
 	ptrdiff_t recv_queue_offset;
 	ptrdiff_t freestack_offset;
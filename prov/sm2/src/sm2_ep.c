@@ -266,6 +266,9 @@ static int sm2_ep_close(struct fid *fid)
 
 	ofi_endpoint_close(&ep->util_ep);
 
+	/* waits armed before the CQ and counter unbind must let go */
+	ofi_doorbell_drain(&ep->self_region->doorbell);
+
 	/* Set our PID to 0 in the regions map if our free queue entry stack is
 	 * full This will allow other entries re-use us or shrink file.
 	 */
@@ -451,6 +454,10 @@ static int sm2_ep_ctrl(struct fid *fid, int command, void *arg)
 		if (ret)
 			return ret;
 
+		if (ofi_doorbell_ep_sleeps(&ep->util_ep, &sm2_cq_sleep_ops,
+					   &sm2_cntr_sleep_ops))
+			ofi_doorbell_enable(&ep->self_region->doorbell);
+
 		if (!ep->srx) {
 			domain = container_of(ep->util_ep.domain,
 					      struct sm2_domain,
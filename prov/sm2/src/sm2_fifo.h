@@ -191,6 +191,7 @@ static inline void sm2_fifo_write(struct sm2_ep *ep, sm2_gid_t peer_gid,
 	}
 
 	atomic_wmb();
+	ofi_doorbell_ring(&peer_region->doorbell);
 }
 
 /* Read, Dequeue */
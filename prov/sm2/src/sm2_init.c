@@ -108,6 +108,7 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	smr->flags = attr->flags;
 	smr->recv_queue_offset = recv_queue_offset;
 	smr->freestack_offset = freestack_offset;
+	ofi_doorbell_init(&smr->doorbell);
 
 	sm2_fifo_init(sm2_recv_queue(smr));
 	smr_freestack_init(sm2_freestack(smr), SM2_NUM_XFER_ENTRY_PER_PEER,
@@ -267,7 +268,17 @@ struct util_prov sm2_util_prov = {
 	.flags = 0,
 };
 
+int sm2_wait_spin = 50;
+
 SM2_INI
 {
+	fi_param_define(&sm2_prov, "wait_spin", FI_PARAM_INT,
+			"Time in microseconds that a blocking CQ or counter "
+			"wait polls before sleeping.  Set to -1 to never "
+			"sleep (default: 50, or 0 with a single cpu)");
+	if (ofi_sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+		sm2_wait_spin = 0;
+	fi_param_get_int(&sm2_prov, "wait_spin", &sm2_wait_spin);
+
 	return &sm2_prov;
 }
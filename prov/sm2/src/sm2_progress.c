@@ -402,3 +402,17 @@ void sm2_ep_progress(struct util_ep *util_ep)
 	sm2_progress_recv(ep);
 	ofi_genlock_unlock(&ep->util_ep.lock);
 }
+
+/*
+ * All sm2 traffic, including returned transfer entries, arrives through
+ * the receive FIFO, so an endpoint never has to be polled to complete its
+ * own transfers.
+ */
+struct ofi_doorbell *sm2_ep_doorbell(struct fid *ep_fid, bool *busy)
+{
+	struct sm2_ep *ep;
+
+	ep = container_of(ep_fid, struct sm2_ep, util_ep.ep_fid.fid);
+	*busy = false;
+	return &ep->self_region->doorbell;
+}
@@ -48,6 +48,7 @@
 #include <rdma/fi_endpoint.h>
 #include <rdma/fi_eq.h>
 #include <rdma/fi_errno.h>
+#include <rdma/fi_ext.h>
 #include <rdma/fi_rma.h>
 #include <rdma/fi_tagged.h>
 #include <rdma/fi_trigger.h>
@@ -73,6 +74,9 @@
 #define XNET_MAX_EVENTS		128
 #define XNET_MIN_MULTI_RECV	16384
 #define XNET_PORT_MAX_RANGE	(USHRT_MAX)
+#define XNET_TAG_BUCKETS	1024	/* must be power of 2 */
+#define XNET_TX_COALESCE_IOV	64
+#define XNET_MAX_STREAMS	8
 
 extern struct fi_provider	xnet_prov;
 extern struct util_prov		xnet_util_prov;
@@ -88,11 +92,21 @@ extern int xnet_prefetch_rbuf_size;
 extern size_t xnet_default_tx_size;
 extern size_t xnet_default_rx_size;
 extern size_t xnet_zerocopy_size;
+extern size_t xnet_tx_coalesce_size;
+extern int xnet_rdm_streams;
+extern size_t xnet_rdm_stripe_size;
 extern int xnet_trace_msg;
 extern int xnet_disable_autoprog;
 extern int xnet_io_uring;
+extern int xnet_io_uring_rx_bufs;
+extern int xnet_progress_shards;
+extern int xnet_progress_spin;
+extern char *xnet_progress_affinity;
+extern int xnet_busy_poll;
 extern int xnet_max_saved;
 extern size_t xnet_max_saved_size;
+extern size_t xnet_unexp_peek_size;
+extern size_t xnet_rndv_size;
 extern size_t xnet_max_inject;
 extern size_t xnet_buf_size;
 struct xnet_xfer_entry;
@@ -128,6 +142,7 @@ struct xnet_conn_handle {
 	struct xnet_pep		*pep;
 	SOCKET			sock;
 	bool			endian_match;
+	bool			rndv;
 	struct ofi_sockapi	*sockapi;
 	struct ofi_sockctx	rx_sockctx;
 };
@@ -154,6 +169,7 @@ union xnet_hdrs {
 	struct xnet_cq_data_hdr cq_data_hdr;
 	struct xnet_tag_data_hdr tag_data_hdr;
 	struct xnet_tag_hdr	tag_hdr;
+	struct xnet_cts_hdr	cts_hdr;
 	uint8_t			max_hdr[XNET_MAX_HDR];
 };
 
@@ -165,6 +181,8 @@ struct xnet_active_rx {
 	struct xnet_xfer_entry	*entry;
 	int			(*handler)(struct xnet_ep *ep);
 	void			*claim_ctx;
+	/* Payload is held in the prefetch buffer awaiting a receive */
+	bool			peeked;
 };
 
 struct xnet_active_tx {
@@ -178,13 +196,23 @@ struct xnet_saved_msg {
 	int			cnt;
 };
 
+/* Posted tagged receives with an exact tag (ignore == 0) are hashed by
+ * tag and source into tag_buckets.  Receives using tag wildcards remain
+ * on tag_queue (any source) or the src_tag_queues (directed receives).
+ * All queues are ordered by tag_seq_no, which is used to select the
+ * earliest posted receive when several queues hold a match.  Saved
+ * (unexpected) messages are additionally indexed by tag in saved_buckets,
+ * ordered by arrival.
+ */
 struct xnet_srx {
 	struct fid_ep		rx_fid;
 	struct xnet_domain	*domain;
 	struct slist		rx_queue;
 	struct slist		tag_queue;
+	struct slist		*tag_buckets;
 	struct ofi_dyn_arr	src_tag_queues;
 	struct ofi_dyn_arr	saved_msgs;
+	struct dlist_entry	*saved_buckets;
 
 	struct xnet_xfer_entry	*(*match_tag_rx)(struct xnet_srx *srx,
 						 struct xnet_ep *ep,
@@ -212,12 +240,18 @@ struct xnet_ep {
 	OFI_DBG_VAR(uint8_t, rx_id)
 
 	struct dlist_entry	unexp_entry;
+	struct dlist_entry	rx_buf_entry;
 	struct slist		rx_queue;
 	struct slist		tx_queue;
 	struct slist		priority_queue;
 	struct slist		need_ack_queue;
 	struct slist		async_queue;
 	struct slist		rma_read_queue;
+	/* Rendezvous sends waiting for a CTS, and matched receives
+	 * waiting for the payload, see struct xnet_rts.
+	 */
+	struct slist		rndv_tx_queue;
+	struct slist		rndv_rx_queue;
 	struct xnet_saved_msg	*saved_msg;
 	int			rx_avail;
 	struct xnet_srx		*srx;
@@ -227,10 +261,13 @@ struct xnet_ep {
 	struct xnet_conn_handle *conn;
 	struct xnet_cm_msg	*cm_msg;
 	struct sockaddr		*addr;
+	struct xnet_progress	*progress;
 
 	void (*hdr_bswap)(struct xnet_ep *ep, struct xnet_base_hdr *hdr);
 
 	short			pollflags;
+	/* peer accepts rendezvous transfers */
+	bool			rndv;
 };
 
 struct xnet_event {
@@ -244,6 +281,8 @@ enum {
 	XNET_CONN_INDEXED = BIT(0),
 	XNET_CONN_TX_LOOPBACK = BIT(1),
 	XNET_CONN_RX_LOOPBACK = BIT(2),
+	XNET_CONN_STREAM = BIT(3),
+	XNET_CONN_NO_STREAMS = BIT(4),
 };
 
 struct xnet_conn {
@@ -252,6 +291,17 @@ struct xnet_conn {
 	struct util_peer_addr	*peer;
 	uint32_t		remote_pid;
 	int			flags;
+	uint64_t		connect_start;
+
+	/* A peer may be reached through additional streams, each with its
+	 * own socket, used to stripe large RMA writes.  Streams opened by
+	 * this side are tracked by the primary conn.  Streams accepted from
+	 * a peer only receive data and are kept on xnet_rdm::stream_list.
+	 */
+	struct xnet_conn	*parent;
+	struct xnet_conn	*streams[XNET_MAX_STREAMS - 1];
+	struct dlist_entry	stream_entry;
+	uint8_t			stream_idx;
 };
 
 struct xnet_rdm {
@@ -262,7 +312,9 @@ struct xnet_rdm {
 
 	struct index_map	conn_idx_map;
 	struct xnet_conn	*rx_loopback;
+	struct dlist_entry	stream_list;
 	union ofi_sock_ip	addr;
+	struct fi_tcp_conn_stats conn_stats;
 };
 
 int xnet_rdm_ep(struct fid_domain *domain, struct fi_info *info,
@@ -270,12 +322,16 @@ int xnet_rdm_ep(struct fid_domain *domain, struct fi_info *info,
 ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t dest_addr,
 		      struct xnet_conn **conn);
 struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr);
+int xnet_get_streams(struct xnet_conn *conn, struct xnet_ep **eps);
+int xnet_connect_addrs(struct xnet_rdm *rdm, const fi_addr_t *addr,
+		       size_t count);
 void xnet_freeall_conns(struct xnet_rdm *rdm);
 
 struct xnet_uring {
 	struct fid fid;
 	ofi_io_uring_t ring;
 	struct ofi_sockapi_uring *sockapi;
+	bool send_zc;
 };
 
 /* Serialization is handled at the progress instance level, using the
@@ -326,13 +382,26 @@ struct xnet_progress {
 	struct xnet_uring	rx_uring;
 	ofi_io_uring_cqe_t	**cqes;
 
+	/* Multishot receives into a provided buffer ring.  Endpoints wait
+	 * on rx_buf_list when no buffers are available to re-arm.
+	 */
+	struct ofi_uring_bufring rx_bufring;
+	struct dlist_entry	rx_buf_list;
+
 	struct ofi_sockapi	sockapi;
 
 	struct ofi_dynpoll	epoll_fd;
 	struct ofi_epollfds_event events[XNET_MAX_EVENTS];
 
+	/* Queued transfers coalesced into a single sendmsg */
+	uint64_t		tx_batches;
+	uint64_t		tx_batch_entries;
+	uint64_t		tx_batch_bytes;
+
 	bool			auto_progress;
 	pthread_t		thread;
+	/* Current adaptive spin window of the progress thread, in usec */
+	int			spin_usec;
 };
 
 int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info);
@@ -361,6 +430,8 @@ int xnet_uring_cancel(struct xnet_progress *progress,
 int xnet_uring_pollin_add(struct xnet_progress *progress,
 			  int fd, bool multishot,
 			  struct ofi_sockctx *pollin_ctx);
+int xnet_uring_monitor_ep(struct xnet_ep *ep);
+void xnet_uring_drain_zc(struct xnet_ep *ep);
 
 static inline int xnet_progress_locked(struct xnet_progress *progress)
 {
@@ -390,10 +461,17 @@ static inline void xnet_signal_progress(struct xnet_progress *progress)
 #define XNET_SAVED_XFER		BIT(8)
 #define XNET_COPY_RECV		BIT(9)
 #define XNET_CLAIM_RECV		BIT(10)
+#define XNET_TX_PREPPED		BIT(11)
+#define XNET_STRIPE_XFER	BIT(12)
+#define XNET_STRIPE_WAIT	BIT(13)
+#define XNET_STRIPE_ERR		BIT(14)
+#define XNET_RTS_XFER		BIT(15)
 #define XNET_MULTI_RECV		FI_MULTI_RECV /* BIT(16) */
 
 struct xnet_xfer_entry {
 	struct slist_entry	entry;
+	/* saved messages only, see xnet_srx::saved_buckets */
+	struct dlist_entry	tag_entry;
 	void			*user_buf;
 	size_t			iov_cnt;
 	struct iovec		iov[XNET_IOV_LIMIT+1];
@@ -412,6 +490,8 @@ struct xnet_xfer_entry {
 	 * we don't generate multiple completions for the same operation.
 	 */
 	struct xnet_xfer_entry  *resp_entry;
+	/* For striped RMA writes, see struct xnet_stripe */
+	struct xnet_stripe	*stripe;
 
 	/* hdr must be second to last, followed by msg_data.  msg_data
 	 * is sized dynamically based on the max_inject size
@@ -420,18 +500,57 @@ struct xnet_xfer_entry {
 	char			msg_data[];
 };
 
+/* A large RMA write to an rdm peer may be split across multiple streams.
+ * The final piece is queued on the primary stream, which preserves the
+ * ordering of the write with respect to later operations, but is held
+ * (XNET_STRIPE_WAIT) until the peer has acknowledged the pieces sent over
+ * the other streams (XNET_STRIPE_XFER).  Only the final piece generates
+ * completions.
+ */
+struct xnet_stripe {
+	struct xnet_ep		*ep;
+	struct xnet_xfer_entry	*parent;
+	int			pending;
+	int			err;
+};
+
+void xnet_stripe_done(struct xnet_xfer_entry *xfer_entry, int err);
+ssize_t xnet_rma_stripe_write(struct xnet_ep *ep, struct xnet_ep **streams,
+			      int cnt, const struct fi_msg_rma *msg,
+			      uint64_t flags);
+
+/* A domain exporting msg endpoints may optionally spread its endpoints
+ * across a set of progress shards.  Each shard is a full progress instance,
+ * with its own poll set, xfer pool, lock, and progress thread.  Endpoints
+ * bound to a shared rx context remain on the domain progress instance, as
+ * the srx queues are serialized by that lock.  Objects shared between
+ * shards (CQs, counters, the MR map) are protected by their own locks.
+ */
 struct xnet_domain {
 	struct util_domain		util_domain;
 	struct xnet_progress		progress;
 	enum fi_ep_type			ep_type;
+
+	struct xnet_progress		*shards;
+	int				shard_cnt;
+	ofi_atomic32_t			shard_idx;
 };
 
+static inline struct xnet_progress *
+xnet_domain_ep_progress(struct xnet_domain *domain)
+{
+	uint32_t idx;
+
+	if (!domain->shard_cnt)
+		return &domain->progress;
+
+	idx = (uint32_t) ofi_atomic_inc32(&domain->shard_idx);
+	return &domain->shards[idx % domain->shard_cnt];
+}
+
 static inline struct xnet_progress *xnet_ep2_progress(struct xnet_ep *ep)
 {
-	struct xnet_domain *domain;
-	domain = container_of(ep->util_ep.domain, struct xnet_domain,
-			      util_domain);
-	return &domain->progress;
+	return ep->progress;
 }
 
 static inline struct xnet_progress *xnet_rdm2_progress(struct xnet_rdm *rdm)
@@ -670,10 +789,31 @@ static inline bool xnet_has_unexp(struct xnet_ep *ep)
 	return ep->cur_rx.handler && !ep->cur_rx.entry;
 }
 
+static inline size_t xnet_tag_hash(uint64_t tag, fi_addr_t src)
+{
+	uint64_t key = (tag ^ (src * 0x9e3779b97f4a7c15ULL)) *
+		       0xff51afd7ed558ccdULL;
+	return (size_t) (key >> 32) & (XNET_TAG_BUCKETS - 1);
+}
+
+static inline struct dlist_entry *
+xnet_saved_bucket(struct xnet_srx *srx, uint64_t tag)
+{
+	return &srx->saved_buckets[xnet_tag_hash(tag, FI_ADDR_UNSPEC)];
+}
+
 void xnet_recv_saved(struct xnet_xfer_entry *saved_entry,
 		     struct xnet_xfer_entry *rx_entry);
 void xnet_complete_saved(struct xnet_xfer_entry *saved_entry,
 			 void *msg_data);
+void xnet_srx_flush_rts(struct xnet_ep *ep);
+
+static inline struct xnet_rts *xnet_hdr_rts(union xnet_hdrs *hdr)
+{
+	assert(hdr->base_hdr.flags & XNET_RNDV);
+	return (struct xnet_rts *) ((uint8_t *) hdr + hdr->base_hdr.hdr_size -
+				    sizeof(struct xnet_rts));
+}
 
 #define XNET_WARN_ERR(subsystem, log_str, err) \
 	FI_WARN(&xnet_prov, subsystem, log_str "%s (%d)\n", \
@@ -157,6 +157,7 @@ static int xnet_req_done_internal(struct xnet_ep *ep)
 				xnet_hdr_none : xnet_hdr_bswap;
 	}
 
+	ep->rndv = !!(ntohl(ep->cm_msg->hdr.seg_no) & XNET_CM_RNDV);
 	len = ntohs(ep->cm_msg->hdr.seg_size);
 	cm_entry.fid = &ep->util_ep.ep_fid.fid;
 	cm_entry.info = NULL;
@@ -238,8 +239,7 @@ void xnet_uring_req_done(struct xnet_ep *ep, int res)
 	}
 
 	ep->pollflags = POLLIN;
-	ret = xnet_uring_pollin_add(xnet_ep2_progress(ep), ep->bsock.sock,
-				    false, &ep->bsock.pollin_sockctx);
+	ret = xnet_uring_monitor_ep(ep);
 	if (ret)
 		goto disable;
 
@@ -301,6 +301,7 @@ void xnet_handle_conn(struct xnet_conn_handle *conn, bool error)
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "conn req for src",
 				    cm_entry.info->src_addr);
 	conn->endian_match = (msg.hdr.conn_data == 1);
+	conn->rndv = !!(ntohl(msg.hdr.seg_no) & XNET_CM_RNDV);
 	cm_entry.info->handle = &conn->fid;
 	datalen = ntohs(msg.hdr.seg_size);
 	if (datalen)
@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
 
 #include "xnet.h"
 
@@ -130,6 +131,16 @@ void xnet_report_success(struct xnet_xfer_entry *xfer_entry)
 	uint64_t flags, data, tag;
 	size_t len;
 
+	if (xfer_entry->ctrl_flags & (XNET_STRIPE_XFER | XNET_STRIPE_ERR)) {
+		if (xfer_entry->ctrl_flags & XNET_STRIPE_XFER) {
+			xnet_stripe_done(xfer_entry, 0);
+		} else {
+			xnet_cntr_incerr(xfer_entry);
+			xnet_report_error(xfer_entry, FI_EIO);
+		}
+		return;
+	}
+
 	if (xfer_entry->ctrl_flags & (XNET_INTERNAL_XFER | XNET_SAVED_XFER))
 		return;
 
@@ -165,7 +176,7 @@ void xnet_report_success(struct xnet_xfer_entry *xfer_entry)
 		tag = 0;
 	}
 
-	if (cq->src) {
+	if (cq->domain->info_domain_caps & FI_SOURCE) {
 		ofi_cq_write_src(cq, xfer_entry->context, flags, len,
 				 xfer_entry->user_buf, data, tag,
 				 xfer_entry->src_addr);
@@ -181,6 +192,15 @@ void xnet_report_error(struct xnet_xfer_entry *xfer_entry, int err)
 {
 	struct fi_cq_err_entry err_entry;
 
+	if (xfer_entry->ctrl_flags & XNET_STRIPE_XFER) {
+		xnet_stripe_done(xfer_entry, err);
+		return;
+	} else if (xfer_entry->ctrl_flags & XNET_STRIPE_WAIT) {
+		/* flushed before the other pieces completed */
+		xfer_entry->stripe->parent = NULL;
+		xfer_entry->ctrl_flags &= ~XNET_STRIPE_WAIT;
+	}
+
 	if (xfer_entry->ctrl_flags &
 	    (XNET_INTERNAL_XFER | XNET_SAVED_XFER | XNET_INJECT_OP)) {
 		if (xfer_entry->ctrl_flags &
@@ -258,6 +278,7 @@ static int xnet_cq_wait_try_func(void *arg)
 int xnet_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 		 struct fid_cq **cq_fid, void *context)
 {
+	struct xnet_domain *xnet_domain;
 	struct xnet_cq *cq;
 	struct fi_cq_attr cq_attr;
 	int ret;
@@ -280,6 +301,19 @@ int xnet_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	if (ret)
 		goto free_cq;
 
+	/* Progress shards write completions in parallel with app reads,
+	 * independent of the threading model requested by the app.
+	 */
+	xnet_domain = container_of(domain, struct xnet_domain,
+				   util_domain.domain_fid);
+	if (xnet_domain->shard_cnt &&
+	    cq->util_cq.cq_lock.lock_type != OFI_LOCK_MUTEX) {
+		ofi_genlock_destroy(&cq->util_cq.cq_lock);
+		ret = ofi_genlock_init(&cq->util_cq.cq_lock, OFI_LOCK_MUTEX);
+		if (ret)
+			goto cleanup;
+	}
+
 	if (cq->util_cq.wait && ofi_have_epoll) {
 		ret = ofi_wait_add_fd(cq->util_cq.wait,
 			       ofi_dynpoll_get_fd(&xnet_cq2_progress(cq)->epoll_fd),
@@ -302,9 +336,41 @@ free_cq:
 }
 
 
+/* Endpoints on progress shards are not in the domain poll set.  Drive
+ * every shard bound to the counter.  Returns false if there are none.
+ */
+static bool xnet_cntr_progress_shards(struct util_cntr *cntr)
+{
+	struct fid_list_entry *fid_entry;
+	struct xnet_progress *progress;
+	struct util_ep *util_ep;
+	struct xnet_ep *ep;
+	bool sharded = false;
+
+	ofi_mutex_lock(&cntr->ep_list_lock);
+	dlist_foreach_container(&cntr->ep_list, struct fid_list_entry,
+				fid_entry, entry) {
+		util_ep = container_of(fid_entry->fid, struct util_ep,
+				       ep_fid.fid);
+		if (util_ep->type != FI_EP_MSG)
+			continue;
+
+		ep = container_of(util_ep, struct xnet_ep, util_ep);
+		progress = xnet_ep2_progress(ep);
+		if (progress == xnet_cntr2_progress(cntr))
+			continue;
+
+		xnet_progress(progress, false);
+		sharded = true;
+	}
+	ofi_mutex_unlock(&cntr->ep_list_lock);
+	return sharded;
+}
+
 static void xnet_cntr_progress(struct util_cntr *cntr)
 {
 	xnet_progress(xnet_cntr2_progress(cntr), false);
+	(void) xnet_cntr_progress_shards(cntr);
 }
 
 void xnet_cntr_incerr(struct xnet_xfer_entry *xfer_entry)
@@ -321,7 +387,7 @@ static uint64_t xnet_cntr_read(struct fid_cntr *cntr_fid)
 	struct util_cntr *cntr;
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
-	xnet_progress(xnet_cntr2_progress(cntr), false);
+	xnet_cntr_progress(cntr);
 	return ofi_atomic_get64(&cntr->cnt);
 }
 
@@ -330,7 +396,7 @@ static uint64_t xnet_cntr_readerr(struct fid_cntr *cntr_fid)
 	struct util_cntr *cntr;
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
-	xnet_progress(xnet_cntr2_progress(cntr), false);
+	xnet_cntr_progress(cntr);
 	return ofi_atomic_get64(&cntr->err);
 }
 
@@ -395,6 +461,12 @@ xnet_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 		if (ofi_adjust_timeout(endtime, &timeout))
 			return -FI_ETIMEDOUT;
 
+		if (xnet_cntr_progress_shards(cntr)) {
+			xnet_progress(xnet_cntr2_progress(cntr), false);
+			sched_yield();
+			continue;
+		}
+
 		ret = xnet_progress_wait(xnet_cntr2_progress(cntr), timeout);
 		if (ret < 0)
 			break;
@@ -445,7 +517,7 @@ int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 			      util_domain.domain_fid);
 	if (attr->wait_obj == FI_WAIT_UNSPEC) {
 		cntr_attr = *attr;
-		if (domain->progress.auto_progress ||
+		if (domain->progress.auto_progress || domain->shard_cnt ||
 		    domain->util_domain.threading != FI_THREAD_DOMAIN) {
 			cntr_attr.wait_obj = FI_WAIT_FD;
 		} else {
@@ -181,6 +181,63 @@ static struct fi_ops_domain xnet_domain_ops = {
 	.query_collective = fi_no_query_collective,
 };
 
+static void xnet_close_shards(struct xnet_domain *domain)
+{
+	int i;
+
+	for (i = 0; i < domain->shard_cnt; i++)
+		xnet_close_progress(&domain->shards[i]);
+
+	free(domain->shards);
+	domain->shards = NULL;
+	domain->shard_cnt = 0;
+}
+
+/* Shards are only driven by their own progress threads.  Application
+ * calls that drive progress (e.g. reading a CQ) only operate on the
+ * domain's progress instance.
+ */
+static int xnet_init_shards(struct xnet_domain *domain, struct fi_info *info)
+{
+	int ret;
+
+	ofi_atomic_initialize32(&domain->shard_idx, 0);
+	if (!xnet_progress_shards || info->ep_attr->type != FI_EP_MSG)
+		return 0;
+
+	if (xnet_disable_autoprog) {
+		FI_WARN(&xnet_prov, FI_LOG_DOMAIN, "progress shards require "
+			"auto-progress, using a single progress engine\n");
+		return 0;
+	}
+
+	domain->shards = calloc(xnet_progress_shards,
+				sizeof(*domain->shards));
+	if (!domain->shards)
+		return -FI_ENOMEM;
+
+	for (; domain->shard_cnt < xnet_progress_shards; domain->shard_cnt++) {
+		ret = xnet_init_progress(&domain->shards[domain->shard_cnt],
+					 info);
+		if (ret)
+			goto err;
+
+		ret = xnet_start_progress(&domain->shards[domain->shard_cnt]);
+		if (ret) {
+			xnet_close_progress(&domain->shards[domain->shard_cnt]);
+			goto err;
+		}
+	}
+
+	FI_INFO(&xnet_prov, FI_LOG_DOMAIN, "using %d progress shards\n",
+		domain->shard_cnt);
+	return 0;
+
+err:
+	xnet_close_shards(domain);
+	return ret;
+}
+
 static int xnet_domain_close(fid_t fid)
 {
 	struct xnet_domain *domain;
@@ -194,6 +251,7 @@ static int xnet_domain_close(fid_t fid)
 	if (ret)
 		return ret;
 
+	xnet_close_shards(domain);
 	xnet_close_progress(&domain->progress);
 	free(domain);
 	return FI_SUCCESS;
@@ -230,8 +288,11 @@ int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
 	if (!domain)
 		return -FI_ENOMEM;
 
+	/* The MR map is accessed from all progress shards */
 	ret = ofi_domain_init(fabric_fid, info, &domain->util_domain, context,
-			      OFI_LOCK_NONE);
+			      (xnet_progress_shards &&
+			       info->ep_attr->type == FI_EP_MSG) ?
+			      OFI_LOCK_MUTEX : OFI_LOCK_NONE);
 	if (ret)
 		goto free;
 
@@ -239,6 +300,10 @@ int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
 	if (ret)
 		goto close;
 
+	ret = xnet_init_shards(domain, info);
+	if (ret)
+		goto close_prog;
+
 	domain->ep_type = info->ep_attr->type;
 	domain->util_domain.domain_fid.fid.ops = &xnet_domain_fi_ops;
 	domain->util_domain.domain_fid.ops = &xnet_domain_ops;
@@ -247,6 +312,8 @@ int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
 
 	return FI_SUCCESS;
 
+close_prog:
+	xnet_close_progress(&domain->progress);
 close:
 	(void) ofi_domain_close(&domain->util_domain);
 free:
@@ -141,6 +141,19 @@ void xnet_set_zerocopy(SOCKET sock)
 #define xnet_config_bsock(bsock)
 #endif
 
+/* io_uring zero copy sends do not require SO_ZEROCOPY */
+static void xnet_config_uring_bsock(struct xnet_ep *ep)
+{
+	if (xnet_zerocopy_size == SIZE_MAX ||
+	    !xnet_ep2_progress(ep)->tx_uring.send_zc)
+		return;
+
+	ep->bsock.zerocopy_size = xnet_zerocopy_size;
+	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+		"io_uring zero copy enabled for transfers > %zu\n",
+		ep->bsock.zerocopy_size);
+}
+
 #ifdef IP_BIND_ADDRESS_NO_PORT
 static void xnet_set_no_port(SOCKET sock)
 {
@@ -180,6 +193,19 @@ int xnet_setup_socket(SOCKET sock, struct fi_info *info)
 		}
 	}
 
+#ifdef SO_BUSY_POLL
+	if (xnet_busy_poll > 0) {
+		ret = setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL,
+				 (char *) &xnet_busy_poll,
+				 sizeof(xnet_busy_poll));
+		if (ret) {
+			FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
+				"setsockopt busy_poll failed (%d)\n",
+				ofi_sockerr());
+		}
+	}
+#endif
+
 	ret = fi_fd_nonblock(sock);
 	if (ret) {
 		FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
@@ -194,8 +220,7 @@ static int xnet_monitor_ep(struct xnet_progress *progress, struct xnet_ep *ep)
 {
 	if (xnet_io_uring) {
 		assert(!(ep->pollflags & POLLOUT));
-		return xnet_uring_pollin_add(progress, ep->bsock.sock,
-					     false, &ep->bsock.pollin_sockctx);
+		return xnet_uring_monitor_ep(ep);
 	}
 
 	return xnet_monitor_sock(progress, ep->bsock.sock, ep->pollflags,
@@ -219,6 +244,7 @@ static int xnet_ep_connect(struct fid_ep *ep_fid, const void *addr,
 	ep->cm_msg->hdr.version = XNET_CTRL_HDR_VERSION;
 	ep->cm_msg->hdr.type = ofi_ctrl_connreq;
 	ep->cm_msg->hdr.conn_data = 1; /* tests endianess mismatch at peer */
+	ep->cm_msg->hdr.seg_no = htonl(XNET_CM_RNDV);
 	if (paramlen) {
 		memcpy(ep->cm_msg->data, param, paramlen);
 		ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
@@ -286,6 +312,7 @@ xnet_ep_accept(struct fid_ep *ep_fid, const void *param, size_t paramlen)
 	ep->cm_msg->hdr.version = XNET_CTRL_HDR_VERSION;
 	ep->cm_msg->hdr.type = ofi_ctrl_connresp;
 	ep->cm_msg->hdr.conn_data = 1; /* tests endianess mismatch at peer */
+	ep->cm_msg->hdr.seg_no = htonl(XNET_CM_RNDV);
 	if (paramlen) {
 		memcpy(ep->cm_msg->data, param, paramlen);
 		ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
@@ -300,18 +327,23 @@ xnet_ep_accept(struct fid_ep *ep_fid, const void *param, size_t paramlen)
 	ep->state = XNET_CONNECTED;
 	assert(!ofi_bsock_readable(&ep->bsock) && !ep->cur_rx.handler);
 
+	/* Hold the progress lock until the connected event has been written,
+	 * so that a progress thread cannot report a shutdown ahead of it.
+	 */
 	progress = xnet_ep2_progress(ep);
 	ofi_genlock_lock(&progress->ep_lock);
 	ep->pollflags = POLLIN;
 	ret = xnet_monitor_ep(progress, ep);
-	ofi_genlock_unlock(&progress->ep_lock);
-	if (ret)
+	if (ret) {
+		ofi_genlock_unlock(&progress->ep_lock);
 		return ret;
+	}
 
 	cm_entry.fid = &ep->util_ep.ep_fid.fid;
 	cm_entry.info = NULL;
 	ret = xnet_eq_write(ep->util_ep.eq, FI_CONNECTED, &cm_entry,
 			    sizeof(cm_entry), 0);
+	ofi_genlock_unlock(&progress->ep_lock);
 	if (ret < 0) {
 		FI_WARN(&xnet_prov, FI_LOG_EP_CTRL, "Error writing to EQ\n");
 		return ret;
@@ -336,6 +368,23 @@ void xnet_flush_xfer_queue(struct xnet_progress *progress, struct slist *queue)
 	}
 }
 
+/* Restore headers of queued transfers that were prepared for coalescing,
+ * so that errors are reported using host byte order.
+ */
+static void xnet_unprep_tx_queue(struct xnet_ep *ep, struct slist *queue)
+{
+	struct xnet_xfer_entry *tx_entry;
+	struct slist_entry *item;
+
+	for (item = queue->head; item; item = item->next) {
+		tx_entry = container_of(item, struct xnet_xfer_entry, entry);
+		if (tx_entry->ctrl_flags & XNET_TX_PREPPED) {
+			ep->hdr_bswap(ep, &tx_entry->hdr.base_hdr);
+			tx_entry->ctrl_flags &= ~XNET_TX_PREPPED;
+		}
+	}
+}
+
 static void xnet_ep_flush_all_queues(struct xnet_ep *ep)
 {
 	struct xnet_progress *progress;
@@ -369,13 +418,21 @@ static void xnet_ep_flush_all_queues(struct xnet_ep *ep)
 		ep->cur_tx.entry = NULL;
 	}
 
+	xnet_unprep_tx_queue(ep, &ep->tx_queue);
+	xnet_unprep_tx_queue(ep, &ep->priority_queue);
 	xnet_flush_xfer_queue(progress, &ep->tx_queue);
 	xnet_flush_xfer_queue(progress, &ep->priority_queue);
 	xnet_flush_xfer_queue(progress, &ep->rma_read_queue);
+	xnet_flush_xfer_queue(progress, &ep->rndv_tx_queue);
+	xnet_flush_xfer_queue(progress, &ep->rndv_rx_queue);
 	xnet_flush_xfer_queue(progress, &ep->need_ack_queue);
 	xnet_flush_xfer_queue(progress, &ep->async_queue);
 
-	/* Saved messages are on the saved_msg queue and flushed by the srx */
+	/* Saved messages are on the saved_msg queue and flushed by the srx,
+	 * except for rendezvous requests, which can only complete over this
+	 * connection.
+	 */
+	xnet_srx_flush_rts(ep);
 	if (ep->cur_rx.entry &&
 	    !(ep->cur_rx.entry->ctrl_flags & XNET_SAVED_XFER)) {
 		xnet_report_error(ep->cur_rx.entry, FI_ECANCELED);
@@ -383,6 +440,7 @@ static void xnet_ep_flush_all_queues(struct xnet_ep *ep)
 	}
 	xnet_reset_rx(ep);
 	xnet_flush_xfer_queue(progress, &ep->rx_queue);
+	dlist_remove_init(&ep->rx_buf_entry);
 	ofi_bsock_discard(&ep->bsock);
 }
 
@@ -495,6 +553,7 @@ void xnet_reset_rx(struct xnet_ep *ep)
 	ep->cur_rx.hdr_done = 0;
 	ep->cur_rx.hdr_len = sizeof(ep->cur_rx.hdr.base_hdr);
 	ep->cur_rx.claim_ctx = NULL;
+	ep->cur_rx.peeked = false;
 	OFI_DBG_SET(ep->cur_rx.hdr.base_hdr.version, 0);
 }
 
@@ -561,6 +620,7 @@ static int xnet_ep_close(struct fid *fid)
 		xnet_halt_sock(progress, ep->bsock.sock);
 	ofi_close_socket(ep->bsock.sock);
 	xnet_ep_flush_all_queues(ep);
+	xnet_uring_drain_zc(ep);
 	ofi_genlock_unlock(&progress->ep_lock);
 
 	if (ep->bsock.tx_sockctx.uring_sqe_inuse ||
@@ -609,7 +669,16 @@ static int xnet_ep_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 
 	switch (bfid->fclass) {
 	case FI_CLASS_SRX_CTX:
+		/* The srx queues are serialized by the domain progress lock */
 		srx = container_of(bfid, struct xnet_srx, rx_fid.fid);
+		if (ep->progress != xnet_srx2_progress(srx)) {
+			if (ep->state != XNET_IDLE &&
+			    ep->state != XNET_ACCEPTING)
+				return -FI_EOPBADSTATE;
+
+			ep->progress = xnet_srx2_progress(srx);
+			ep->bsock.sockapi = &ep->progress->sockapi;
+		}
 		ep->srx = srx;
 		return FI_SUCCESS;
 	case FI_CLASS_EQ:
@@ -698,6 +767,8 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 		goto err1;
 
 	assert(info->ep_attr->type == FI_EP_MSG);
+	ep->progress = xnet_domain_ep_progress(container_of(domain,
+					struct xnet_domain, util_domain.domain_fid));
 	ofi_bsock_init(&ep->bsock, &xnet_ep2_progress(ep)->sockapi,
 		       xnet_staging_sbuf_size, xnet_prefetch_rbuf_size,
 		       &ep->util_ep.ep_fid);
@@ -722,6 +793,7 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 				ep->hdr_bswap = conn->endian_match ?
 						xnet_hdr_none : xnet_hdr_bswap;
 			}
+			ep->rndv = conn->rndv;
 			/* Save handle, but we only free if user calls accept.
 			 * Otherwise, user will call reject, which will free it.
 			 */
@@ -769,10 +841,13 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 	}
 
 	dlist_init(&ep->unexp_entry);
+	dlist_init(&ep->rx_buf_entry);
 	slist_init(&ep->rx_queue);
 	slist_init(&ep->tx_queue);
 	slist_init(&ep->priority_queue);
 	slist_init(&ep->rma_read_queue);
+	slist_init(&ep->rndv_tx_queue);
+	slist_init(&ep->rndv_rx_queue);
 	slist_init(&ep->need_ack_queue);
 	slist_init(&ep->async_queue);
 
@@ -781,7 +856,10 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	ep->cur_rx.hdr_done = 0;
 	ep->cur_rx.hdr_len = sizeof(ep->cur_rx.hdr.base_hdr);
-	xnet_config_bsock(&ep->bsock);
+	if (xnet_io_uring)
+		xnet_config_uring_bsock(ep);
+	else
+		xnet_config_bsock(&ep->bsock);
 
 	*ep_fid = &ep->util_ep.ep_fid;
 	(*ep_fid)->fid.ops = &xnet_ep_fi_ops;
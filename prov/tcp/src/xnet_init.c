@@ -64,13 +64,23 @@ int xnet_prefetch_rbuf_size = 9000;
 size_t xnet_default_tx_size = 256;
 size_t xnet_default_rx_size = 256;
 size_t xnet_zerocopy_size = SIZE_MAX;
+size_t xnet_tx_coalesce_size = 65536;
+int xnet_rdm_streams = 1;
+size_t xnet_rdm_stripe_size = 262144;
 int xnet_trace_msg;
 int xnet_disable_autoprog;
 int xnet_io_uring;
+int xnet_io_uring_rx_bufs;
+int xnet_progress_shards;
+int xnet_progress_spin;
+char *xnet_progress_affinity;
+int xnet_busy_poll;
 int xnet_max_saved = 64;
 size_t xnet_max_inject = XNET_DEF_INJECT;
 size_t xnet_buf_size = XNET_DEF_BUF_SIZE;
 size_t xnet_max_saved_size = SIZE_MAX;
+size_t xnet_unexp_peek_size = 4096;
+size_t xnet_rndv_size = 65536;
 
 
 static void xnet_init_env(void)
@@ -140,6 +150,21 @@ static void xnet_init_env(void)
 			"overhead to handle unexpected messages, but may be "
 			"required by some applications to prevents hangs.");
 	fi_param_get_size_t(&xnet_prov, "max_saved_size", &xnet_max_saved_size);
+	fi_param_define(&xnet_prov, "unexp_peek_size", FI_PARAM_SIZE_T,
+			"maximum size of an unexpected tagged message that "
+			"is left in the prefetch buffer until a matching "
+			"receive is posted, rather than being buffered by "
+			"the provider, set to 0 to disable (default: %zu)",
+			xnet_unexp_peek_size);
+	fi_param_get_size_t(&xnet_prov, "unexp_peek_size",
+			    &xnet_unexp_peek_size);
+	fi_param_define(&xnet_prov, "rndv_size", FI_PARAM_SIZE_T,
+			"minimum size of a tagged message that is sent "
+			"using a rendezvous protocol, where the data is only "
+			"transferred after the receiver has matched the "
+			"message, set to 0 to disable (default: %zu)",
+			xnet_rndv_size);
+	fi_param_get_size_t(&xnet_prov, "rndv_size", &xnet_rndv_size);
 
 	fi_param_define(&xnet_prov, "max_rx_size", FI_PARAM_SIZE_T,
 			"maximum size for message buffers. If set lower "
@@ -174,6 +199,13 @@ static void xnet_init_env(void)
 			 &xnet_prefetch_rbuf_size);
 	fi_param_get_size_t(&xnet_prov, "zerocopy_size", &xnet_zerocopy_size);
 
+	fi_param_define(&xnet_prov, "tx_coalesce_size", FI_PARAM_SIZE_T,
+			"maximum number of bytes from queued transmits "
+			"combined into a single sendmsg call, set to 0 to "
+			"disable (default: %zu)", xnet_tx_coalesce_size);
+	fi_param_get_size_t(&xnet_prov, "tx_coalesce_size",
+			    &xnet_tx_coalesce_size);
+
 	fi_param_define(&xnet_prov, "trace_msg", FI_PARAM_BOOL,
 			"Capture and display transport message information "
 			"when FI_LOG_LEVEL=TRACE is specified");
@@ -186,6 +218,68 @@ static void xnet_init_env(void)
 			"Enable io_uring support if available (default: %d)", xnet_io_uring);
 	fi_param_get_bool(&xnet_prov, "io_uring",
 			 &xnet_io_uring);
+	fi_param_define(&xnet_prov, "io_uring_rx_bufs", FI_PARAM_INT,
+			"Number of receive buffers, each prefetch_rbuf_size "
+			"bytes, registered with io_uring per progress engine.  "
+			"If set, connected endpoints receive data using "
+			"multishot receives into these buffers.  Rounded up "
+			"to a power of 2.  Requires io_uring (default: %d)",
+			xnet_io_uring_rx_bufs);
+	fi_param_get_int(&xnet_prov, "io_uring_rx_bufs",
+			 &xnet_io_uring_rx_bufs);
+	if (xnet_io_uring_rx_bufs <= 0 || xnet_prefetch_rbuf_size <= 0)
+		xnet_io_uring_rx_bufs = 0;
+	else if (xnet_io_uring_rx_bufs > (1 << 15))
+		xnet_io_uring_rx_bufs = 1 << 15;
+	else
+		xnet_io_uring_rx_bufs = (int) roundup_power_of_two(
+						xnet_io_uring_rx_bufs);
+	fi_param_define(&xnet_prov, "progress_shards", FI_PARAM_INT,
+			"Number of progress engines, each serviced by its "
+			"own thread, across which msg endpoints of a domain "
+			"are distributed.  Set to 0 to use a single progress "
+			"engine per domain (default: %d)", xnet_progress_shards);
+	fi_param_get_int(&xnet_prov, "progress_shards", &xnet_progress_shards);
+	if (xnet_progress_shards < 0)
+		xnet_progress_shards = 0;
+	fi_param_define(&xnet_prov, "rdm_streams", FI_PARAM_INT,
+			"Number of TCP connections used to reach each peer "
+			"of an rdm endpoint.  Large RMA writes are striped "
+			"across the connections, up to %d (default: %d)",
+			XNET_MAX_STREAMS, xnet_rdm_streams);
+	fi_param_get_int(&xnet_prov, "rdm_streams", &xnet_rdm_streams);
+	if (xnet_rdm_streams < 1)
+		xnet_rdm_streams = 1;
+	else if (xnet_rdm_streams > XNET_MAX_STREAMS)
+		xnet_rdm_streams = XNET_MAX_STREAMS;
+	fi_param_define(&xnet_prov, "rdm_stripe_size", FI_PARAM_SIZE_T,
+			"Minimum size of an RMA write striped across multiple "
+			"connections when rdm_streams is set (default: %zu)",
+			xnet_rdm_stripe_size);
+	fi_param_get_size_t(&xnet_prov, "rdm_stripe_size",
+			    &xnet_rdm_stripe_size);
+
+	fi_param_define(&xnet_prov, "progress_spin", FI_PARAM_INT,
+			"Maximum time in microseconds that the progress "
+			"thread polls for events before blocking.  The "
+			"actual interval adapts to traffic.  Set to -1 to "
+			"poll without ever blocking (default: %d)",
+			xnet_progress_spin);
+	fi_param_get_int(&xnet_prov, "progress_spin", &xnet_progress_spin);
+	if (xnet_progress_spin < -1)
+		xnet_progress_spin = -1;
+	fi_param_define(&xnet_prov, "progress_affinity", FI_PARAM_STRING,
+			"CPU list to which progress threads are bound, "
+			"specified as a comma separated list of cpus or "
+			"ranges, with an optional stride, e.g. 0-3,8-14:2 "
+			"(default: none)");
+	fi_param_get_str(&xnet_prov, "progress_affinity",
+			 &xnet_progress_affinity);
+	fi_param_define(&xnet_prov, "busy_poll", FI_PARAM_INT,
+			"Value in microseconds applied to the SO_BUSY_POLL "
+			"socket option of connected sockets, set to 0 to "
+			"use the system default (default: %d)", xnet_busy_poll);
+	fi_param_get_int(&xnet_prov, "busy_poll", &xnet_busy_poll);
 }
 
 static void xnet_fini(void)
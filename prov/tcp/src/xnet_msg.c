@@ -147,6 +147,52 @@ xnet_init_tx_iov(struct xnet_xfer_entry *tx_entry, size_t hdr_len,
 	}
 }
 
+/* Large tagged messages are announced with an RTS, and the payload is
+ * held until the peer has matched the receive.  See struct xnet_rts.
+ */
+static int
+xnet_tx_queue_tagged(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
+{
+	struct xnet_xfer_entry *rts;
+	size_t hdr_len, data_len;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	hdr_len = tx_entry->hdr.base_hdr.hdr_size;
+	data_len = tx_entry->hdr.base_hdr.size - hdr_len;
+	if (!ep->rndv || !xnet_rndv_size || (data_len < xnet_rndv_size) ||
+	    (data_len <= xnet_max_inject)) {
+		xnet_tx_queue_insert(ep, tx_entry);
+		return 0;
+	}
+
+	rts = xnet_alloc_xfer(xnet_ep2_progress(ep));
+	if (!rts)
+		return -FI_EAGAIN;
+
+	memcpy(&rts->hdr, &tx_entry->hdr, hdr_len);
+	rts->hdr.base_hdr.flags |= XNET_RNDV;
+	rts->hdr.base_hdr.hdr_size = (uint8_t) (hdr_len + sizeof(struct xnet_rts));
+	rts->hdr.base_hdr.size = rts->hdr.base_hdr.hdr_size;
+	xnet_hdr_rts(&rts->hdr)->size = data_len;
+	xnet_hdr_rts(&rts->hdr)->id = (uintptr_t) tx_entry;
+
+	rts->iov[0].iov_base = (void *) &rts->hdr;
+	rts->iov[0].iov_len = rts->hdr.base_hdr.hdr_size;
+	rts->iov_cnt = 1;
+	rts->ctrl_flags = XNET_INTERNAL_XFER | XNET_RTS_XFER;
+
+	slist_insert_tail(&tx_entry->entry, &ep->rndv_tx_queue);
+
+	/* The RTS must stay ordered with other tagged sends, so it is not
+	 * placed on the priority queue.
+	 */
+	if (ep->cur_tx.entry)
+		slist_insert_tail(&rts->entry, &ep->tx_queue);
+	else
+		xnet_tx_queue_insert(ep, rts);
+	return 0;
+}
+
 static inline bool
 xnet_queue_recv(struct xnet_ep *ep, struct xnet_xfer_entry *recv_entry)
 {
@@ -509,7 +555,9 @@ xnet_tsendmsg(struct fid_ep *fid_ep, const struct fi_msg_tagged *msg,
 	xnet_set_ack_flags(tx_entry, flags);
 	tx_entry->context = msg->context;
 
-	xnet_tx_queue_insert(ep, tx_entry);
+	ret = xnet_tx_queue_tagged(ep, tx_entry);
+	if (ret)
+		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
 unlock:
 	ofi_genlock_unlock(&xnet_ep2_progress(ep)->ep_lock);
 	return ret;
@@ -540,7 +588,9 @@ xnet_tsend(struct fid_ep *fid_ep, const void *buf, size_t len,
 			     FI_TAGGED | FI_SEND;
 	xnet_set_ack_flags(tx_entry, ep->util_ep.tx_op_flags);
 
-	xnet_tx_queue_insert(ep, tx_entry);
+	ret = xnet_tx_queue_tagged(ep, tx_entry);
+	if (ret)
+		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
 unlock:
 	ofi_genlock_unlock(&xnet_ep2_progress(ep)->ep_lock);
 	return ret;
@@ -571,7 +621,9 @@ xnet_tsendv(struct fid_ep *fid_ep, const struct iovec *iov, void **desc,
 			     FI_TAGGED | FI_SEND;
 	xnet_set_ack_flags(tx_entry, ep->util_ep.tx_op_flags);
 
-	xnet_tx_queue_insert(ep, tx_entry);
+	ret = xnet_tx_queue_tagged(ep, tx_entry);
+	if (ret)
+		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
 unlock:
 	ofi_genlock_unlock(&xnet_ep2_progress(ep)->ep_lock);
 	return ret;
@@ -635,7 +687,9 @@ xnet_tsenddata(struct fid_ep *fid_ep, const void *buf, size_t len, void *desc,
 			     FI_TAGGED | FI_SEND;
 	xnet_set_ack_flags(tx_entry, ep->util_ep.tx_op_flags);
 
-	xnet_tx_queue_insert(ep, tx_entry);
+	ret = xnet_tx_queue_tagged(ep, tx_entry);
+	if (ret)
+		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
 unlock:
 	ofi_genlock_unlock(&xnet_ep2_progress(ep)->ep_lock);
 	return ret;
@@ -45,6 +45,7 @@
 
 
 static int (*xnet_start_op[ofi_op_write + 1])(struct xnet_ep *ep);
+static int xnet_queue_cts(struct xnet_ep *ep, struct xnet_xfer_entry *rx_entry);
 
 static struct ofi_sockapi xnet_sockapi_uring =
 {
@@ -140,6 +141,7 @@ xnet_get_save_rx(struct xnet_ep *ep, uint64_t tag)
 	}
 
 	slist_insert_tail(&rx_entry->entry, &ep->saved_msg->queue);
+	dlist_insert_tail(&rx_entry->tag_entry, xnet_saved_bucket(ep->srx, tag));
 	if (!ep->saved_msg->cnt++) {
 		assert(dlist_empty(&ep->saved_msg->entry));
 		dlist_insert_tail(&ep->saved_msg->entry,
@@ -250,7 +252,28 @@ void xnet_recv_saved(struct xnet_xfer_entry *saved_entry,
 		saved_entry->iov_cnt = rx_entry->iov_cnt;
 	}
 
-	if (!saved_entry->saving_ep) {
+	if (saved_entry->hdr.base_hdr.flags & XNET_RNDV) {
+		/* Only the request was saved, ask the peer for the data */
+		ep = saved_entry->saving_ep;
+		saved_entry->saving_ep = NULL;
+		assert(ep && !buf2free);
+		msg_len = (saved_entry->hdr.base_hdr.size -
+			   saved_entry->hdr.base_hdr.hdr_size);
+		if (!rx_entry->iov_cnt)
+			saved_entry->iov_cnt = 0;
+		if (rx_entry->ctrl_flags & XNET_FREE_BUF) {
+			/* discard buffer, released when the data arrives */
+			saved_entry->ctrl_flags |= XNET_FREE_BUF;
+			rx_entry->ctrl_flags &= ~XNET_FREE_BUF;
+		}
+		(void) ofi_truncate_iov(&saved_entry->iov[0],
+					&saved_entry->iov_cnt, msg_len);
+		if (xnet_queue_cts(ep, saved_entry)) {
+			xnet_cntr_incerr(saved_entry);
+			xnet_report_error(saved_entry, FI_ENOMEM);
+			xnet_free_xfer(progress, saved_entry);
+		}
+	} else if (!saved_entry->saving_ep) {
 		xnet_complete_saved(saved_entry, msg_data);
 		free(buf2free);
 	/* TODO: io_uring support
@@ -339,8 +362,11 @@ static int xnet_update_pollflag(struct xnet_ep *ep, short pollflag, bool set)
 		}
 
 		if ((ep->pollflags & POLLIN) &&
-			ep->bsock.rx_sockctx.uring_sqe_inuse) {
-			/* A RX SQE is in use and will wake us up */
+		    (ep->bsock.rx_sockctx.uring_sqe_inuse || ep->bsock.bufring)) {
+			/* A RX SQE is in use and will wake us up, or a
+			 * multishot receive will be re-armed once receive
+			 * buffers are available.
+			 */
 			ep->pollflags &= ~POLLIN;
 			assert((ep->pollflags & (POLLIN | POLLOUT)) == 0);
 			return 0;
@@ -359,26 +385,29 @@ static int xnet_update_pollflag(struct xnet_ep *ep, short pollflag, bool set)
 static int xnet_send_msg(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *tx_entry;
+	uint32_t async_index;
 	int ret;
 	size_t len;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
 	assert(ep->cur_tx.entry);
 	tx_entry = ep->cur_tx.entry;
+	async_index = ep->bsock.async_index;
 	ret = ofi_bsock_sendv(&ep->bsock, tx_entry->iov, tx_entry->iov_cnt,
 			      &len);
-	if (ret < 0 && ret != -OFI_EINPROGRESS_ASYNC)
-		return ret;
-
-	if (ret == -OFI_EINPROGRESS_ASYNC) {
+	if (ep->bsock.async_index != async_index) {
 		/* If a transfer generated multiple async sends, we only
 		 * need to track the last async index to know when the entire
-		 * transfer has completed.
+		 * transfer has completed.  This includes zero copy sends
+		 * posted to io_uring.
 		 */
 		tx_entry->async_index = ep->bsock.async_index;
 		tx_entry->ctrl_flags |= XNET_ASYNC;
 	}
 
+	if (ret < 0 && ret != -OFI_EINPROGRESS_ASYNC)
+		return ret;
+
 	ep->cur_tx.data_left -= len;
 	if (ep->cur_tx.data_left) {
 		ofi_consume_iov(tx_entry->iov, &tx_entry->iov_cnt, len);
@@ -424,6 +453,18 @@ start:
 	return -FI_EAGAIN;
 }
 
+/* Assign the debug id and convert the header to wire format.  This is
+ * done once per transfer, either when it becomes the current transfer or
+ * when it is coalesced with the current transfer.
+ */
+static void xnet_prep_tx(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
+{
+	assert(!(tx_entry->ctrl_flags & XNET_TX_PREPPED));
+	OFI_DBG_SET(tx_entry->hdr.base_hdr.id, ep->tx_id++);
+	ep->hdr_bswap(ep, &tx_entry->hdr.base_hdr);
+	tx_entry->ctrl_flags |= XNET_TX_PREPPED;
+}
+
 static void xnet_complete_tx(struct xnet_ep *ep, int ret)
 {
 	struct xnet_xfer_entry *tx_entry;
@@ -435,6 +476,9 @@ static void xnet_complete_tx(struct xnet_ep *ep, int ret)
 		xnet_cntr_incerr(tx_entry);
 		xnet_report_error(tx_entry, -ret);
 		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
+	} else if (tx_entry->ctrl_flags & XNET_RTS_XFER) {
+		/* The payload is sent once the peer matches the receive */
+		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
 	} else if (tx_entry->ctrl_flags & XNET_NEED_ACK) {
 		/* A SW ack guarantees the peer received the data, so
 		 * we can skip the async completion.
@@ -464,15 +508,118 @@ static void xnet_complete_tx(struct xnet_ep *ep, int ret)
 		ep->cur_tx.entry = container_of(slist_remove_head(
 						&ep->tx_queue),
 				     struct xnet_xfer_entry, entry);
-		assert(!(ep->cur_tx.entry->ctrl_flags & XNET_INTERNAL_XFER));
+		/* An RTS is queued here to keep it ordered with other tagged
+		 * sends.
+		 */
+		assert(!(ep->cur_tx.entry->ctrl_flags & XNET_INTERNAL_XFER) ||
+		       (ep->cur_tx.entry->ctrl_flags & XNET_RTS_XFER));
 	} else {
 		ep->cur_tx.entry = NULL;
 		return;
 	}
 
-	ep->cur_tx.data_left = ep->cur_tx.entry->hdr.base_hdr.size;
-	OFI_DBG_SET(ep->cur_tx.entry->hdr.base_hdr.id, ep->tx_id++);
-	ep->hdr_bswap(ep, &ep->cur_tx.entry->hdr.base_hdr);
+	if (ep->cur_tx.entry->ctrl_flags & XNET_TX_PREPPED) {
+		/* Header was swapped when the entry was coalesced, but none
+		 * of its data was sent.
+		 */
+		ep->cur_tx.data_left = ofi_total_iov_len(ep->cur_tx.entry->iov,
+						ep->cur_tx.entry->iov_cnt);
+	} else {
+		ep->cur_tx.data_left = ep->cur_tx.entry->hdr.base_hdr.size;
+		xnet_prep_tx(ep, ep->cur_tx.entry);
+	}
+}
+
+static bool
+xnet_coalesce_queue(struct xnet_ep *ep, struct slist *queue,
+		    struct iovec *iov, size_t *cnt, size_t *total,
+		    size_t *entries, size_t limit)
+{
+	struct xnet_xfer_entry *tx_entry;
+	struct slist_entry *item;
+	size_t len;
+
+	for (item = queue->head; item; item = item->next) {
+		tx_entry = container_of(item, struct xnet_xfer_entry, entry);
+		len = ofi_total_iov_len(tx_entry->iov, tx_entry->iov_cnt);
+		assert((tx_entry->ctrl_flags & XNET_TX_PREPPED) ||
+		       len == tx_entry->hdr.base_hdr.size);
+
+		if (*cnt + tx_entry->iov_cnt > XNET_TX_COALESCE_IOV ||
+		    *total + len > limit ||
+		    (tx_entry->ctrl_flags & XNET_STRIPE_WAIT))
+			return false;
+
+		if (!(tx_entry->ctrl_flags & XNET_TX_PREPPED))
+			xnet_prep_tx(ep, tx_entry);
+		memcpy(&iov[*cnt], tx_entry->iov,
+		       tx_entry->iov_cnt * sizeof(*iov));
+		*cnt += tx_entry->iov_cnt;
+		*total += len;
+		(*entries)++;
+	}
+	return true;
+}
+
+/* Send the current transfer together with as many queued transfers as
+ * fit within the iov and byte limits using a single sendmsg call.  Queued
+ * entries are gathered in the order that xnet_complete_tx would select
+ * them, so sent data can be applied by walking that same order.  Entries
+ * that were gathered but not sent remain on their queues, with their
+ * headers already prepared for the wire.
+ */
+static int xnet_send_msgs(struct xnet_ep *ep)
+{
+	struct iovec iov[XNET_TX_COALESCE_IOV];
+	struct xnet_progress *progress;
+	struct xnet_xfer_entry *tx_entry;
+	size_t cnt, total, entries, limit, len;
+	int ret;
+
+	progress = xnet_ep2_progress(ep);
+	assert(xnet_progress_locked(progress));
+	tx_entry = ep->cur_tx.entry;
+	limit = MIN(xnet_tx_coalesce_size, ep->bsock.zerocopy_size);
+
+	if (xnet_io_uring || ep->cur_tx.data_left >= limit ||
+	    tx_entry->iov_cnt >= XNET_TX_COALESCE_IOV ||
+	    (slist_empty(&ep->priority_queue) && slist_empty(&ep->tx_queue)))
+		return xnet_send_msg(ep);
+
+	memcpy(iov, tx_entry->iov, tx_entry->iov_cnt * sizeof(*iov));
+	cnt = tx_entry->iov_cnt;
+	total = ep->cur_tx.data_left;
+	entries = 1;
+	if (xnet_coalesce_queue(ep, &ep->priority_queue, iov, &cnt, &total,
+				&entries, limit))
+		(void) xnet_coalesce_queue(ep, &ep->tx_queue, iov, &cnt,
+					   &total, &entries, limit);
+
+	if (entries == 1)
+		return xnet_send_msg(ep);
+
+	ret = ofi_bsock_sendv(&ep->bsock, iov, cnt, &len);
+	if (ret < 0)
+		return ret;
+
+	progress->tx_batches++;
+	progress->tx_batch_entries += entries;
+	progress->tx_batch_bytes += len;
+
+	while (len > ep->cur_tx.data_left) {
+		len -= ep->cur_tx.data_left;
+		ep->cur_tx.data_left = 0;
+		xnet_complete_tx(ep, 0);
+		assert(ep->cur_tx.entry);
+	}
+
+	ep->cur_tx.data_left -= len;
+	if (ep->cur_tx.data_left) {
+		ofi_consume_iov(ep->cur_tx.entry->iov,
+				&ep->cur_tx.entry->iov_cnt, len);
+		return -FI_EAGAIN;
+	}
+	return FI_SUCCESS;
 }
 
 static void xnet_progress_tx(struct xnet_ep *ep)
@@ -480,8 +627,9 @@ static void xnet_progress_tx(struct xnet_ep *ep)
 	int ret;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
-	while (ep->cur_tx.entry) {
-		ret = xnet_send_msg(ep);
+	while (ep->cur_tx.entry &&
+	       !(ep->cur_tx.entry->ctrl_flags & XNET_STRIPE_WAIT)) {
+		ret = xnet_send_msgs(ep);
 		if (OFI_SOCK_TRY_SND_RCV_AGAIN(-ret)) {
 			ret = xnet_update_pollflag(ep, POLLOUT, true);
 			if (!ret)
@@ -649,6 +797,117 @@ static int xnet_handle_ack(struct xnet_ep *ep)
 	return FI_SUCCESS;
 }
 
+static int xnet_queue_cts(struct xnet_ep *ep, struct xnet_xfer_entry *rx_entry)
+{
+	struct xnet_xfer_entry *resp;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	resp = xnet_alloc_xfer(xnet_ep2_progress(ep));
+	if (!resp)
+		return -FI_ENOMEM;
+
+	resp->iov[0].iov_base = (void *) &resp->hdr;
+	resp->iov[0].iov_len = sizeof(resp->hdr.cts_hdr);
+	resp->iov_cnt = 1;
+
+	resp->hdr.base_hdr.version = XNET_HDR_VERSION;
+	resp->hdr.base_hdr.op_data = XNET_OP_CTS;
+	resp->hdr.base_hdr.op = ofi_op_msg;
+	resp->hdr.base_hdr.size = sizeof(resp->hdr.cts_hdr);
+	resp->hdr.base_hdr.hdr_size = (uint8_t) sizeof(resp->hdr.cts_hdr);
+	resp->hdr.cts_hdr.id = xnet_hdr_rts(&rx_entry->hdr)->id;
+
+	resp->ctrl_flags = XNET_INTERNAL_XFER;
+	resp->context = NULL;
+
+	slist_insert_tail(&rx_entry->entry, &ep->rndv_rx_queue);
+	xnet_tx_queue_insert(ep, resp);
+	return FI_SUCCESS;
+}
+
+/* The receive for an RTS has been matched.  A saved request waits until
+ * the application posts a buffer, see xnet_recv_saved().
+ */
+static int xnet_start_rndv(struct xnet_ep *ep, struct xnet_xfer_entry *rx_entry)
+{
+	int ret;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	FI_DBG(&xnet_prov, FI_LOG_EP_DATA, "rendezvous request size %zu%s\n",
+	       (size_t) xnet_hdr_rts(&rx_entry->hdr)->size,
+	       (rx_entry->ctrl_flags & XNET_SAVED_XFER) ? " saved" : "");
+
+	if (!(rx_entry->ctrl_flags & XNET_SAVED_XFER)) {
+		ret = xnet_queue_cts(ep, rx_entry);
+		if (ret) {
+			xnet_cntr_incerr(rx_entry);
+			xnet_report_error(rx_entry, -ret);
+			xnet_free_xfer(xnet_ep2_progress(ep), rx_entry);
+			xnet_reset_rx(ep);
+			return ret;
+		}
+	}
+
+	xnet_reset_rx(ep);
+	return FI_SUCCESS;
+}
+
+static int xnet_handle_cts(struct xnet_ep *ep)
+{
+	struct xnet_xfer_entry *tx_entry;
+	struct slist_entry *item, *prev;
+	size_t len;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (ep->cur_rx.hdr.base_hdr.size != sizeof(ep->cur_rx.hdr.cts_hdr))
+		return -FI_EIO;
+
+	slist_foreach(&ep->rndv_tx_queue, item, prev) {
+		tx_entry = container_of(item, struct xnet_xfer_entry, entry);
+		if ((uintptr_t) tx_entry == ep->cur_rx.hdr.cts_hdr.id)
+			break;
+	}
+	if (!item) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+			"CTS for unknown rendezvous request\n");
+		return -FI_EIO;
+	}
+	slist_remove(&ep->rndv_tx_queue, item, prev);
+
+	/* Replace the tagged header with the payload header.  The tag and
+	 * CQ data were delivered with the RTS.
+	 */
+	len = tx_entry->hdr.base_hdr.size - tx_entry->hdr.base_hdr.hdr_size;
+	tx_entry->hdr.base_hdr.op = ofi_op_msg;
+	tx_entry->hdr.base_hdr.op_data = XNET_OP_DATA;
+	tx_entry->hdr.base_hdr.flags = 0;
+	tx_entry->hdr.base_hdr.hdr_size = (uint8_t) sizeof(tx_entry->hdr.base_hdr);
+	tx_entry->hdr.base_hdr.size = sizeof(tx_entry->hdr.base_hdr) + len;
+	tx_entry->iov[0].iov_len = sizeof(tx_entry->hdr.base_hdr);
+
+	xnet_tx_queue_insert(ep, tx_entry);
+	xnet_reset_rx(ep);
+	return FI_SUCCESS;
+}
+
+static int xnet_op_rndv_data(struct xnet_ep *ep)
+{
+	struct xnet_xfer_entry *rx_entry;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (slist_empty(&ep->rndv_rx_queue)) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+			"Unexpected rendezvous data\n");
+		return -FI_EIO;
+	}
+
+	rx_entry = container_of(slist_remove_head(&ep->rndv_rx_queue),
+				struct xnet_xfer_entry, entry);
+	ep->cur_rx.entry = rx_entry;
+	ep->cur_rx.handler = xnet_recv_msg_data;
+	return xnet_recv_msg_data(ep);
+}
+
 int xnet_start_recv(struct xnet_ep *ep, struct xnet_xfer_entry *rx_entry)
 {
 	struct xnet_active_rx *msg = &ep->cur_rx;
@@ -680,6 +939,9 @@ int xnet_start_recv(struct xnet_ep *ep, struct xnet_xfer_entry *rx_entry)
 
 	(void) ofi_truncate_iov(rx_entry->iov, &rx_entry->iov_cnt, msg_len);
 
+	if (msg->hdr.base_hdr.flags & XNET_RNDV)
+		return xnet_start_rndv(ep, rx_entry);
+
 	ep->cur_rx.entry = rx_entry;
 	ep->cur_rx.handler = xnet_recv_msg_data;
 	return xnet_recv_msg_data(ep);
@@ -698,8 +960,16 @@ static int xnet_op_msg(struct xnet_ep *ep)
 	int ret;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
-	if (msg->hdr.base_hdr.op_data == XNET_OP_ACK)
+	switch (msg->hdr.base_hdr.op_data) {
+	case XNET_OP_ACK:
 		return xnet_handle_ack(ep);
+	case XNET_OP_CTS:
+		return xnet_handle_cts(ep);
+	case XNET_OP_DATA:
+		return xnet_op_rndv_data(ep);
+	default:
+		break;
+	}
 
 	rx_entry = xnet_get_rx_entry(ep);
 	if (!rx_entry) {
@@ -716,6 +986,33 @@ static int xnet_op_msg(struct xnet_ep *ep)
 	return xnet_start_recv(ep, rx_entry);
 }
 
+/* A small unexpected message whose payload already sits in the prefetch
+ * buffer, with nothing queued behind it, is left there until a matching
+ * receive is posted.  The data is then copied once, straight into the
+ * user's buffer, instead of through a saved buffer.  POLLIN stays armed;
+ * if more data arrives from the peer, the message is saved as usual so
+ * that it does not block the stream.
+ */
+static bool xnet_peek_unexp(struct xnet_ep *ep)
+{
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (ep->cur_rx.peeked)
+		return true;
+
+	if (!dlist_empty(&ep->unexp_entry) || xnet_io_uring ||
+	    (ep->cur_rx.hdr.base_hdr.flags & XNET_RNDV) ||
+	    (ep->cur_rx.data_left > xnet_unexp_peek_size) ||
+	    (ofi_byteq_readable(&ep->bsock.rq) != ep->cur_rx.data_left))
+		return false;
+
+	FI_DBG(&xnet_prov, FI_LOG_EP_DATA, "Peeked msg size %zu\n",
+	       ep->cur_rx.data_left);
+	ep->cur_rx.peeked = true;
+	dlist_insert_tail(&ep->unexp_entry,
+			  &xnet_ep2_progress(ep)->unexp_tag_list);
+	return true;
+}
+
 static int xnet_op_tagged(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *rx_entry;
@@ -731,18 +1028,21 @@ static int xnet_op_tagged(struct xnet_ep *ep)
 
 	rx_entry = ep->srx->match_tag_rx(ep->srx, ep, tag);
 	if (!rx_entry) {
+		if (xnet_peek_unexp(ep))
+			return -FI_EAGAIN;
+
 		if (xnet_save_and_cont(ep)) {
 			rx_entry = xnet_get_save_rx(ep, tag);
 			if (rx_entry)
 				goto start;
 		}
-		if (dlist_empty(&ep->unexp_entry)) {
+		if (dlist_empty(&ep->unexp_entry))
 			dlist_insert_tail(&ep->unexp_entry,
 					  &xnet_ep2_progress(ep)->unexp_tag_list);
-			ret = xnet_update_pollflag(ep, POLLIN, false);
-			if (ret)
-				return ret;
-		}
+		/* A peeked message leaves POLLIN enabled */
+		ret = xnet_update_pollflag(ep, POLLIN, false);
+		if (ret)
+			return ret;
 		return -FI_EAGAIN;
 	}
 
@@ -903,6 +1203,23 @@ static int xnet_progress_hdr(struct xnet_ep *ep)
 
 	ep->cur_rx.data_left = ep->cur_rx.hdr.base_hdr.size -
 			       ep->cur_rx.hdr.base_hdr.hdr_size;
+
+	/* Record the size of the message announced by an RTS, so that
+	 * matching and completions see the real message length.
+	 */
+	if (ep->cur_rx.hdr.base_hdr.flags & XNET_RNDV) {
+		if ((ep->cur_rx.hdr.base_hdr.op != ofi_op_tagged) ||
+		    ep->cur_rx.data_left ||
+		    (ep->cur_rx.hdr.base_hdr.hdr_size <
+		     sizeof(ep->cur_rx.hdr.tag_hdr) + sizeof(struct xnet_rts))) {
+			FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+				"Received invalid rendezvous request\n");
+			return -FI_EIO;
+		}
+		ep->cur_rx.hdr.base_hdr.size +=
+			xnet_hdr_rts(&ep->cur_rx.hdr)->size;
+	}
+
 	ep->cur_rx.handler = xnet_start_op[ep->cur_rx.hdr.base_hdr.op];
 	return FI_SUCCESS;
 }
@@ -1002,6 +1319,11 @@ void xnet_progress_rx(struct xnet_ep *ep)
 
 	} while (!ret && ofi_bsock_readable(&ep->bsock));
 
+	/* Wake the progress thread to re-arm endpoints waiting on buffers */
+	if (ep->bsock.bufring &&
+	    !dlist_empty(&xnet_ep2_progress(ep)->rx_buf_list))
+		xnet_signal_progress(xnet_ep2_progress(ep));
+
 	if (xnet_io_uring) {
 		if (ret == -OFI_EINPROGRESS_URING)
 			ret = xnet_update_pollflag(ep, POLLIN, false);
@@ -1013,13 +1335,10 @@ void xnet_progress_rx(struct xnet_ep *ep)
 	}
 }
 
-void xnet_progress_async(struct xnet_ep *ep)
+static void xnet_complete_async(struct xnet_ep *ep, uint32_t done)
 {
 	struct xnet_xfer_entry *xfer;
-	uint32_t done;
 
-	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
-	done = ofi_bsock_async_done(&xnet_prov, &ep->bsock);
 	while (!slist_empty(&ep->async_queue)) {
 		xfer = container_of(ep->async_queue.head,
 				    struct xnet_xfer_entry, entry);
@@ -1032,6 +1351,24 @@ void xnet_progress_async(struct xnet_ep *ep)
 	}
 }
 
+void xnet_progress_async(struct xnet_ep *ep)
+{
+	uint32_t done;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	done = ofi_bsock_async_done(&xnet_prov, &ep->bsock);
+	xnet_complete_async(ep, done);
+}
+
+/* Notifications for zero copy sends on a socket are generated in order */
+static void xnet_uring_zc_done(struct xnet_ep *ep)
+{
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	assert(ofi_val32_gt(ep->bsock.async_index, ep->bsock.done_index));
+	ep->bsock.done_index++;
+	xnet_complete_async(ep, ep->bsock.done_index);
+}
+
 static void xnet_uring_tx_done(struct xnet_ep *ep, int res)
 {
 	struct xnet_xfer_entry *tx_entry;
@@ -1095,6 +1432,85 @@ disable_ep:
 	xnet_ep_disable(ep, 0, NULL, 0);
 }
 
+static int xnet_uring_arm_rx_buf(struct xnet_ep *ep)
+{
+	struct xnet_progress *progress;
+	int ret;
+
+	progress = xnet_ep2_progress(ep);
+	assert(xnet_progress_locked(progress));
+	if (ep->bsock.rx_sockctx.uring_sqe_inuse)
+		return 0;
+
+	if (progress->rx_bufring.avail) {
+		ret = ofi_sockctx_uring_recv_multishot(progress->rx_uring.sockapi,
+						       ep->bsock.sock,
+						       &progress->rx_bufring,
+						       &ep->bsock.rx_sockctx);
+		if (ret == -OFI_EINPROGRESS_URING) {
+			dlist_remove_init(&ep->rx_buf_entry);
+			return 0;
+		}
+		if (ret != -FI_EAGAIN)
+			return ret;
+	}
+
+	if (dlist_empty(&ep->rx_buf_entry))
+		dlist_insert_tail(&ep->rx_buf_entry, &progress->rx_buf_list);
+	return 0;
+}
+
+static void xnet_uring_resume_rx_buf(struct xnet_progress *progress)
+{
+	struct xnet_ep *ep;
+
+	assert(xnet_progress_locked(progress));
+	while (progress->rx_bufring.avail &&
+	       !dlist_empty(&progress->rx_buf_list)) {
+		ep = container_of(progress->rx_buf_list.next,
+				  struct xnet_ep, rx_buf_entry);
+		if (xnet_uring_arm_rx_buf(ep)) {
+			dlist_remove_init(&ep->rx_buf_entry);
+			xnet_ep_disable(ep, 0, NULL, 0);
+		} else if (!dlist_empty(&ep->rx_buf_entry)) {
+			break;
+		}
+	}
+}
+
+/* Connected endpoints are woken by a multishot receive when the progress
+ * instance has a provided buffer ring, otherwise by a POLLIN request.
+ */
+int xnet_uring_monitor_ep(struct xnet_ep *ep)
+{
+	struct xnet_progress *progress;
+
+	progress = xnet_ep2_progress(ep);
+	assert(xnet_progress_locked(progress));
+	if (!progress->rx_bufring.cnt)
+		return xnet_uring_pollin_add(progress, ep->bsock.sock, false,
+					     &ep->bsock.pollin_sockctx);
+
+	assert(!ofi_bsock_readable(&ep->bsock));
+	ep->bsock.bufring = &progress->rx_bufring;
+	return xnet_uring_arm_rx_buf(ep);
+}
+
+static void xnet_uring_rx_buf_done(struct xnet_ep *ep, int res, uint32_t flags)
+{
+	ofi_bsock_recv_buf_done(&ep->bsock, res, flags);
+	if (ep->state != XNET_CONNECTED) {
+		ofi_bsock_discard_bufs(&ep->bsock);
+		return;
+	}
+
+	xnet_progress_rx(ep);
+	if (ep->state == XNET_CONNECTED &&
+	    ep->bsock.rx_buf_status == -FI_EAGAIN &&
+	    xnet_uring_arm_rx_buf(ep))
+		xnet_ep_disable(ep, 0, NULL, 0);
+}
+
 static void xnet_uring_connect_done(struct xnet_ep *ep, int res)
 {
 	struct xnet_progress *progress;
@@ -1180,20 +1596,52 @@ static void xnet_progress_cqe(struct xnet_progress *progress,
 	struct xnet_ep *ep;
 	struct xnet_conn_handle *conn;
 	struct xnet_pep *pep;
+	bool zc_done = false;
 
 	assert(xnet_io_uring);
 	sockctx = (struct ofi_sockctx *) cqe->user_data;
 	assert(sockctx);
+	fid = sockctx->context;
+
+	/* The zero copy send completed earlier, and the sockctx may
+	 * have been reused since.
+	 */
+	if (cqe->flags & IORING_CQE_F_NOTIF) {
+		uring->sockapi->credits++;
+		assert(fid->fclass == FI_CLASS_EP);
+		ep = container_of(fid, struct xnet_ep, util_ep.ep_fid.fid);
+		xnet_uring_zc_done(ep);
+		return;
+	}
+
 	assert(sockctx->uring_sqe_inuse);
-	if (!(cqe ->flags & IORING_CQE_F_MORE))
+	if (sockctx->uring_sqe_zc) {
+		/* The send buffers are released by a later notification,
+		 * which is only generated if the MORE flag is set.
+		 */
+		sockctx->uring_sqe_zc = false;
+		sockctx->uring_sqe_inuse = false;
+		if (!(cqe->flags & IORING_CQE_F_MORE)) {
+			uring->sockapi->credits++;
+			zc_done = true;
+		}
+	} else if (!(cqe->flags & IORING_CQE_F_MORE)) {
+		/* A multishot request holds its credit until the final
+		 * completion
+		 */
 		sockctx->uring_sqe_inuse = false;
-	uring->sockapi->credits++;
+		uring->sockapi->credits++;
+	}
 
-	fid = sockctx->context;
 	switch (fid->fclass) {
 	case FI_CLASS_EP:
 		ep = container_of(fid, struct xnet_ep, util_ep.ep_fid.fid);
-		xnet_uring_run_ep(ep, sockctx, cqe->res);
+		if (ep->bsock.bufring && sockctx == &ep->bsock.rx_sockctx)
+			xnet_uring_rx_buf_done(ep, cqe->res, cqe->flags);
+		else
+			xnet_uring_run_ep(ep, sockctx, cqe->res);
+		if (zc_done)
+			xnet_uring_zc_done(ep);
 		break;
 	case FI_CLASS_CONNREQ:
 		conn = container_of(fid, struct xnet_conn_handle, fid);
@@ -1267,6 +1715,55 @@ int xnet_uring_cancel(struct xnet_progress *progress,
 	return 0;
 }
 
+/* Zero copy notifications reference the endpoint, so must be reaped
+ * before it can be freed.
+ */
+void xnet_uring_drain_zc(struct xnet_ep *ep)
+{
+	struct xnet_progress *progress;
+
+	progress = xnet_ep2_progress(ep);
+	assert(xnet_progress_locked(progress));
+	while (xnet_io_uring &&
+	       ofi_val32_gt(ep->bsock.async_index, ep->bsock.done_index))
+		xnet_progress_uring(progress, &progress->tx_uring);
+}
+
+/* Called when a piece of a striped write sent over a secondary stream
+ * completes or is flushed.  Once all such pieces are done, release the
+ * final piece queued on the primary stream.  If the final piece was
+ * flushed first, it has already been reported and detached.
+ */
+void xnet_stripe_done(struct xnet_xfer_entry *xfer_entry, int err)
+{
+	struct xnet_stripe *stripe = xfer_entry->stripe;
+	struct xnet_xfer_entry *parent;
+	struct xnet_ep *ep;
+
+	assert(xfer_entry->ctrl_flags & XNET_STRIPE_XFER);
+	if (err && !stripe->err)
+		stripe->err = err;
+	if (--stripe->pending)
+		return;
+
+	parent = stripe->parent;
+	ep = stripe->ep;
+	if (parent) {
+		assert(parent->ctrl_flags & XNET_STRIPE_WAIT);
+		parent->ctrl_flags &= ~XNET_STRIPE_WAIT;
+		if (stripe->err)
+			parent->ctrl_flags |= XNET_STRIPE_ERR;
+		parent->stripe = NULL;
+	}
+	free(stripe);
+
+	if (parent && parent == ep->cur_tx.entry) {
+		xnet_progress_tx(ep);
+		if (xnet_io_uring)
+			xnet_submit_uring(&xnet_ep2_progress(ep)->tx_uring);
+	}
+}
+
 void xnet_tx_queue_insert(struct xnet_ep *ep,
 			  struct xnet_xfer_entry *tx_entry)
 {
@@ -1278,8 +1775,7 @@ void xnet_tx_queue_insert(struct xnet_ep *ep,
 	if (!ep->cur_tx.entry) {
 		ep->cur_tx.entry = tx_entry;
 		ep->cur_tx.data_left = tx_entry->hdr.base_hdr.size;
-		OFI_DBG_SET(tx_entry->hdr.base_hdr.id, ep->tx_id++);
-		ep->hdr_bswap(ep, &tx_entry->hdr.base_hdr);
+		xnet_prep_tx(ep, tx_entry);
 		xnet_progress_tx(ep);
 		if (xnet_io_uring)
 			xnet_submit_uring(&progress->tx_uring);
@@ -1305,8 +1801,11 @@ static void xnet_run_ep(struct xnet_ep *ep, bool pin, bool pout, bool perr)
 	case XNET_CONNECTED:
 		if (perr)
 			xnet_progress_async(ep);
-		if (pin)
+		if (pin) {
+			/* New data is waiting behind a peeked message */
+			ep->cur_rx.peeked = false;
 			xnet_progress_rx(ep);
+		}
 		if (pout)
 			xnet_progress_tx(ep);
 		break;
@@ -1400,9 +1899,13 @@ void xnet_run_progress(struct xnet_progress *progress, bool clear_signal)
 
 	assert(ofi_genlock_held(progress->active_lock));
 	if (xnet_io_uring) {
+		if (clear_signal)
+			fd_signal_reset(&progress->signal);
 		xnet_progress_uring(progress, &progress->tx_uring);
 		xnet_progress_uring(progress, &progress->rx_uring);
 		xnet_handle_event_list(progress);
+		if (!dlist_empty(&progress->rx_buf_list))
+			xnet_uring_resume_rx_buf(progress);
 		xnet_submit_uring(&progress->tx_uring);
 		xnet_submit_uring(&progress->rx_uring);
 	} else {
@@ -1475,10 +1978,12 @@ int xnet_trywait(struct fid_fabric *fabric_fid, struct fid **fid, int count)
 			cq = container_of(fid[i], struct xnet_cq,
 					  util_cq.cq_fid.fid);
 			ofi_genlock_lock(xnet_cq2_progress(cq)->active_lock);
-			if (ofi_cirque_isempty(cq->util_cq.cirq))
+			ofi_genlock_lock(&cq->util_cq.cq_lock);
+			if (ofi_cq_isempty(&cq->util_cq))
 				xnet_reset_wait(cq->util_cq.wait);
 			else
 				ret = -FI_EAGAIN;
+			ofi_genlock_unlock(&cq->util_cq.cq_lock);
 			ofi_genlock_unlock(xnet_cq2_progress(cq)->active_lock);
 			break;
 		case FI_CLASS_EQ:
@@ -1538,17 +2043,81 @@ int xnet_progress_wait(struct xnet_progress *progress, int timeout)
 	return ofi_dynpoll_wait(&progress->epoll_fd, &event, 1, timeout);
 }
 
+static bool xnet_progress_ready(struct xnet_progress *progress)
+{
+	if (xnet_io_uring &&
+	    (ofi_uring_cq_ready(&progress->tx_uring.ring) ||
+	     ofi_uring_cq_ready(&progress->rx_uring.ring)))
+		return true;
+
+	return xnet_progress_wait(progress, 0) != 0;
+}
+
+/* Poll for events before blocking.  The spin window adapts to traffic:
+ * it is reset to the maximum when an event arrives while spinning, halved
+ * when it expires without events, and grown again when the thread is
+ * woken after blocking.  A negative spin setting never blocks.
+ */
+static bool xnet_progress_spin_wait(struct xnet_progress *progress)
+{
+	uint64_t end;
+
+	if (xnet_progress_spin < 0) {
+		while (!xnet_progress_ready(progress))
+			;
+		return true;
+	}
+
+	if (!progress->spin_usec)
+		return false;
+
+	end = ofi_gettime_us() + progress->spin_usec;
+	do {
+		if (xnet_progress_ready(progress)) {
+			progress->spin_usec = xnet_progress_spin;
+			return true;
+		}
+	} while (ofi_gettime_us() < end);
+
+	progress->spin_usec >>= 1;
+	return false;
+}
+
+static void xnet_progress_set_affinity(void)
+{
+	int ret;
+
+	if (!xnet_progress_affinity)
+		return;
+
+	ret = ofi_set_thread_affinity(xnet_progress_affinity);
+	if (ret) {
+		FI_WARN(&xnet_prov, FI_LOG_DOMAIN,
+			"unable to bind progress thread to cpus %s (%d)\n",
+			xnet_progress_affinity, ret);
+	}
+}
+
 static void *xnet_auto_progress(void *arg)
 {
 	struct xnet_progress *progress = arg;
 	int nfds;
 
 	FI_INFO(&xnet_prov, FI_LOG_DOMAIN, "progress thread starting\n");
+	xnet_progress_set_affinity();
+	progress->spin_usec = xnet_progress_spin;
 	ofi_genlock_lock(progress->active_lock);
 	while (progress->auto_progress) {
 		ofi_genlock_unlock(progress->active_lock);
 
-		nfds = xnet_progress_wait(progress, -1);
+		if (xnet_progress_spin_wait(progress)) {
+			nfds = 1;
+		} else {
+			nfds = xnet_progress_wait(progress, -1);
+			if (nfds > 0 && xnet_progress_spin > 0)
+				progress->spin_usec = MIN(xnet_progress_spin,
+						MAX(progress->spin_usec << 1, 1));
+		}
 		ofi_genlock_lock(progress->active_lock);
 		if (nfds >= 0)
 			xnet_run_progress(progress, true);
@@ -1700,6 +2269,13 @@ static void xnet_destroy_uring(struct xnet_uring *uring,
 
 int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 {
+	struct ofi_bufpool_attr attr = {
+		.size		= sizeof(struct xnet_xfer_entry) + xnet_buf_size,
+		.alignment	= 16,
+		.chunk_cnt	= 1024,
+		/* app threads post while the progress thread completes */
+		.flags		= OFI_BUFPOOL_THREAD_CACHE,
+	};
 	int ret;
 
 	progress->fid.fclass = XNET_CLASS_PROGRESS;
@@ -1707,6 +2283,8 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 	dlist_init(&progress->unexp_msg_list);
 	dlist_init(&progress->unexp_tag_list);
 	dlist_init(&progress->saved_tag_list);
+	dlist_init(&progress->rx_buf_list);
+	memset(&progress->rx_bufring, 0, sizeof(progress->rx_bufring));
 	slist_init(&progress->event_list);
 
 	ret = fd_signal_init(&progress->signal);
@@ -1723,9 +2301,7 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 	if (ret)
 		goto err2;
 
-	ret = ofi_bufpool_create(&progress->xfer_pool,
-			sizeof(struct xnet_xfer_entry) + xnet_buf_size,
-			16, 0, 1024, 0);
+	ret = ofi_bufpool_create_attr(&attr, &progress->xfer_pool);
 	if (ret)
 		goto err3;
 
@@ -1749,6 +2325,9 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 		if (ret)
 			goto err6;
 
+		progress->tx_uring.send_zc =
+			ofi_uring_send_zc_supported(&progress->tx_uring.ring);
+
 		ret = xnet_init_uring(&progress->rx_uring,
 				      info ? info->rx_attr->size :
 					     xnet_default_rx_size,
@@ -1756,6 +2335,19 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 				      &progress->epoll_fd);
 		if (ret)
 			goto err7;
+
+		if (xnet_io_uring_rx_bufs) {
+			ret = ofi_uring_bufring_init(&progress->rx_uring.ring,
+						     &progress->rx_bufring,
+						     xnet_io_uring_rx_bufs,
+						     xnet_prefetch_rbuf_size, 0);
+			if (ret) {
+				FI_WARN(&xnet_prov, FI_LOG_DOMAIN,
+					"io_uring provided buffers unavailable "
+					"(%d), using single shot receives\n", ret);
+				progress->rx_bufring.cnt = 0;
+			}
+		}
 	} else {
 		progress->sockapi = xnet_sockapi_socket;
 	}
@@ -1786,8 +2378,17 @@ void xnet_close_progress(struct xnet_progress *progress)
 	assert(dlist_empty(&progress->saved_tag_list));
 	assert(slist_empty(&progress->event_list));
 	xnet_stop_progress(progress);
+	if (progress->tx_batches) {
+		FI_INFO(&xnet_prov, FI_LOG_EP_DATA, "tx coalescing: %" PRIu64
+			" sends, %" PRIu64 " transfers, %" PRIu64 " bytes\n",
+			progress->tx_batches, progress->tx_batch_entries,
+			progress->tx_batch_bytes);
+	}
 	if (xnet_io_uring) {
 		free(progress->cqes);
+		if (progress->rx_bufring.cnt)
+			ofi_uring_bufring_destroy(&progress->rx_uring.ring,
+						  &progress->rx_bufring);
 		xnet_destroy_uring(&progress->rx_uring, &progress->epoll_fd);
 		xnet_destroy_uring(&progress->tx_uring, &progress->epoll_fd);
 	}
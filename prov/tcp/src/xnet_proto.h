@@ -59,6 +59,9 @@ struct xnet_cm_msg {
 	char data[XNET_MAX_CM_DATA_SIZE];
 };
 
+/* ofi_ctrl_hdr::seg_no carries optional features, in network byte order */
+#define XNET_CM_RNDV		(1 << 0)
+
 #define XNET_HDR_VERSION	3
 
 enum {
@@ -69,6 +72,8 @@ enum {
 enum {
 	/* backward compatible value */
 	XNET_OP_ACK = 2, /* indicates ack message - should be a flag */
+	XNET_OP_CTS = 3, /* rendezvous clear to send */
+	XNET_OP_DATA = 4, /* rendezvous payload */
 };
 
 /* Flags */
@@ -76,6 +81,7 @@ enum {
 /* not used XNET_TRANSMIT_COMPLETE	(1 << 1) */
 #define XNET_DELIVERY_COMPLETE	(1 << 2)
 #define XNET_COMMIT_COMPLETE	(1 << 3)
+#define XNET_RNDV		(1 << 4)
 #define XNET_TAGGED		(1 << 7)
 
 struct xnet_base_hdr {
@@ -107,6 +113,23 @@ struct xnet_tag_data_hdr {
 	uint64_t		tag;
 };
 
+/* A tagged message sent using the rendezvous protocol is announced by an
+ * RTS: the tagged header with XNET_RNDV set, followed by struct xnet_rts,
+ * and no payload.  Once the receive has been matched, the receiver returns
+ * a CTS carrying the id from the RTS.  The sender then transfers the
+ * payload as an XNET_OP_DATA message.  Payloads are sent in the order that
+ * CTS messages are received, so the receiver matches them in order.
+ */
+struct xnet_rts {
+	uint64_t		size;
+	uint64_t		id;
+};
+
+struct xnet_cts_hdr {
+	struct xnet_base_hdr	base_hdr;
+	uint64_t		id;
+};
+
 /* Maximum header is scatter RMA with CQ data */
 #define XNET_MAX_HDR (sizeof(struct xnet_cq_data_hdr) + \
 		     sizeof(struct ofi_rma_iov) * XNET_IOV_LIMIT)
@@ -34,6 +34,7 @@
 #include <errno.h>
 
 #include <ofi_prov.h>
+#include <ofi_iov.h>
 #include "xnet.h"
 
 
@@ -437,6 +438,32 @@ unlock:
 	return ret;
 }
 
+/* Large writes are striped across additional streams to the peer, if
+ * enabled.  Writes carrying remote CQ data are not striped, as the peer
+ * would report only the length of the final piece.
+ */
+static ssize_t
+xnet_rdm_post_write(struct xnet_conn *conn, const struct fi_msg_rma *msg,
+		    uint64_t flags)
+{
+	struct xnet_ep *streams[XNET_MAX_STREAMS - 1];
+	size_t len;
+	int cnt;
+
+	if (xnet_rdm_streams > 1 &&
+	    !(flags & (FI_INJECT | FI_REMOTE_CQ_DATA))) {
+		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+		if (len >= MAX(xnet_rdm_stripe_size, XNET_MAX_STREAMS)) {
+			cnt = xnet_get_streams(conn, streams);
+			if (cnt)
+				return xnet_rma_stripe_write(conn->ep, streams,
+							     cnt, msg, flags);
+		}
+	}
+
+	return fi_writemsg(&conn->ep->util_ep.ep_fid, msg, flags);
+}
+
 static ssize_t
 xnet_rdm_write(struct fid_ep *ep_fid, const void *buf,
 	       size_t len, void *desc, fi_addr_t dest_addr,
@@ -444,6 +471,25 @@ xnet_rdm_write(struct fid_ep *ep_fid, const void *buf,
 {
 	struct xnet_rdm *rdm;
 	struct xnet_conn *conn;
+	struct iovec msg_iov = {
+		.iov_base = (void *) buf,
+		.iov_len = len,
+	};
+	struct fi_rma_iov rma_iov = {
+		.addr = addr,
+		.key = key,
+		.len = len,
+	};
+	struct fi_msg_rma msg = {
+		.msg_iov = &msg_iov,
+		.desc = &desc,
+		.iov_count = 1,
+		.rma_iov_count = 1,
+		.rma_iov = &rma_iov,
+		.addr = dest_addr,
+		.context = context,
+		.data = 0,
+	};
 	ssize_t ret;
 
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
@@ -452,8 +498,7 @@ xnet_rdm_write(struct fid_ep *ep_fid, const void *buf,
 	if (ret)
 		goto unlock;
 
-	ret = fi_write(&conn->ep->util_ep.ep_fid, buf, len, desc, dest_addr,
-		       addr, key, context);
+	ret = xnet_rdm_post_write(conn, &msg, 0);
 unlock:
 	ofi_genlock_unlock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	return ret;
@@ -466,6 +511,21 @@ xnet_rdm_writev(struct fid_ep *ep_fid, const struct iovec *iov,
 {
 	struct xnet_rdm *rdm;
 	struct xnet_conn *conn;
+	struct fi_rma_iov rma_iov = {
+		.addr = addr,
+		.key = key,
+		.len = ofi_total_iov_len(iov, count),
+	};
+	struct fi_msg_rma msg = {
+		.msg_iov = iov,
+		.desc = desc,
+		.iov_count = count,
+		.rma_iov_count = 1,
+		.rma_iov = &rma_iov,
+		.addr = dest_addr,
+		.context = context,
+		.data = 0,
+	};
 	ssize_t ret;
 
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
@@ -474,8 +534,7 @@ xnet_rdm_writev(struct fid_ep *ep_fid, const struct iovec *iov,
 	if (ret)
 		goto unlock;
 
-	ret = fi_writev(&conn->ep->util_ep.ep_fid, iov, desc, count, dest_addr,
-			addr, key, context);
+	ret = xnet_rdm_post_write(conn, &msg, 0);
 unlock:
 	ofi_genlock_unlock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	return ret;
@@ -495,7 +554,7 @@ xnet_rdm_writemsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
 	if (ret)
 		goto unlock;
 
-	ret = fi_writemsg(&conn->ep->util_ep.ep_fid, msg, flags);
+	ret = xnet_rdm_post_write(conn, msg, flags);
 unlock:
 	ofi_genlock_unlock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	return ret;
@@ -748,6 +807,20 @@ unlock:
 	return ret;
 }
 
+static int xnet_rdm_connect_ctrl(struct xnet_rdm *rdm,
+				 struct fi_tcp_connect *connect)
+{
+	int ret;
+
+	if (rdm->pep->state != XNET_LISTENING)
+		return -FI_EOPBADSTATE;
+
+	ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
+	ret = xnet_connect_addrs(rdm, connect->addr, connect->count);
+	ofi_genlock_unlock(&xnet_rdm2_progress(rdm)->rdm_lock);
+	return ret;
+}
+
 static int xnet_rdm_ctrl(struct fid *fid, int command, void *arg)
 {
 	struct xnet_rdm *rdm;
@@ -762,6 +835,13 @@ static int xnet_rdm_ctrl(struct fid *fid, int command, void *arg)
 			return -FI_ENOCQ;
 
 		return xnet_enable_rdm(rdm);
+	case FI_TCP_CONNECT:
+		return xnet_rdm_connect_ctrl(rdm, arg);
+	case FI_TCP_CONN_STATS:
+		ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
+		memcpy(arg, &rdm->conn_stats, sizeof(rdm->conn_stats));
+		ofi_genlock_unlock(&xnet_rdm2_progress(rdm)->rdm_lock);
+		break;
 	default:
 		return -FI_ENOSYS;
 	}
@@ -873,6 +953,8 @@ int xnet_rdm_ep(struct fid_domain *domain, struct fi_info *info,
 	if (!rdm)
 		return -FI_ENOMEM;
 
+	dlist_init(&rdm->stream_list);
+
 	ret = ofi_endpoint_init(domain, &xnet_util_prov, info, &rdm->util_ep,
 				context, NULL);
 	if (ret)
@@ -62,14 +62,25 @@ static int xnet_match_event(struct slist_entry *item, const void *arg)
 	return event->cm_entry.fid == &ep->util_ep.ep_fid.fid;
 }
 
+static void xnet_free_conn(struct xnet_conn *conn);
+
 static void xnet_close_conn(struct xnet_conn *conn)
 {
 	struct xnet_event *event;
 	struct slist_entry *item;
+	int i;
 
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "closing conn %p\n", conn);
 	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
 
+	/* Streams carry pieces of writes that complete on this conn */
+	for (i = 0; i < XNET_MAX_STREAMS - 1; i++) {
+		if (conn->streams[i]) {
+			xnet_close_conn(conn->streams[i]);
+			xnet_free_conn(conn->streams[i]);
+		}
+	}
+
 	if (conn->flags & XNET_CONN_RX_LOOPBACK) {
 		if (conn == conn->rdm->rx_loopback)
 			conn->rdm->rx_loopback = NULL;
@@ -79,6 +90,11 @@ static void xnet_close_conn(struct xnet_conn *conn)
 	if (!conn->ep)
 		return;
 
+	if (conn->connect_start) {
+		conn->rdm->conn_stats.failed++;
+		conn->connect_start = 0;
+	}
+
 	do {
 		item = slist_remove_first_match(
 			&xnet_rdm2_progress(conn->rdm)->event_list,
@@ -222,7 +238,7 @@ static int xnet_rdm_connect(struct xnet_conn *conn)
 
 	msg.version = XNET_RDM_VERSION;
 	msg.pid = htonl((uint32_t) getpid());
-	msg.resv = 0;
+	msg.resv = conn->stream_idx;
 	msg.port = htons(ofi_addr_get_port(&conn->rdm->addr.sa));
 
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "rdm addr", &conn->rdm->addr);
@@ -234,6 +250,9 @@ static int xnet_rdm_connect(struct xnet_conn *conn)
 		XNET_WARN_ERR(FI_LOG_EP_CTRL, "fi_connect", ret);
 		goto err;
 	}
+
+	conn->connect_start = ofi_gettime_us();
+	conn->rdm->conn_stats.started++;
 	return 0;
 
 err:
@@ -251,6 +270,13 @@ static void xnet_free_conn(struct xnet_conn *conn)
 	if (conn->flags & XNET_CONN_INDEXED)
 		ofi_idm_clear(&conn->rdm->conn_idx_map, conn->peer->index);
 
+	if (conn->flags & XNET_CONN_STREAM) {
+		if (conn->parent)
+			conn->parent->streams[conn->stream_idx - 1] = NULL;
+		else
+			dlist_remove(&conn->stream_entry);
+	}
+
 	util_put_peer(conn->peer);
 	av = container_of(conn->rdm->util_ep.av, struct rxm_av, util_av);
 	rxm_av_free_conn(av, conn);
@@ -287,6 +313,14 @@ void xnet_freeall_conns(struct xnet_rdm *rdm)
 		xnet_free_conn(conn);
 		assert(!rdm->rx_loopback);
 	}
+
+	while (!dlist_empty(&rdm->stream_list)) {
+		dlist_pop_front(&rdm->stream_list, struct xnet_conn,
+				conn, stream_entry);
+		dlist_init(&conn->stream_entry);
+		xnet_close_conn(conn);
+		xnet_free_conn(conn);
+	}
 }
 
 static struct xnet_conn *
@@ -306,6 +340,12 @@ xnet_alloc_conn(struct xnet_rdm *rdm, struct util_peer_addr *peer)
 	conn->rdm = rdm;
 	conn->flags = 0;
 	conn->peer = peer;
+	conn->remote_pid = 0;
+	conn->connect_start = 0;
+	conn->parent = NULL;
+	memset(conn->streams, 0, sizeof(conn->streams));
+	dlist_init(&conn->stream_entry);
+	conn->stream_idx = 0;
 	rxm_ref_peer(peer);
 
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "allocated conn %p\n", conn);
@@ -369,6 +409,106 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t addr,
 	return 0;
 }
 
+static int xnet_connect_stream(struct xnet_conn *conn, int idx)
+{
+	struct xnet_conn *stream;
+	int ret;
+
+	stream = xnet_alloc_conn(conn->rdm, conn->peer);
+	if (!stream)
+		return -FI_ENOMEM;
+
+	stream->flags |= XNET_CONN_STREAM;
+	stream->parent = conn;
+	stream->stream_idx = (uint8_t) idx;
+	conn->streams[idx - 1] = stream;
+
+	ret = xnet_rdm_connect(stream);
+	if (ret)
+		xnet_free_conn(stream);
+	return ret;
+}
+
+/* Return the connected streams to the peer, other than conn->ep.
+ * Missing streams are connected in the background.
+ */
+int xnet_get_streams(struct xnet_conn *conn, struct xnet_ep **eps)
+{
+	struct xnet_conn *stream;
+	int i, cnt = 0;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
+	for (i = 0; i < xnet_rdm_streams - 1; i++) {
+		stream = conn->streams[i];
+		if (!stream) {
+			if (!(conn->flags & XNET_CONN_NO_STREAMS) &&
+			    xnet_connect_stream(conn, i + 1))
+				conn->flags |= XNET_CONN_NO_STREAMS;
+			continue;
+		}
+
+		if (stream->ep && stream->ep->state == XNET_CONNECTED)
+			eps[cnt++] = stream->ep;
+	}
+	return cnt;
+}
+
+/* Start connecting to a set of peers without waiting for any connection
+ * to complete, so that connection setup with all peers proceeds in
+ * parallel.  Peers already connected or connecting are skipped.
+ */
+int xnet_connect_addrs(struct xnet_rdm *rdm, const fi_addr_t *addr,
+		       size_t count)
+{
+	struct util_peer_addr **peer;
+	struct xnet_conn *conn;
+	size_t i;
+	int ret = 0, err;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
+	for (i = 0; i < count; i++) {
+		if (!ofi_av_addr_valid(rdm->util_ep.av, addr[i])) {
+			ret = ret ? ret : -FI_EINVAL;
+			continue;
+		}
+
+		peer = ofi_av_addr_context(rdm->util_ep.av, addr[i]);
+		if (!*peer) {
+			ret = ret ? ret : -FI_EINVAL;
+			continue;
+		}
+
+		conn = xnet_add_conn(rdm, *peer);
+		if (!conn) {
+			ret = ret ? ret : -FI_ENOMEM;
+			continue;
+		}
+
+		if (!conn->ep) {
+			err = xnet_rdm_connect(conn);
+			if (err && !ret)
+				ret = err;
+		}
+	}
+
+	xnet_run_progress(xnet_rdm2_progress(rdm), false);
+	return ret;
+}
+
+static void xnet_conn_established(struct xnet_conn *conn)
+{
+	struct fi_tcp_conn_stats *stats = &conn->rdm->conn_stats;
+	uint64_t usec;
+
+	if (!conn->connect_start)
+		return;
+
+	usec = ofi_gettime_us() - conn->connect_start;
+	conn->connect_start = 0;
+	stats->connected++;
+	stats->setup_usec[MIN(ofi_msb(usec), FI_TCP_CONN_HIST_SIZE - 1)]++;
+}
+
 struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr)
 {
 	struct util_peer_addr **peer;
@@ -389,6 +529,53 @@ struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr)
 	return NULL;
 }
 
+/* Additional streams from a peer are independent of any connection that
+ * we may have to that peer.  They only receive writes, which are placed
+ * directly into the target buffers.
+ */
+static void xnet_accept_stream(struct xnet_rdm *rdm,
+			       struct util_peer_addr *peer,
+			       struct fi_eq_cm_entry *cm_entry)
+{
+	struct xnet_rdm_cm *msg;
+	struct xnet_conn *conn;
+	int ret;
+
+	msg = (struct xnet_rdm_cm *) cm_entry->data;
+	conn = xnet_alloc_conn(rdm, peer);
+	util_put_peer(peer);
+	if (!conn)
+		goto reject;
+
+	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "connreq for stream %d, %p\n",
+		msg->resv, conn);
+	conn->flags |= XNET_CONN_STREAM;
+	conn->stream_idx = msg->resv;
+	conn->remote_pid = ntohl(msg->pid);
+	dlist_insert_tail(&conn->stream_entry, &rdm->stream_list);
+
+	ret = xnet_open_conn(conn, cm_entry->info);
+	if (ret)
+		goto free;
+
+	msg->pid = htonl((uint32_t) getpid());
+	ret = fi_accept(&conn->ep->util_ep.ep_fid, msg, sizeof(*msg));
+	if (ret)
+		goto close;
+
+	fi_freeinfo(cm_entry->info);
+	return;
+
+close:
+	xnet_close_conn(conn);
+free:
+	xnet_free_conn(conn);
+reject:
+	(void) fi_reject(&rdm->pep->util_pep.pep_fid, cm_entry->info->handle,
+			 msg, sizeof(*msg));
+	fi_freeinfo(cm_entry->info);
+}
+
 static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 {
 	struct xnet_rdm *rdm;
@@ -415,6 +602,11 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 		goto reject;
 	}
 
+	if (msg->resv) {
+		xnet_accept_stream(rdm, peer, cm_entry);
+		return;
+	}
+
 	conn = xnet_add_conn(rdm, peer);
 	if (!conn)
 		goto put;
@@ -526,9 +718,13 @@ void xnet_handle_event_list(struct xnet_progress *progress)
 			conn = event->cm_entry.fid->context;
 			msg = (struct xnet_rdm_cm *) event->cm_entry.data;
 			conn->remote_pid = ntohl(msg->pid);
+			xnet_conn_established(conn);
 			break;
 		case FI_SHUTDOWN:
 			conn = event->cm_entry.fid->context;
+			/* Stop using streams if the peer rejects them */
+			if (conn->parent && !conn->remote_pid)
+				conn->parent->flags |= XNET_CONN_NO_STREAMS;
 			xnet_close_conn(conn);
 			xnet_free_conn(conn);
 			break;
@@ -194,25 +194,13 @@ xnet_rma_readv(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	return xnet_rma_readmsg(ep_fid, &msg, 0);
 }
 
-static ssize_t
-xnet_rma_writemsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
-		 uint64_t flags)
+static void
+xnet_rma_write_fill(struct xnet_xfer_entry *send_entry, struct xnet_ep *ep,
+		    const struct fi_msg_rma *msg, uint64_t flags)
 {
-	struct xnet_ep *ep;
-	struct xnet_xfer_entry *send_entry;
 	struct ofi_rma_iov *rma_iov;
 	uint64_t data_len;
 	size_t offset;
-	ssize_t ret = 0;
-
-	ep = container_of(ep_fid, struct xnet_ep, util_ep.ep_fid);
-
-	ofi_genlock_lock(&xnet_ep2_progress(ep)->ep_lock);
-	send_entry = xnet_alloc_tx(ep);
-	if (!send_entry) {
-		ret = -FI_EAGAIN;
-		goto unlock;
-	}
 
 	assert(msg->iov_count <= XNET_IOV_LIMIT);
 	assert(msg->rma_iov_count <= XNET_IOV_LIMIT);
@@ -263,13 +251,118 @@ xnet_rma_writemsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
 	send_entry->cntr = ep->util_ep.cntrs[CNTR_WR];
 	xnet_set_commit_flags(send_entry, flags);
 	send_entry->context = msg->context;
+}
 
+static ssize_t
+xnet_rma_writemsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
+		 uint64_t flags)
+{
+	struct xnet_ep *ep;
+	struct xnet_xfer_entry *send_entry;
+	ssize_t ret = 0;
+
+	ep = container_of(ep_fid, struct xnet_ep, util_ep.ep_fid);
+
+	ofi_genlock_lock(&xnet_ep2_progress(ep)->ep_lock);
+	send_entry = xnet_alloc_tx(ep);
+	if (!send_entry) {
+		ret = -FI_EAGAIN;
+		goto unlock;
+	}
+
+	xnet_rma_write_fill(send_entry, ep, msg, flags);
 	xnet_tx_queue_insert(ep, send_entry);
 unlock:
 	ofi_genlock_unlock(&xnet_ep2_progress(ep)->ep_lock);
 	return ret;
 }
 
+/* Split a write into cnt + 1 pieces.  One piece is sent over each of the
+ * streams, requesting delivery acks from the peer, with the final piece
+ * queued on ep.  See struct xnet_stripe.  All endpoints share the same
+ * progress instance, which the caller must hold.
+ */
+ssize_t xnet_rma_stripe_write(struct xnet_ep *ep, struct xnet_ep **streams,
+			      int cnt, const struct fi_msg_rma *msg,
+			      uint64_t flags)
+{
+	struct xnet_xfer_entry *piece[XNET_MAX_STREAMS];
+	struct iovec iov[XNET_IOV_LIMIT];
+	struct fi_rma_iov rma_iov[XNET_IOV_LIMIT];
+	struct fi_msg_rma piece_msg;
+	struct xnet_stripe *stripe;
+	size_t iov_index = 0, iov_offset = 0;
+	size_t rma_index = 0, rma_offset = 0;
+	size_t len, piece_len;
+	int i;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	assert(cnt > 0 && cnt < XNET_MAX_STREAMS);
+	assert(!(flags & FI_INJECT));
+
+	stripe = malloc(sizeof(*stripe));
+	if (!stripe)
+		return -FI_EAGAIN;
+
+	for (i = 0; i <= cnt; i++) {
+		piece[i] = xnet_alloc_tx(i < cnt ? streams[i] : ep);
+		if (!piece[i])
+			goto free;
+	}
+
+	len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+	piece_len = len / (cnt + 1);
+	piece_msg = *msg;
+	piece_msg.msg_iov = iov;
+	piece_msg.desc = NULL;
+	piece_msg.rma_iov = rma_iov;
+
+	stripe->ep = ep;
+	stripe->parent = piece[cnt];
+	stripe->pending = cnt;
+	stripe->err = 0;
+
+	for (i = 0; i <= cnt; i++) {
+		if (i == cnt)
+			piece_len = len;
+		(void) ofi_copy_iov_desc(iov, NULL, &piece_msg.iov_count,
+					 (struct iovec *) msg->msg_iov, NULL,
+					 msg->iov_count, &iov_index,
+					 &iov_offset, piece_len);
+		(void) ofi_copy_rma_iov(rma_iov, &piece_msg.rma_iov_count,
+					(struct fi_rma_iov *) msg->rma_iov,
+					msg->rma_iov_count, &rma_index,
+					&rma_offset, piece_len);
+		len -= piece_len;
+
+		piece[i]->stripe = stripe;
+		if (i == cnt) {
+			xnet_rma_write_fill(piece[i], ep, &piece_msg, flags);
+			piece[i]->ctrl_flags |= XNET_STRIPE_WAIT;
+		} else {
+			xnet_rma_write_fill(piece[i], streams[i], &piece_msg,
+					    FI_DELIVERY_COMPLETE);
+			piece[i]->ctrl_flags |= XNET_STRIPE_XFER;
+			piece[i]->cq_flags = 0;
+			piece[i]->cntr = NULL;
+		}
+	}
+
+	/* Queue the final piece first to hold its place on the primary
+	 * stream, as the other pieces may complete immediately.
+	 */
+	xnet_tx_queue_insert(ep, piece[cnt]);
+	for (i = 0; i < cnt; i++)
+		xnet_tx_queue_insert(streams[i], piece[i]);
+	return 0;
+
+free:
+	while (i--)
+		xnet_free_xfer(xnet_ep2_progress(ep), piece[i]);
+	free(stripe);
+	return -FI_EAGAIN;
+}
+
 static ssize_t
 xnet_rma_write(struct fid_ep *ep_fid, const void *buf, size_t len, void *desc,
 	       fi_addr_t dest_addr, uint64_t addr, uint64_t key, void *context)
@@ -42,6 +42,76 @@
 static struct xnet_xfer_entry *
 xnet_match_tag(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag);
 
+struct xnet_tag_match {
+	struct slist		*queue;
+	struct slist_entry	*item;
+	struct slist_entry	*prev;
+	struct xnet_xfer_entry	*rx_entry;
+};
+
+/* Without directed receive support, all receives match any source. */
+static fi_addr_t
+xnet_tag_src(struct xnet_srx *srx, struct xnet_xfer_entry *rx_entry)
+{
+	return (srx->match_tag_rx == xnet_match_tag) ?
+		FI_ADDR_UNSPEC : rx_entry->src_addr;
+}
+
+static struct slist *
+xnet_tag_bucket(struct xnet_srx *srx, uint64_t tag, fi_addr_t src)
+{
+	return &srx->tag_buckets[xnet_tag_hash(tag, src)];
+}
+
+static void
+xnet_queue_tag(struct xnet_srx *srx, struct slist *queue,
+	       struct xnet_xfer_entry *recv_entry)
+{
+	if (recv_entry->ignore) {
+		slist_insert_tail(&recv_entry->entry, queue);
+	} else {
+		slist_insert_tail(&recv_entry->entry,
+				  xnet_tag_bucket(srx, recv_entry->tag,
+						  xnet_tag_src(srx, recv_entry)));
+	}
+}
+
+/* Queues are ordered by tag_seq_no, so we can stop searching a queue
+ * once we pass a match found earlier on another queue.  Buckets hold
+ * receives for multiple tag/source pairs, so both must be checked.
+ */
+static void
+xnet_match_queue(struct xnet_srx *srx, struct slist *queue, bool bucket,
+		 uint64_t tag, fi_addr_t src, struct xnet_tag_match *match)
+{
+	struct xnet_xfer_entry *rx_entry;
+	struct slist_entry *item, *prev;
+
+	slist_foreach(queue, item, prev) {
+		rx_entry = container_of(item, struct xnet_xfer_entry, entry);
+		if (match->rx_entry &&
+		    rx_entry->tag_seq_no > match->rx_entry->tag_seq_no)
+			return;
+
+		if (bucket ? (rx_entry->tag == tag &&
+			      xnet_tag_src(srx, rx_entry) == src) :
+			     ofi_match_tag(rx_entry->tag, rx_entry->ignore, tag)) {
+			match->queue = queue;
+			match->item = item;
+			match->prev = prev;
+			match->rx_entry = rx_entry;
+			return;
+		}
+	}
+}
+
+static struct xnet_xfer_entry *xnet_take_match(struct xnet_tag_match *match)
+{
+	if (match->rx_entry)
+		slist_remove(match->queue, match->item, match->prev);
+	return match->rx_entry;
+}
+
 
 /* The rdm ep calls directly through to the srx calls, so we need to use the
  * progress active_lock for protection.
@@ -230,6 +300,45 @@ static int xnet_match_unexp(struct dlist_entry *item, const void *arg)
 	return xnet_match_msg(ep->cur_rx.claim_ctx, &ep->cur_rx.hdr, arg);
 }
 
+static void
+xnet_unlink_saved(struct xnet_saved_msg *saved_msg,
+		  struct slist_entry *item, struct slist_entry *prev)
+{
+	struct xnet_xfer_entry *saved_entry;
+
+	saved_entry = container_of(item, struct xnet_xfer_entry, entry);
+	slist_remove(&saved_msg->queue, item, prev);
+	dlist_remove(&saved_entry->tag_entry);
+	if (!--saved_msg->cnt) {
+		assert(!dlist_empty(&saved_msg->entry));
+		dlist_remove_init(&saved_msg->entry);
+	}
+}
+
+void xnet_srx_flush_rts(struct xnet_ep *ep)
+{
+	struct xnet_xfer_entry *saved_entry;
+	struct slist_entry *item, *prev;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (!ep->saved_msg)
+		return;
+
+	for (prev = NULL, item = ep->saved_msg->queue.head; item; ) {
+		saved_entry = container_of(item, struct xnet_xfer_entry, entry);
+		if ((saved_entry->saving_ep != ep) ||
+		    !(saved_entry->hdr.base_hdr.flags & XNET_RNDV)) {
+			prev = item;
+			item = item->next;
+			continue;
+		}
+
+		item = item->next;
+		xnet_unlink_saved(ep->saved_msg, &saved_entry->entry, prev);
+		xnet_free_xfer(xnet_ep2_progress(ep), saved_entry);
+	}
+}
+
 static struct xnet_xfer_entry *
 xnet_match_saved(struct xnet_progress *progress, struct xnet_saved_msg *saved_msg,
 		 struct xnet_xfer_entry *rx_entry, bool remove)
@@ -244,28 +353,64 @@ xnet_match_saved(struct xnet_progress *progress, struct xnet_saved_msg *saved_ms
 		saved_entry = container_of(item, struct xnet_xfer_entry, entry);
 		if (xnet_match_msg(saved_entry->context, &saved_entry->hdr,
 				   rx_entry)) {
-			if (remove) {
-				slist_remove(&saved_msg->queue, item, prev);
-				if (!--saved_msg->cnt) {
-					assert(!dlist_empty(&saved_msg->entry));
-					dlist_remove_init(&saved_msg->entry);
-				}
-			}
+			if (remove)
+				xnet_unlink_saved(saved_msg, item, prev);
 			return saved_entry;
 		}
 	}
 	return NULL;
 }
 
+/* The per source saved queues are bounded by xnet_max_saved, so removing
+ * an entry found through the tag index is cheap.
+ */
+static struct xnet_xfer_entry *
+xnet_search_saved_tag(struct xnet_srx *srx, struct xnet_xfer_entry *rx_entry,
+		      bool remove)
+{
+	struct xnet_xfer_entry *saved_entry;
+	struct xnet_saved_msg *saved_msg;
+	struct dlist_entry *entry;
+	struct slist_entry *item, *prev;
+
+	dlist_foreach(xnet_saved_bucket(srx, rx_entry->tag), entry) {
+		saved_entry = container_of(entry, struct xnet_xfer_entry,
+					   tag_entry);
+		if (!xnet_match_msg(saved_entry->context, &saved_entry->hdr,
+				    rx_entry))
+			continue;
+
+		if (remove) {
+			saved_msg = ofi_array_at(&srx->saved_msgs,
+						 saved_entry->src_addr);
+			assert(saved_msg && saved_msg->cnt);
+			slist_foreach(&saved_msg->queue, item, prev) {
+				if (item == &saved_entry->entry)
+					break;
+			}
+			assert(item);
+			xnet_unlink_saved(saved_msg, item, prev);
+		}
+		return saved_entry;
+	}
+
+	return NULL;
+}
+
 static struct xnet_xfer_entry *
-xnet_search_saved(struct xnet_progress *progress,
-		  struct xnet_xfer_entry *rx_entry, bool remove)
+xnet_search_saved(struct xnet_srx *srx, struct xnet_xfer_entry *rx_entry,
+		  bool remove)
 {
+	struct xnet_progress *progress;
 	struct xnet_xfer_entry *saved_entry;
 	struct xnet_saved_msg *saved_msg;
 	struct dlist_entry *item;
 
+	progress = xnet_srx2_progress(srx);
 	assert(ofi_genlock_held(progress->active_lock));
+	if (!rx_entry->ignore)
+		return xnet_search_saved_tag(srx, rx_entry, remove);
+
 	dlist_foreach(&progress->saved_tag_list, item) {
 		saved_msg = container_of(item, struct xnet_saved_msg, entry);
 
@@ -293,7 +438,7 @@ xnet_find_msg(struct xnet_srx *srx, struct xnet_xfer_entry *recv_entry,
 	*ep = NULL;
 	if ((srx->match_tag_rx == xnet_match_tag) ||
 	    (recv_entry->src_addr == FI_ADDR_UNSPEC)) {
-		*saved_entry = xnet_search_saved(progress, recv_entry, remove);
+		*saved_entry = xnet_search_saved(srx, recv_entry, remove);
 		if (*saved_entry)
 			return true;
 
@@ -454,13 +599,13 @@ xnet_srx_tag(struct xnet_srx *srx, struct xnet_xfer_entry *recv_entry)
 
 	if ((srx->match_tag_rx == xnet_match_tag) ||
 	    (recv_entry->src_addr == FI_ADDR_UNSPEC)) {
-		saved_entry = xnet_search_saved(progress, recv_entry, true);
+		saved_entry = xnet_search_saved(srx, recv_entry, true);
 		if (saved_entry) {
 			xnet_recv_saved(saved_entry, recv_entry);
 			return 0;
 		}
 
-		slist_insert_tail(&recv_entry->entry, &srx->tag_queue);
+		xnet_queue_tag(srx, &srx->tag_queue, recv_entry);
 
 		/* The message could match any endpoint waiting. */
 		if (!dlist_empty(&progress->unexp_tag_list))
@@ -482,16 +627,16 @@ xnet_srx_tag(struct xnet_srx *srx, struct xnet_xfer_entry *recv_entry)
 
 		ep = xnet_get_rx_ep(srx->rdm, recv_entry->src_addr);
 		if (!ep) {
-			slist_insert_tail(&recv_entry->entry, queue);
+			xnet_queue_tag(srx, queue, recv_entry);
 			return 0;
 		}
 
 		if (xnet_has_unexp(ep)) {
 			assert(!dlist_empty(&ep->unexp_entry));
-			slist_insert_tail(&recv_entry->entry, queue);
+			xnet_queue_tag(srx, queue, recv_entry);
 			xnet_progress_rx(ep);
 		} else {
-			slist_insert_tail(&recv_entry->entry, queue);
+			xnet_queue_tag(srx, queue, recv_entry);
 		}
 	}
 
@@ -635,32 +780,25 @@ static struct fi_ops_tagged xnet_srx_tag_ops = {
 static struct xnet_xfer_entry *
 xnet_match_tag(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag)
 {
-	struct xnet_xfer_entry *rx_entry;
-	struct slist_entry *item, *prev;
+	struct xnet_tag_match match = {0};
 
 	assert(xnet_progress_locked(xnet_srx2_progress(srx)));
-	slist_foreach(&srx->tag_queue, item, prev) {
-		rx_entry = container_of(item, struct xnet_xfer_entry, entry);
-		if (ofi_match_tag(rx_entry->tag, rx_entry->ignore, tag)) {
-			slist_remove(&srx->tag_queue, item, prev);
-			return rx_entry;
-		}
-	}
-	return NULL;
+	xnet_match_queue(srx, xnet_tag_bucket(srx, tag, FI_ADDR_UNSPEC), true,
+			 tag, FI_ADDR_UNSPEC, &match);
+	xnet_match_queue(srx, &srx->tag_queue, false, tag, FI_ADDR_UNSPEC,
+			 &match);
+	return xnet_take_match(&match);
 }
 
-/* A matching receive could be found on either the any source queue or the
- * source matched queue.  However, most apps going through this path will
- * use source matching, with the any source queue being empty.  We optimize
- * for this case.
+/* A matching receive could be found on either the any source or the source
+ * matched queues.  We select the earliest posted receive among them.
  */
 static struct xnet_xfer_entry *
 xnet_match_tag_addr(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag)
 {
-	struct xnet_xfer_entry *rx_entry, *any_entry;
+	struct xnet_tag_match match = {0};
 	struct slist *queue;
-	struct slist_entry *any_item, *any_prev;
-	struct slist_entry *item, *prev;
+	fi_addr_t src;
 
 	assert(xnet_progress_locked(xnet_srx2_progress(srx)));
 
@@ -669,34 +807,15 @@ xnet_match_tag_addr(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag)
 	if (!queue)
 		return xnet_match_tag(srx, ep, tag);
 
-	slist_foreach(queue, item, prev) {
-		rx_entry = container_of(item, struct xnet_xfer_entry, entry);
-		if (ofi_match_tag(rx_entry->tag, rx_entry->ignore, tag))
-			goto found;
-	}
-
-	return xnet_match_tag(srx, ep, tag);
-
-found:
-	/* We select from the any source queue if it matches and was posted
-	 * earlier than our source based match.
-	 */
-	slist_foreach(&srx->tag_queue, any_item, any_prev) {
-		any_entry = container_of(any_item, struct xnet_xfer_entry, entry);
-		if (any_entry->tag_seq_no > rx_entry->tag_seq_no)
-			break;
-
-		if (ofi_match_tag(any_entry->tag, any_entry->ignore, tag)) {
-			queue = &srx->tag_queue;
-			rx_entry = any_entry;
-			item = any_item;
-			prev = any_prev;
-			break;
-		}
-	}
-
-	slist_remove(queue, item, prev);
-	return rx_entry;
+	src = ep->peer->fi_addr;
+	xnet_match_queue(srx, xnet_tag_bucket(srx, tag, src), true,
+			 tag, src, &match);
+	xnet_match_queue(srx, queue, false, tag, src, &match);
+	xnet_match_queue(srx, xnet_tag_bucket(srx, tag, FI_ADDR_UNSPEC), true,
+			 tag, FI_ADDR_UNSPEC, &match);
+	xnet_match_queue(srx, &srx->tag_queue, false, tag, FI_ADDR_UNSPEC,
+			 &match);
+	return xnet_take_match(&match);
 }
 
 static bool
@@ -732,6 +851,7 @@ xnet_srx_cancel_src(struct ofi_dyn_arr *arr, void *list, void *context)
 static ssize_t xnet_srx_cancel(fid_t fid, void *context)
 {
 	struct xnet_srx *srx;
+	int i;
 
 	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
 
@@ -739,6 +859,11 @@ static ssize_t xnet_srx_cancel(fid_t fid, void *context)
 	if (xnet_srx_cancel_rx(srx, &srx->tag_queue, context))
 		goto unlock;
 
+	for (i = 0; i < XNET_TAG_BUCKETS; i++) {
+		if (xnet_srx_cancel_rx(srx, &srx->tag_buckets[i], context))
+			goto unlock;
+	}
+
 	if (xnet_srx_cancel_rx(srx, &srx->rx_queue, context))
 		goto unlock;
 
@@ -824,6 +949,13 @@ xnet_srx_cleanup_saved(struct ofi_dyn_arr *arr, void *item, void *context)
 {
 	struct xnet_srx *srx = context;
 	struct xnet_saved_msg *saved_msg = item;
+	struct xnet_xfer_entry *saved_entry;
+	struct slist_entry *cur;
+
+	for (cur = saved_msg->queue.head; cur; cur = cur->next) {
+		saved_entry = container_of(cur, struct xnet_xfer_entry, entry);
+		dlist_remove(&saved_entry->tag_entry);
+	}
 
 	dlist_remove_init(&saved_msg->entry);
 	xnet_srx_cleanup(srx, &saved_msg->queue);
@@ -844,18 +976,23 @@ xnet_init_saved_msg(struct ofi_dyn_arr *arr, void *item)
 static int xnet_srx_close(struct fid *fid)
 {
 	struct xnet_srx *srx;
+	int i;
 
 	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
 
 	ofi_genlock_lock(xnet_srx2_progress(srx)->active_lock);
 	xnet_srx_cleanup(srx, &srx->rx_queue);
 	xnet_srx_cleanup(srx, &srx->tag_queue);
+	for (i = 0; i < XNET_TAG_BUCKETS; i++)
+		xnet_srx_cleanup(srx, &srx->tag_buckets[i]);
 	ofi_array_iter(&srx->src_tag_queues, srx, xnet_srx_cleanup_queues);
 	ofi_array_iter(&srx->saved_msgs, srx, xnet_srx_cleanup_saved);
 	ofi_genlock_unlock(xnet_srx2_progress(srx)->active_lock);
 
 	ofi_array_destroy(&srx->src_tag_queues);
 	ofi_array_destroy(&srx->saved_msgs);
+	free(srx->tag_buckets);
+	free(srx->saved_buckets);
 
 	if (srx->cntr)
 		ofi_atomic_dec32(&srx->cntr->ref);
@@ -878,11 +1015,27 @@ int xnet_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 		     struct fid_ep **rx_ep, void *context)
 {
 	struct xnet_srx *srx;
+	int i;
 
 	srx = calloc(1, sizeof(*srx));
 	if (!srx)
 		return -FI_ENOMEM;
 
+	srx->tag_buckets = calloc(XNET_TAG_BUCKETS, sizeof(*srx->tag_buckets));
+	srx->saved_buckets = calloc(XNET_TAG_BUCKETS,
+				    sizeof(*srx->saved_buckets));
+	if (!srx->tag_buckets || !srx->saved_buckets) {
+		free(srx->tag_buckets);
+		free(srx->saved_buckets);
+		free(srx);
+		return -FI_ENOMEM;
+	}
+
+	for (i = 0; i < XNET_TAG_BUCKETS; i++) {
+		slist_init(&srx->tag_buckets[i]);
+		dlist_init(&srx->saved_buckets[i]);
+	}
+
 	srx->rx_fid.fid.fclass = FI_CLASS_SRX_CTX;
 	srx->rx_fid.fid.context = context;
 	srx->rx_fid.fid.ops = &xnet_srx_fid_ops;
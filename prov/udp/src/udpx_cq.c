@@ -61,12 +61,16 @@ int udpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 {
 	int ret;
 	struct util_cq *cq;
+	struct fi_cq_attr cq_attr;
 
 	cq = calloc(1, sizeof(*cq));
 	if (!cq)
 		return -FI_ENOMEM;
 
-	ret = ofi_cq_init(&udpx_prov, domain, attr, cq,
+	/* Completions are written straight into the cirq under cq_lock */
+	cq_attr = *attr;
+	cq_attr.flags |= OFI_CQ_DIRECT;
+	ret = ofi_cq_init(&udpx_prov, domain, &cq_attr, cq,
 			   &ofi_cq_progress, context);
 	if (ret) {
 		free(cq);
@@ -256,6 +256,20 @@ void *ofi_av_addr_context(struct util_av *av, fi_addr_t fi_addr)
 	return (char *) addr + av->context_offset;
 }
 
+/* Checks that fi_addr refers to an address currently in the AV */
+bool ofi_av_addr_valid(struct util_av *av, fi_addr_t fi_addr)
+{
+	struct util_av_entry *entry;
+	bool valid = false;
+
+	ofi_mutex_lock(&av->lock);
+	entry = ofi_bufpool_peek_ibuf(av->av_entry_pool, fi_addr);
+	if (entry)
+		valid = ofi_av_lookup_fi_addr_unsafe(av, entry->data) == fi_addr;
+	ofi_mutex_unlock(&av->lock);
+	return valid;
+}
+
 int ofi_verify_av_insert(struct util_av *av, uint64_t flags, void *context)
 {
 	if (av->flags & FI_EVENT) {
@@ -283,13 +297,14 @@ int ofi_verify_av_insert(struct util_av *av, uint64_t flags, void *context)
 	return 0;
 }
 
-int ofi_av_insert_addr(struct util_av *av, const void *addr, fi_addr_t *fi_addr)
+static int util_av_insert_hashed(struct util_av *av, const void *addr,
+				 unsigned hashv, fi_addr_t *fi_addr)
 {
 	struct util_av_entry *entry = NULL;
 
 	assert(ofi_mutex_held(&av->lock));
 	ofi_straddr_log(av->prov, FI_LOG_INFO, FI_LOG_AV, "inserting addr", addr);
-	HASH_FIND(hh, av->hash, addr, av->addrlen, entry);
+	HASH_FIND_BYHASHVALUE(hh, av->hash, addr, av->addrlen, hashv, entry);
 	if (entry) {
 		if (fi_addr)
 			*fi_addr = ofi_buf_index(entry);
@@ -309,13 +324,75 @@ int ofi_av_insert_addr(struct util_av *av, const void *addr, fi_addr_t *fi_addr)
 			*fi_addr = ofi_buf_index(entry);
 		memcpy(entry->data, addr, av->addrlen);
 		ofi_atomic_initialize32(&entry->use_cnt, 1);
-		HASH_ADD(hh, av->hash, data, av->addrlen, entry);
+		HASH_ADD_KEYPTR_BYHASHVALUE(hh, av->hash, entry->data,
+					    av->addrlen, hashv, entry);
 		FI_INFO(av->prov, FI_LOG_AV, "fi_addr: %" PRIu64 "\n",
 			ofi_buf_index(entry));
 	}
 	return 0;
 }
 
+int ofi_av_insert_addr(struct util_av *av, const void *addr, fi_addr_t *fi_addr)
+{
+	unsigned hashv;
+
+	HASH_VALUE(addr, av->addrlen, hashv);
+	return util_av_insert_hashed(av, addr, hashv, fi_addr);
+}
+
+/* Largest entry pool chunk that util_av_reserve will switch to */
+#define UTIL_AV_RESERVE_CHUNK_CNT 4096
+
+/*
+ * Size the entry pool and hash table for cnt more addresses, so a bulk
+ * insert does not grow them one chunk or bucket doubling at a time.  An
+ * unused entry pool with small chunks is recreated with chunks of up to
+ * UTIL_AV_RESERVE_CHUNK_CNT entries, which later growth keeps using, then
+ * grown to fit the insert.  The hash table only exists after the first
+ * insert.
+ */
+static void util_av_reserve(struct util_av *av, size_t cnt)
+{
+	struct ofi_bufpool_attr pool_attr;
+	struct ofi_bufpool *pool;
+	UT_hash_table *tbl;
+	size_t total;
+	int ret;
+
+	assert(ofi_mutex_held(&av->lock));
+	pool = av->av_entry_pool;
+	if (!pool->entry_cnt && cnt > pool->attr.chunk_cnt &&
+	    pool->attr.chunk_cnt < UTIL_AV_RESERVE_CHUNK_CNT) {
+		pool_attr = pool->attr;
+		pool_attr.chunk_cnt = MIN(roundup_power_of_two(cnt),
+					  UTIL_AV_RESERVE_CHUNK_CNT);
+		if (pool_attr.max_cnt)
+			pool_attr.chunk_cnt = MIN(pool_attr.chunk_cnt,
+						  pool_attr.max_cnt);
+		ret = ofi_bufpool_create_attr(&pool_attr, &pool);
+		if (!ret) {
+			ofi_bufpool_destroy(av->av_entry_pool);
+			av->av_entry_pool = pool;
+			FI_INFO(av->prov, FI_LOG_AV, "AV chunk size %zu\n",
+				pool_attr.chunk_cnt);
+		} else {
+			pool = av->av_entry_pool;
+		}
+	}
+
+	total = (av->hash ? HASH_COUNT(av->hash) : 0) + cnt;
+	while (pool->entry_cnt < total && !ofi_bufpool_grow(pool))
+		;
+
+	if (!av->hash)
+		return;
+
+	tbl = av->hash->hh.tbl;
+	while (!tbl->noexpand && tbl->num_buckets < total &&
+	       tbl->num_buckets < UINT_MAX / 2)
+		HASH_EXPAND_BUCKETS(hh, tbl, ret);
+}
+
 int ofi_av_remove_addr(struct util_av *av, fi_addr_t fi_addr)
 {
 	struct util_av_entry *av_entry;
@@ -612,37 +689,63 @@ fi_addr_t ofi_ip_av_get_fi_addr(struct util_av *av, const void *addr)
 	return ofi_av_lookup_fi_addr(av, addr);
 }
 
-static int ip_av_insert_addr(struct util_av *av, const void *addr,
-			     fi_addr_t *fi_addr, void *context)
+/*
+ * Addresses are inserted in batches.  Each batch is validated and hashed
+ * before taking the AV lock, so the lock is acquired once per batch and
+ * threads inserting into the same AV hash in parallel.
+ */
+#define UTIL_AV_INSERT_BATCH 256
+
+static void ip_av_insert_batch(struct util_av *av, const char *addr,
+			       size_t addrlen, size_t cnt, size_t remaining,
+			       fi_addr_t *fi_addr, int *err)
 {
-	int ret;
+	unsigned hashv[UTIL_AV_INSERT_BATCH];
+	size_t i;
 
-	if (ofi_valid_dest_ipaddr(addr)) {
-		ofi_mutex_lock(&av->lock);
-		ret = ofi_av_insert_addr(av, addr, fi_addr);
-		ofi_mutex_unlock(&av->lock);
-	} else {
-		ret = -FI_EADDRNOTAVAIL;
-		if (fi_addr)
-			*fi_addr = FI_ADDR_NOTAVAIL;
-		FI_WARN(av->prov, FI_LOG_AV, "invalid address\n");
+	for (i = 0; i < cnt; i++) {
+		if (ofi_valid_dest_ipaddr((const struct sockaddr *)
+					  (addr + i * addrlen))) {
+			HASH_VALUE(addr + i * addrlen, addrlen, hashv[i]);
+			err[i] = 0;
+		} else {
+			err[i] = -FI_EADDRNOTAVAIL;
+		}
 	}
 
-	ofi_straddr_dbg(av->prov, FI_LOG_AV, "av_insert addr", addr);
-	if (fi_addr)
-		FI_DBG(av->prov, FI_LOG_AV, "av_insert fi_addr: %" PRIu64 "\n",
-		       *fi_addr);
+	ofi_mutex_lock(&av->lock);
+	util_av_reserve(av, remaining);
+	for (i = 0; i < cnt; i++) {
+		if (!err[i])
+			err[i] = util_av_insert_hashed(av, addr + i * addrlen,
+						hashv[i],
+						fi_addr ? &fi_addr[i] : NULL);
+	}
+	ofi_mutex_unlock(&av->lock);
 
-	return ret;
+	for (i = 0; i < cnt; i++) {
+		if (err[i] == -FI_EADDRNOTAVAIL) {
+			if (fi_addr)
+				fi_addr[i] = FI_ADDR_NOTAVAIL;
+			FI_WARN(av->prov, FI_LOG_AV, "invalid address\n");
+		}
+
+		ofi_straddr_dbg(av->prov, FI_LOG_AV, "av_insert addr",
+				addr + i * addrlen);
+		if (fi_addr)
+			FI_DBG(av->prov, FI_LOG_AV, "av_insert fi_addr: %"
+			       PRIu64 "\n", fi_addr[i]);
+	}
 }
 
 int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		      size_t count, fi_addr_t *fi_addr, uint64_t flags,
 		      void *context)
 {
+	int err[UTIL_AV_INSERT_BATCH];
 	int ret, success_cnt = 0;
 	int *sync_err = NULL;
-	size_t i;
+	size_t i, j, cnt;
 
 	if (!count)
 		goto done;
@@ -664,15 +767,20 @@ int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		memset(sync_err, 0, sizeof(*sync_err) * count);
 	}
 
-	for (i = 0; i < count; i++) {
-		ret = ip_av_insert_addr(av, (const char *) addr + i * addrlen,
-					fi_addr ? &fi_addr[i] : NULL, context);
-		if (!ret)
-			success_cnt++;
-		else if (av->eq)
-			ofi_av_write_event(av, i, -ret, context);
-		else if (sync_err)
-			sync_err[i] = -ret;
+	for (i = 0; i < count; i += cnt) {
+		cnt = MIN(count - i, UTIL_AV_INSERT_BATCH);
+		ip_av_insert_batch(av, (const char *) addr + i * addrlen,
+				   addrlen, cnt, count - i,
+				   fi_addr ? &fi_addr[i] : NULL, err);
+
+		for (j = 0; j < cnt; j++) {
+			if (!err[j])
+				success_cnt++;
+			else if (av->eq)
+				ofi_av_write_event(av, i + j, -err[j], context);
+			else if (sync_err)
+				sync_err[i + j] = -err[j];
+		}
 	}
 
 done:
@@ -44,27 +44,69 @@ enum {
 	OFI_BUFPOOL_REGION_CHUNK_CNT = 16
 };
 
+OFI_THREAD_LOCAL struct ofi_bufpool_tslot
+	ofi_bufpool_tslots[OFI_BUFPOOL_TCACHE_SLOTS];
+
+/* Protects the list of live thread cached pools and id assignment */
+static pthread_mutex_t ofi_bufpool_tcache_lock = PTHREAD_MUTEX_INITIALIZER;
+static DEFINE_LIST(ofi_bufpool_tcache_pools);
+static uint64_t ofi_bufpool_next_id;
+
+/* Returns the caches of exiting threads; exists while any pool does */
+static pthread_key_t ofi_bufpool_tcache_key;
+
+
+/*
+ * Try the supported huge page sizes from largest to smallest, skipping
+ * sizes larger than the region.  A size that fails once is not retried.
+ */
+static int ofi_bufpool_hugepage_alloc(struct ofi_bufpool_region *buf_region)
+{
+	struct ofi_bufpool *pool = buf_region->pool;
+	size_t page_size, alloc_size, i;
+	int ret;
+
+	for (;;) {
+		page_size = 0;
+		for (i = OFI_DEF_HUGEPAGE_SIZE; i < num_page_sizes; i++) {
+			if (page_sizes[i] < pool->hugepage_limit &&
+			    page_sizes[i] <= pool->alloc_size &&
+			    page_sizes[i] > page_size)
+				page_size = page_sizes[i];
+		}
+		if (!page_size)
+			return -FI_ENOMEM;
+
+		alloc_size = ofi_get_aligned_size(pool->alloc_size, page_size);
+		ret = ofi_alloc_hugepage_buf_sz((void **) &buf_region->alloc_region,
+						alloc_size, page_size);
+		if (!ret) {
+			buf_region->flags = OFI_BUFPOOL_HUGEPAGES |
+					    OFI_BUFPOOL_NONSHARED;
+			pool->alloc_size = alloc_size;
+			pool->region_size = pool->alloc_size - pool->entry_size;
+			pool->stats.hugepage_cnt++;
+			return 0;
+		}
+
+		FI_DBG(&core_prov, FI_LOG_CORE,
+		       "%zu byte huge page allocation failed: %s\n",
+		       page_size, fi_strerror(-ret));
+		pool->stats.hugepage_miss++;
+		pool->hugepage_limit = page_size;
+	}
+}
 
 static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 {
 	int ret;
 	ssize_t page_size;
-	size_t alloc_size;
 	struct ofi_bufpool *pool = buf_region->pool;
 
 	if (pool->attr.flags & OFI_BUFPOOL_HUGEPAGES) {
-		page_size = ofi_get_hugepage_size();
-		if (page_size > 0 && pool->alloc_size >= (size_t) page_size) {
-			alloc_size = ofi_get_aligned_size(pool->alloc_size, (size_t) page_size);
-			ret = ofi_alloc_hugepage_buf((void **) &buf_region->alloc_region,
-					     alloc_size);
-			if (!ret) {
-				buf_region->flags = OFI_BUFPOOL_HUGEPAGES | OFI_BUFPOOL_NONSHARED;
-				pool->alloc_size = alloc_size;
-				pool->region_size = pool->alloc_size - pool->entry_size;
-				return 0;
-			}
-		}
+		if (!ofi_bufpool_hugepage_alloc(buf_region))
+			return 0;
+
 		/* If we can't allocate huge pages, fall back to mmap
 		 * for all future attempts.
 		 */
@@ -197,6 +239,8 @@ int ofi_bufpool_grow(struct ofi_bufpool *pool)
 		dlist_insert_tail(&buf_region->entry, &pool->free_list.regions);
 
 	pool->entry_cnt += pool->attr.chunk_cnt;
+	pool->stats.region_cnt = pool->region_cnt;
+	pool->stats.entry_cnt = pool->entry_cnt;
 	return 0;
 
 err3:
@@ -209,11 +253,212 @@ err1:
 	return ret;
 }
 
+/* Caller must hold pool->lock */
+static void ofi_bufpool_tcache_put(struct ofi_bufpool_tcache *cache,
+				   size_t cnt)
+{
+	struct slist_entry *entry;
+
+	while (cnt-- && !slist_empty(&cache->entries)) {
+		entry = slist_remove_head(&cache->entries);
+		slist_insert_head(entry, &cache->pool->free_list.entries);
+		cache->cnt--;
+	}
+}
+
+int ofi_bufpool_tcache_refill(struct ofi_bufpool_tcache *cache)
+{
+	struct ofi_bufpool *pool = cache->pool;
+	struct slist_entry *entry;
+
+	pthread_mutex_lock(&pool->lock);
+	while (cache->cnt < OFI_BUFPOOL_TCACHE_BATCH) {
+		/* Only grow the pool if we could not take anything */
+		if (ofi_bufpool_empty(pool) &&
+		    (cache->cnt || ofi_bufpool_grow(pool)))
+			break;
+
+		entry = slist_remove_head(&pool->free_list.entries);
+		slist_insert_head(entry, &cache->entries);
+		cache->cnt++;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return cache->cnt ? 0 : -FI_ENOMEM;
+}
+
+void ofi_bufpool_tcache_drain(struct ofi_bufpool_tcache *cache, size_t cnt)
+{
+	pthread_mutex_lock(&cache->pool->lock);
+	ofi_bufpool_tcache_put(cache, cnt);
+	pthread_mutex_unlock(&cache->pool->lock);
+}
+
+static int ofi_bufpool_match_id(struct dlist_entry *item, const void *arg)
+{
+	struct ofi_bufpool *pool;
+
+	pool = container_of(item, struct ofi_bufpool, entry);
+	return pool->id == *(const uint64_t *) arg;
+}
+
+/*
+ * Return a cache that lost its slot to another pool.  If the owning pool
+ * was destroyed, the cache was already freed along with it.
+ */
+static void ofi_bufpool_tcache_release(struct ofi_bufpool_tslot *slot)
+{
+	struct ofi_bufpool *pool;
+	struct dlist_entry *item;
+
+	pthread_mutex_lock(&ofi_bufpool_tcache_lock);
+	item = dlist_find_first_match(&ofi_bufpool_tcache_pools,
+				      ofi_bufpool_match_id, &slot->pool_id);
+	if (item) {
+		pool = container_of(item, struct ofi_bufpool, entry);
+		assert(slot->cache->pool == pool);
+
+		pthread_mutex_lock(&pool->lock);
+		ofi_bufpool_tcache_put(slot->cache, slot->cache->cnt);
+		dlist_remove(&slot->cache->pool_entry);
+		pthread_mutex_unlock(&pool->lock);
+		free(slot->cache);
+	}
+	pthread_mutex_unlock(&ofi_bufpool_tcache_lock);
+
+	slot->pool_id = 0;
+	slot->cache = NULL;
+}
+
+static void ofi_bufpool_tcache_exit(void *arg)
+{
+	int i;
+
+	for (i = 0; i < OFI_BUFPOOL_TCACHE_SLOTS; i++) {
+		if (ofi_bufpool_tslots[i].pool_id)
+			ofi_bufpool_tcache_release(&ofi_bufpool_tslots[i]);
+	}
+}
+
+struct ofi_bufpool_tcache *ofi_bufpool_tcache_get(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_tslot *slot;
+	struct ofi_bufpool_tcache *cache;
+
+	assert(pool->attr.flags & OFI_BUFPOOL_THREAD_CACHE);
+	slot = &ofi_bufpool_tslots[pool->id % OFI_BUFPOOL_TCACHE_SLOTS];
+	if (slot->pool_id)
+		ofi_bufpool_tcache_release(slot);
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	slist_init(&cache->entries);
+	cache->pool = pool;
+
+	/* Any non-NULL value makes the key run the exit handler */
+	pthread_mutex_lock(&ofi_bufpool_tcache_lock);
+	(void) pthread_setspecific(ofi_bufpool_tcache_key, cache);
+	pthread_mutex_unlock(&ofi_bufpool_tcache_lock);
+
+	pthread_mutex_lock(&pool->lock);
+	dlist_insert_tail(&cache->pool_entry, &pool->tcache_list);
+	pthread_mutex_unlock(&pool->lock);
+
+	slot->pool_id = pool->id;
+	slot->cache = cache;
+	return cache;
+}
+
+void *ofi_buf_alloc_locked(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_hdr *buf_hdr = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (!ofi_bufpool_empty(pool) || !ofi_bufpool_grow(pool)) {
+		slist_remove_head_container(&pool->free_list.entries,
+				struct ofi_bufpool_hdr, buf_hdr, entry.slist);
+		assert(ofi_atomic_inc32(&buf_hdr->region->use_cnt));
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return buf_hdr ? ofi_buf_data(buf_hdr) : NULL;
+}
+
+void ofi_buf_free_locked(void *buf)
+{
+	struct ofi_bufpool *pool = ofi_buf_pool(buf);
+
+	pthread_mutex_lock(&pool->lock);
+	slist_insert_head(&ofi_buf_hdr(buf)->entry.slist,
+			  &pool->free_list.entries);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static int ofi_bufpool_tcache_init(struct ofi_bufpool *pool)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&ofi_bufpool_tcache_lock);
+	if (dlist_empty(&ofi_bufpool_tcache_pools)) {
+		ret = -pthread_key_create(&ofi_bufpool_tcache_key,
+					  ofi_bufpool_tcache_exit);
+		if (ret)
+			goto unlock;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	dlist_init(&pool->tcache_list);
+	pool->id = ++ofi_bufpool_next_id;
+	dlist_insert_tail(&pool->entry, &ofi_bufpool_tcache_pools);
+unlock:
+	pthread_mutex_unlock(&ofi_bufpool_tcache_lock);
+	return ret;
+}
+
+/*
+ * Caches belonging to other threads are freed here.  Their slots keep the
+ * old pool id, which is never reused, so they are never dereferenced again.
+ */
+static void ofi_bufpool_tcache_cleanup(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_tcache *cache;
+	struct ofi_bufpool_tslot *slot;
+	struct dlist_entry *tmp;
+
+	/* Drop the key with the last pool, so it never outlives the library */
+	pthread_mutex_lock(&ofi_bufpool_tcache_lock);
+	dlist_remove(&pool->entry);
+	if (dlist_empty(&ofi_bufpool_tcache_pools))
+		(void) pthread_key_delete(ofi_bufpool_tcache_key);
+	pthread_mutex_unlock(&ofi_bufpool_tcache_lock);
+
+	dlist_foreach_container_safe(&pool->tcache_list,
+				     struct ofi_bufpool_tcache, cache,
+				     pool_entry, tmp) {
+		dlist_remove(&cache->pool_entry);
+		free(cache);
+	}
+
+	slot = &ofi_bufpool_tslots[pool->id % OFI_BUFPOOL_TCACHE_SLOTS];
+	if (slot->pool_id == pool->id) {
+		slot->pool_id = 0;
+		slot->cache = NULL;
+	}
+	pthread_mutex_destroy(&pool->lock);
+}
+
 int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 			      struct ofi_bufpool **buf_pool)
 {
 	struct ofi_bufpool *pool;
 	size_t entry_sz;
+	int ret;
+
+	if ((attr->flags & OFI_BUFPOOL_THREAD_CACHE) &&
+	    (attr->flags & OFI_BUFPOOL_INDEXED))
+		return -FI_EINVAL;
 
 	pool = calloc(1, sizeof(**buf_pool));
 	if (!pool)
@@ -239,6 +484,15 @@ int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 
 	pool->alloc_size = (pool->attr.chunk_cnt + 1) * pool->entry_size;
 	pool->region_size = pool->alloc_size - pool->entry_size;
+	pool->hugepage_limit = SIZE_MAX;
+
+	if (pool->attr.flags & OFI_BUFPOOL_THREAD_CACHE) {
+		ret = ofi_bufpool_tcache_init(pool);
+		if (ret) {
+			free(pool);
+			return ret;
+		}
+	}
 
 	*buf_pool = pool;
 	return FI_SUCCESS;
@@ -249,6 +503,15 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool)
 	struct ofi_bufpool_region *buf_region;
 	size_t i;
 
+	FI_DBG(&core_prov, FI_LOG_CORE, "pool %p size %zu: regions %zu "
+	       "entries %zu hugepage regions %zu misses %zu\n",
+	       (void *) pool, pool->attr.size, pool->stats.region_cnt,
+	       pool->stats.entry_cnt, pool->stats.hugepage_cnt,
+	       pool->stats.hugepage_miss);
+
+	if (pool->attr.flags & OFI_BUFPOOL_THREAD_CACHE)
+		ofi_bufpool_tcache_cleanup(pool);
+
 	for (i = 0; i < pool->region_cnt; i++) {
 		buf_region = pool->region_table[i];
 
@@ -264,6 +527,16 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool)
 	free(pool);
 }
 
+void ofi_bufpool_get_stats(struct ofi_bufpool *pool,
+			   struct ofi_bufpool_stats *stats)
+{
+	if (pool->attr.flags & OFI_BUFPOOL_THREAD_CACHE)
+		pthread_mutex_lock(&pool->lock);
+	*stats = pool->stats;
+	if (pool->attr.flags & OFI_BUFPOOL_THREAD_CACHE)
+		pthread_mutex_unlock(&pool->lock);
+}
+
 int ofi_ibuf_is_lower(struct dlist_entry *item, const void *arg)
 {
 	struct ofi_bufpool_hdr *hdr1, *hdr2;
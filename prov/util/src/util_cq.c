@@ -46,6 +46,13 @@ static void util_cq_insert_aux(struct util_cq *cq,
 			      struct util_cq_aux_entry *entry)
 {
 	assert(ofi_genlock_held(&cq->cq_lock));
+	if (cq->ring) {
+		entry->cq_slot = NULL;
+		slist_insert_tail(&entry->list_entry, &cq->aux_queue);
+		ofi_atomic_inc32(&cq->aux_cnt);
+		return;
+	}
+
 	if (!ofi_cirque_isfull(cq->cirq))
 		ofi_cirque_commit(cq->cirq);
 
@@ -62,7 +69,7 @@ int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 
 	assert(ofi_genlock_held(&cq->cq_lock));
 	FI_DBG(cq->domain->prov, FI_LOG_CQ, "writing to CQ overflow list\n");
-	assert(ofi_cirque_freecnt(cq->cirq) <= 1);
+	assert(cq->ring || ofi_cirque_freecnt(cq->cirq) <= 1);
 
 	entry = calloc(1, sizeof(*entry));
 	if (!entry)
@@ -81,6 +88,34 @@ int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 	return 0;
 }
 
+int ofi_cq_write_ring(struct util_cq *cq, void *context, uint64_t flags,
+		      size_t len, void *buf, uint64_t data, uint64_t tag,
+		      fi_addr_t src)
+{
+	struct util_cq_comp *entry;
+	int64_t pos;
+	int ret;
+
+	if (!ofi_atomic_get32(&cq->aux_cnt) &&
+	    !util_comp_ring_next(cq->ring, &entry, &pos)) {
+		entry->comp.op_context = context;
+		entry->comp.flags = flags;
+		entry->comp.len = len;
+		entry->comp.buf = buf;
+		entry->comp.data = data;
+		entry->comp.tag = tag;
+		entry->src = src;
+		util_comp_ring_commit(entry, pos);
+		return 0;
+	}
+
+	ofi_genlock_lock(&cq->cq_lock);
+	ret = ofi_cq_write_overflow(cq, context, flags, len, buf, data, tag,
+				    src);
+	ofi_genlock_unlock(&cq->cq_lock);
+	return ret;
+}
+
 static int util_cq_insert_error(struct util_cq *cq,
 				const struct fi_cq_err_entry *err_entry)
 {
@@ -215,7 +250,7 @@ int ofi_check_cq_attr(const struct fi_provider *prov,
 		return -FI_EINVAL;
 	}
 
-	if (attr->flags & ~(FI_AFFINITY | FI_PEER)) {
+	if (attr->flags & ~(FI_AFFINITY | FI_PEER | OFI_CQ_DIRECT)) {
 		FI_WARN(prov, FI_LOG_CQ, "invalid flags\n");
 		return -FI_EINVAL;
 	}
@@ -247,6 +282,77 @@ static void util_cq_read_tagged(void **dst, void *src)
 	*(char **)dst += sizeof(struct fi_cq_tagged_entry);
 }
 
+static ssize_t util_cq_read_aux(struct util_cq *cq, void **buf, size_t count,
+				fi_addr_t *src_addr)
+{
+	struct util_cq_aux_entry *aux_entry;
+	ssize_t i;
+
+	assert(ofi_genlock_held(&cq->cq_lock));
+	for (i = 0; i < (ssize_t) count && !slist_empty(&cq->aux_queue); i++) {
+		aux_entry = container_of(cq->aux_queue.head,
+					 struct util_cq_aux_entry, list_entry);
+		if (aux_entry->comp.err) {
+			if (!i)
+				i = -FI_EAVAIL;
+			break;
+		}
+
+		if (src_addr)
+			src_addr[i] = aux_entry->src;
+		cq->read_entry(buf, &aux_entry->comp);
+		slist_remove_head(&cq->aux_queue);
+		free(aux_entry);
+		ofi_atomic_dec32(&cq->aux_cnt);
+	}
+	return i;
+}
+
+ssize_t ofi_cq_read_ring(struct util_cq *cq, void *buf, size_t count,
+			 fi_addr_t *src_addr)
+{
+	struct util_cq_comp *entry;
+	int64_t pos;
+	ssize_t i = 0, ret;
+	int cnt, j;
+
+	if (!(cq->domain->info_domain_caps & FI_SOURCE))
+		src_addr = NULL;
+
+	while (i < (ssize_t) count) {
+		cnt = util_comp_ring_head_n(cq->ring,
+					    (int) MIN(count - i,
+						      cq->ring->size), &pos);
+		if (cnt < 0)
+			break;
+
+		for (j = 0; j < cnt; j++, i++) {
+			entry = util_comp_ring_buf(cq->ring, pos + j);
+			if (src_addr)
+				src_addr[i] = entry->src;
+			cq->read_entry(&buf, &entry->comp);
+		}
+		util_comp_ring_release_n(cq->ring, pos, cnt);
+	}
+
+	/* Writers only use the aux queue while it is not empty, so
+	 * anything in the ring was written before it.
+	 */
+	if (i < (ssize_t) count && ofi_atomic_get32(&cq->aux_cnt)) {
+		ofi_genlock_lock(&cq->cq_lock);
+		ret = util_cq_read_aux(cq, &buf, count - i,
+				       src_addr ? src_addr + i : NULL);
+		ofi_genlock_unlock(&cq->cq_lock);
+		if (ret < 0)
+			return i ? i : ret;
+		i += ret;
+	}
+
+	if (!i)
+		return (count || ofi_cq_isempty(cq)) ? -FI_EAGAIN : 0;
+	return i;
+}
+
 ssize_t ofi_cq_readfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 			fi_addr_t *src_addr)
 {
@@ -278,8 +384,13 @@ ssize_t ofi_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *buf,
 	api_version = cq->domain->fabric->fabric_fid.api_version;
 
 	ofi_genlock_lock(&cq->cq_lock);
-	if (ofi_cirque_isempty(cq->cirq) ||
-	    !(ofi_cirque_head(cq->cirq)->flags & UTIL_FLAG_AUX)) {
+	if (cq->ring) {
+		if (slist_empty(&cq->aux_queue)) {
+			ret = -FI_EAGAIN;
+			goto unlock;
+		}
+	} else if (ofi_cirque_isempty(cq->cirq) ||
+		   !(ofi_cirque_head(cq->cirq)->flags & UTIL_FLAG_AUX)) {
 		ret = -FI_EAGAIN;
 		goto unlock;
 	}
@@ -287,7 +398,7 @@ ssize_t ofi_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *buf,
 	assert(!slist_empty(&cq->aux_queue));
 	aux_entry = container_of(cq->aux_queue.head,
 				 struct util_cq_aux_entry, list_entry);
-	assert(aux_entry->cq_slot == ofi_cirque_head(cq->cirq));
+	assert(cq->ring || aux_entry->cq_slot == ofi_cirque_head(cq->cirq));
 
 	if (!aux_entry->comp.err) {
 		ret = -FI_EAGAIN;
@@ -311,7 +422,9 @@ ssize_t ofi_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *buf,
 
 	slist_remove_head(&cq->aux_queue);
 	free(aux_entry);
-	if (slist_empty(&cq->aux_queue)) {
+	if (cq->ring) {
+		ofi_atomic_dec32(&cq->aux_cnt);
+	} else if (slist_empty(&cq->aux_queue)) {
 		ofi_cirque_discard(cq->cirq);
 	} else {
 		aux_entry = container_of(cq->aux_queue.head,
@@ -400,7 +513,10 @@ static void util_peer_cq_cleanup(struct util_cq *cq)
 		free(err);
 	}
 
-	util_comp_cirq_free(cq->cirq);
+	if (cq->ring)
+		util_comp_ring_free(cq->ring);
+	else
+		util_comp_cirq_free(cq->cirq);
 	free(cq->src);
 	fi_close(&cq->peer_cq->fid);
 }
@@ -508,18 +624,7 @@ static ssize_t util_peer_cq_write(struct fid_peer_cq *cq, void *context,
 	struct util_cq *util_cq = cq->fid.context;
 	int ret;
 
-	util_cq = cq->fid.context;
-
-	ofi_genlock_lock(&util_cq->cq_lock);
-	if (ofi_cirque_freecnt(util_cq->cirq) > 1) {
-		ofi_cq_write_entry(util_cq, context, flags, len, buf, data,
-				     tag);
-		ret = 0;
-	} else {
-		ret = ofi_cq_write_overflow(util_cq, context, flags, len, buf,
-					      data, tag, FI_ADDR_NOTAVAIL);
-	}
-	ofi_genlock_unlock(&util_cq->cq_lock);
+	ret = ofi_cq_write(util_cq, context, flags, len, buf, data, tag);
 
 	if (util_cq->wait)
 		util_cq->wait->signal(util_cq->wait);
@@ -534,16 +639,8 @@ static ssize_t util_peer_cq_write_src(struct fid_peer_cq *cq, void *context,
 	struct util_cq *util_cq = cq->fid.context;
 	int ret;
 
-	ofi_genlock_lock(&util_cq->cq_lock);
-	if (ofi_cirque_freecnt(util_cq->cirq) > 1) {
-		ofi_cq_write_src_entry(util_cq, context, flags, len, buf, data,
-				       tag, src);
-		ret = 0;
-	} else {
-		ret = ofi_cq_write_overflow(util_cq, context, flags, len, buf,
-					      data, tag, src);
-	}
-	ofi_genlock_unlock(&util_cq->cq_lock);
+	ret = ofi_cq_write_src(util_cq, context, flags, len, buf, data, tag,
+			       src);
 
 	if (util_cq->wait)
 		util_cq->wait->signal(util_cq->wait);
@@ -618,6 +715,7 @@ static struct fi_ops util_peer_cq_fi_ops = {
 
 static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 {
+	size_t size;
 	int ret;
 
 	cq->peer_cq = calloc(1, sizeof(*cq->peer_cq));
@@ -646,7 +744,25 @@ static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 		goto free;
 	}
 
-	cq->cirq = util_comp_cirq_create(attr->size == 0 ? UTIL_DEF_CQ_SIZE : attr->size);
+	size = attr->size == 0 ? UTIL_DEF_CQ_SIZE : attr->size;
+	ofi_atomic_initialize32(&cq->aux_cnt, 0);
+
+	/* The ring only pays off when the CQ is shared between threads */
+	if (ofi_cq_lockless && !(attr->flags & OFI_CQ_DIRECT) &&
+	    cq->cq_lock.lock_type != OFI_LOCK_NOOP) {
+		cq->ring = util_comp_ring_create(size);
+		if (!cq->ring) {
+			ret = -FI_ENOMEM;
+			goto free;
+		}
+		cq->peer_cq->owner_ops = (cq->domain->info_domain_caps &
+					  FI_SOURCE) ?
+					 &util_peer_cq_src_owner_ops :
+					 &util_peer_cq_owner_ops;
+		goto out;
+	}
+
+	cq->cirq = util_comp_cirq_create(size);
 	if (!cq->cirq) {
 		ret = -FI_ENOMEM;
 		goto free;
@@ -664,6 +780,7 @@ static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 		cq->peer_cq->owner_ops = &util_peer_cq_owner_ops;
 	}
 
+out:
 	cq->peer_cq->fid.fclass = FI_CLASS_PEER_CQ;
 	cq->peer_cq->fid.context = cq;
 	cq->peer_cq->fid.ops = &util_peer_cq_fi_ops;
@@ -710,7 +827,7 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 	if (ret)
 		goto destroy1;
 
-	cq->flags = attr->flags;
+	cq->flags = attr->flags & ~OFI_CQ_DIRECT;
 	cq->cq_fid.fid.fclass = FI_CLASS_CQ;
 	cq->cq_fid.fid.context = context;
 
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sched.h>
+
+#include <ofi_util.h>
+#include <ofi_doorbell.h>
+
+/*
+ * With more than one endpoint only the first doorbell is watched, so the
+ * sleep is cut into short naps.
+ */
+#define OFI_DOORBELL_MAX_EPS	16
+#define OFI_DOORBELL_NAP_MS	1
+
+struct ofi_doorbell_sleep {
+	struct ofi_doorbell	*bells[OFI_DOORBELL_MAX_EPS];
+	int			cnt;
+	int32_t			ring;
+};
+
+void ofi_doorbell_drain(struct ofi_doorbell *bell)
+{
+	while (ofi_atomic_get32(&bell->sleepers)) {
+		ofi_doorbell_ring(bell);
+		sched_yield();
+	}
+}
+
+bool ofi_doorbell_ep_sleeps(struct util_ep *ep, const struct fi_ops_cq *cq_ops,
+			    const struct fi_ops_cntr *cntr_ops)
+{
+	int i;
+
+	if ((ep->tx_cq && ep->tx_cq->cq_fid.ops == cq_ops) ||
+	    (ep->rx_cq && ep->rx_cq->cq_fid.ops == cq_ops))
+		return true;
+
+	for (i = 0; i < CNTR_CNT; i++) {
+		if (ep->cntrs[i] && ep->cntrs[i]->cntr_fid.ops == cntr_ops)
+			return true;
+	}
+	return false;
+}
+
+static uint64_t ofi_doorbell_spin_end(int spin_us)
+{
+	return spin_us < 0 ? UINT64_MAX : ofi_gettime_us() + spin_us;
+}
+
+/*
+ * Announce a sleeper on every endpoint in the list.  The caller must check
+ * for completions after arming and before sleeping, so that work posted
+ * in between is not missed.  Fails if an endpoint needs polling.
+ */
+static int ofi_doorbell_arm(struct ofi_doorbell_sleep *sleep,
+			    struct dlist_entry *ep_list,
+			    ofi_mutex_t *ep_list_lock,
+			    ofi_doorbell_func get_bell)
+{
+	struct fid_list_entry *item;
+	struct ofi_doorbell *bell;
+	bool busy;
+	int i;
+
+	sleep->cnt = 0;
+	ofi_mutex_lock(ep_list_lock);
+	dlist_foreach_container(ep_list, struct fid_list_entry, item, entry) {
+		busy = false;
+		bell = get_bell(item->fid, &busy);
+		if (sleep->cnt == OFI_DOORBELL_MAX_EPS || busy)
+			goto busy;
+		sleep->bells[sleep->cnt++] = bell;
+	}
+	if (!sleep->cnt)
+		goto busy;
+
+	for (i = 0; i < sleep->cnt; i++)
+		ofi_atomic_inc32(&sleep->bells[i]->sleepers);
+	ofi_mutex_unlock(ep_list_lock);
+
+	ofi_mb();
+	sleep->ring = ofi_atomic_get32(&sleep->bells[0]->ring);
+	return 0;
+
+busy:
+	ofi_mutex_unlock(ep_list_lock);
+	sleep->cnt = 0;
+	return -FI_EAGAIN;
+}
+
+static void ofi_doorbell_disarm(struct ofi_doorbell_sleep *sleep)
+{
+	int i;
+
+	for (i = 0; i < sleep->cnt; i++)
+		ofi_atomic_dec32(&sleep->bells[i]->sleepers);
+	sleep->cnt = 0;
+}
+
+/*
+ * Completions that other local threads write outside of the send and
+ * progress paths, e.g. for fi_cancel, do not ring the doorbell.  Bound
+ * the sleep so that they are noticed regardless.
+ */
+static void ofi_doorbell_sleep(struct ofi_doorbell_sleep *sleep, int timeout)
+{
+	int max_timeout;
+
+	max_timeout = sleep->cnt > 1 ? OFI_DOORBELL_NAP_MS :
+		      OFI_TIMEOUT_QUANTUM_MS;
+	timeout = timeout < 0 ? max_timeout : MIN(timeout, max_timeout);
+
+	if (ofi_futex_wait((int32_t *) &sleep->bells[0]->ring,
+			   sleep->ring, timeout) == -FI_ENOSYS)
+		sched_yield();
+
+	ofi_doorbell_disarm(sleep);
+}
+
+ssize_t ofi_doorbell_cq_sreadfrom(struct fid_cq *cq_fid, void *buf,
+				  size_t count, fi_addr_t *src_addr,
+				  int timeout, int spin_us,
+				  ofi_doorbell_func get_bell)
+{
+	struct util_cq *cq;
+	struct ofi_doorbell_sleep sleep = { .cnt = 0 };
+	uint64_t endtime, spin_end;
+	ssize_t ret;
+
+	cq = container_of(cq_fid, struct util_cq, cq_fid);
+	endtime = ofi_timeout_time(timeout);
+	spin_end = ofi_doorbell_spin_end(spin_us);
+
+	do {
+		if (ofi_gettime_us() >= spin_end)
+			(void) ofi_doorbell_arm(&sleep, &cq->ep_list,
+						&cq->ep_list_lock, get_bell);
+
+		ret = fi_cq_readfrom(cq_fid, buf, count, src_addr);
+		if (ret != -FI_EAGAIN)
+			break;
+
+		if (ofi_adjust_timeout(endtime, &timeout))
+			break;
+
+		if (ofi_atomic_get32(&cq->wakeup)) {
+			ofi_atomic_set32(&cq->wakeup, 0);
+			break;
+		}
+
+		if (sleep.cnt)
+			ofi_doorbell_sleep(&sleep, timeout);
+		else if (ofi_gettime_us() >= spin_end)
+			sched_yield();
+	} while (1);
+
+	ofi_doorbell_disarm(&sleep);
+	return ret;
+}
+
+int ofi_doorbell_cq_signal(struct fid_cq *cq_fid, ofi_doorbell_func get_bell)
+{
+	struct util_cq *cq = container_of(cq_fid, struct util_cq, cq_fid);
+	struct fid_list_entry *item;
+	bool busy;
+
+	ofi_atomic_set32(&cq->wakeup, 1);
+
+	ofi_mutex_lock(&cq->ep_list_lock);
+	dlist_foreach_container(&cq->ep_list, struct fid_list_entry,
+				item, entry)
+		ofi_doorbell_ring(get_bell(item->fid, &busy));
+	ofi_mutex_unlock(&cq->ep_list_lock);
+	return 0;
+}
+
+int ofi_doorbell_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold,
+			   int timeout, int spin_us,
+			   ofi_doorbell_func get_bell)
+{
+	struct util_cntr *cntr;
+	struct ofi_doorbell_sleep sleep = { .cnt = 0 };
+	uint64_t endtime, spin_end, errcnt;
+	int ret;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	errcnt = ofi_atomic_get64(&cntr->err);
+	endtime = ofi_timeout_time(timeout);
+	spin_end = ofi_doorbell_spin_end(spin_us);
+
+	do {
+		if (ofi_gettime_us() >= spin_end)
+			(void) ofi_doorbell_arm(&sleep, &cntr->ep_list,
+						&cntr->ep_list_lock, get_bell);
+
+		cntr->progress(cntr);
+		if (threshold <= (uint64_t) ofi_atomic_get64(&cntr->cnt)) {
+			ret = FI_SUCCESS;
+			break;
+		}
+
+		if (errcnt != (uint64_t) ofi_atomic_get64(&cntr->err)) {
+			ret = -FI_EAVAIL;
+			break;
+		}
+
+		if (ofi_adjust_timeout(endtime, &timeout)) {
+			ret = -FI_ETIMEDOUT;
+			break;
+		}
+
+		if (sleep.cnt)
+			ofi_doorbell_sleep(&sleep, timeout);
+		else if (ofi_gettime_us() >= spin_end)
+			sched_yield();
+	} while (1);
+
+	ofi_doorbell_disarm(&sleep);
+	return ret;
+}
@@ -200,6 +200,29 @@ void ofi_monitors_init(void)
 			" and free calls.  Userfaultfd is the default if"
 			" available on the system. 'disabled' option disables"
 			" memory caching.");
+	fi_param_define(NULL, "mr_cache_merge_regions", FI_PARAM_BOOL,
+			"If enabled, a new host memory region is merged with"
+			" every cached region that overlaps or is adjacent"
+			" to it, so they are covered by a single"
+			" registration.  (default: false)");
+	fi_param_define(NULL, "mr_cache_reclaim", FI_PARAM_BOOL,
+			"If enabled, each MR cache starts a thread that"
+			" deregisters idle regions in the background once"
+			" the cache grows past its low watermark, instead of"
+			" evicting them when a registration finds the cache"
+			" full.  (default: false)");
+	fi_param_define(NULL, "mr_cache_low_watermark", FI_PARAM_SIZE_T,
+			"Percentage of the MR cache count and size limits"
+			" that the reclaim thread keeps the cache below."
+			" (default: 80)");
+	fi_param_define(NULL, "mr_cache_stats_file", FI_PARAM_STRING,
+			"If set, each MR cache writes its statistics to"
+			" <path>.<pid>.<cache id> periodically and when it is"
+			" closed.  (default: none)");
+	fi_param_define(NULL, "mr_cache_stats_interval", FI_PARAM_SIZE_T,
+			"Interval in seconds between writes of the MR cache"
+			" statistics file.  Setting this to zero only writes"
+			" the file when the cache is closed.  (default: 10)");
 	fi_param_define(NULL, "mr_cuda_cache_monitor_enabled", FI_PARAM_BOOL,
 			"Enable or disable the CUDA cache memory monitor."
 			"Enabled by default.");
@@ -213,6 +236,15 @@ void ofi_monitors_init(void)
 	fi_param_get_size_t(NULL, "mr_cache_max_size", &cache_params.max_size);
 	fi_param_get_size_t(NULL, "mr_cache_max_count", &cache_params.max_cnt);
 	fi_param_get_str(NULL, "mr_cache_monitor", &cache_params.monitor);
+	fi_param_get_bool(NULL, "mr_cache_merge_regions",
+			  &cache_params.merge_regions);
+	fi_param_get_bool(NULL, "mr_cache_reclaim", &cache_params.reclaim);
+	fi_param_get_size_t(NULL, "mr_cache_low_watermark",
+			    &cache_params.low_watermark);
+	fi_param_get_str(NULL, "mr_cache_stats_file",
+			 &cache_params.stats_file);
+	fi_param_get_size_t(NULL, "mr_cache_stats_interval",
+			    &cache_params.stats_interval);
 	fi_param_get_bool(NULL, "mr_cuda_cache_monitor_enabled",
 			  &cache_params.cuda_monitor_enabled);
 	fi_param_get_bool(NULL, "mr_rocr_cache_monitor_enabled",
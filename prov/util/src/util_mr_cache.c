@@ -49,8 +49,16 @@ struct ofi_mr_cache_params cache_params = {
 	.cuda_monitor_enabled = true,
 	.rocr_monitor_enabled = true,
 	.ze_monitor_enabled = true,
+	.low_watermark = 80,
+	.stats_interval = 10,
 };
 
+OFI_THREAD_LOCAL struct ofi_mr_cache_tslot
+	ofi_mr_cache_tslots[OFI_MR_CACHE_TSLOTS];
+
+/* Protected by mm_lock, starts at 1 so an unused slot never matches */
+static uint64_t ofi_mr_cache_next_id;
+
 static int util_mr_find_within(struct ofi_rbmap *map, void *key, void *data)
 {
 	struct ofi_mr_entry *entry = data;
@@ -87,6 +95,27 @@ static int util_mr_find_overlap(struct ofi_rbmap *map, void *key, void *data)
 	return 0;
 }
 
+/* Matches regions that overlap or directly abut the key */
+static int util_mr_find_adjacent(struct ofi_rbmap *map, void *key, void *data)
+{
+	struct ofi_mr_entry *entry = data;
+	struct ofi_mr_info *info = key;
+
+	if (info->peer_id < entry->info.peer_id)
+		return -1;
+	if (info->peer_id > entry->info.peer_id)
+		return 1;
+
+	if ((uintptr_t) info->iov.iov_base + info->iov.iov_len <
+	    (uintptr_t) entry->info.iov.iov_base)
+		return -1;
+	if ((uintptr_t) info->iov.iov_base >
+	    (uintptr_t) entry->info.iov.iov_base + entry->info.iov.iov_len)
+		return 1;
+
+	return 0;
+}
+
 static struct ofi_mr_entry *util_mr_entry_alloc(struct ofi_mr_cache *cache)
 {
 	struct ofi_mr_entry *entry;
@@ -105,6 +134,64 @@ static void util_mr_entry_free(struct ofi_mr_cache *cache,
 	pthread_mutex_unlock(&cache->lock);
 }
 
+static int util_mr_lru_class(size_t len)
+{
+	int i;
+
+	for (i = 0; i < OFI_MR_CACHE_LRU_CLASSES - 1; i++) {
+		if (len <= ((size_t) OFI_MR_CACHE_LRU_MIN << (4 * i)))
+			break;
+	}
+	return i;
+}
+
+static void util_mr_lru_insert(struct ofi_mr_cache *cache,
+			       struct ofi_mr_entry *entry)
+{
+	entry->lru_seq = ++cache->lru_seq;
+	dlist_insert_tail(&entry->list_entry,
+			  &cache->lru_list[util_mr_lru_class(entry->info.iov.iov_len)]);
+}
+
+static bool util_mr_lru_empty(struct ofi_mr_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < OFI_MR_CACHE_LRU_CLASSES; i++) {
+		if (!dlist_empty(&cache->lru_list[i]))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Select the idle entry to evict.  The oldest entry of each size class is a
+ * candidate, and its idle time is halved for every class above the first.
+ * A large region must therefore stay idle longer than a small one before
+ * it is evicted, since re-registering it pins more pages.  Ties go to the
+ * smaller region.
+ */
+static struct ofi_mr_entry *util_mr_lru_victim(struct ofi_mr_cache *cache)
+{
+	struct ofi_mr_entry *entry, *victim = NULL;
+	uint64_t age, victim_age = 0;
+	int i;
+
+	for (i = 0; i < OFI_MR_CACHE_LRU_CLASSES; i++) {
+		if (dlist_empty(&cache->lru_list[i]))
+			continue;
+
+		entry = container_of(cache->lru_list[i].next,
+				     struct ofi_mr_entry, list_entry);
+		age = (cache->lru_seq - entry->lru_seq) >> i;
+		if (!victim || age > victim_age) {
+			victim = entry;
+			victim_age = age;
+		}
+	}
+	return victim;
+}
+
 /* We cannot hold the monitor lock when freeing an entry.  This call
  * will result in freeing memory, which can generate a uffd event
  * (e.g. UNMAP).  If we hold the monitor lock, the uffd thread will
@@ -133,17 +220,74 @@ static void util_mr_uncache_entry_storage(struct ofi_mr_cache *cache,
 
 	ofi_rbmap_delete(&cache->tree, entry->node);
 	entry->node = NULL;
+	ofi_atomic_inc64(&cache->gen);
 
 	cache->cached_cnt--;
 	cache->cached_size -= entry->info.iov.iov_len;
 }
 
+static bool util_mr_cache_above_low(struct ofi_mr_cache *cache)
+{
+	return (cache->cached_cnt > cache->low_cnt) ||
+	       (cache->cached_size > cache->low_size);
+}
+
+/* Caller must hold mm_lock */
+static bool util_mr_cache_need_reclaim(struct ofi_mr_cache *cache)
+{
+	return !dlist_empty(&cache->dead_region_list) ||
+	       (util_mr_cache_above_low(cache) && !util_mr_lru_empty(cache));
+}
+
+/* Caller must hold mm_lock */
+static void util_mr_cache_kick(struct ofi_mr_cache *cache)
+{
+	if (cache->reclaim && util_mr_cache_need_reclaim(cache))
+		pthread_cond_signal(&cache->thread_cond);
+}
+
+/* Caller must hold mm_lock */
+static void util_mr_cache_record(size_t *hist, uint64_t start)
+{
+	hist[MIN(ofi_msb(ofi_gettime_ns() - start),
+		 FI_MR_CACHE_HIST_SIZE - 1)]++;
+}
+
+/* Move an idle entry out of the cache.  Caller must hold mm_lock. */
+static void util_mr_cache_evict(struct ofi_mr_cache *cache,
+				struct ofi_mr_entry *entry,
+				struct dlist_entry *free_list, int reason)
+{
+	dlist_remove(&entry->list_entry);
+	util_mr_uncache_entry_storage(cache, entry);
+	dlist_insert_tail(&entry->list_entry, free_list);
+
+	cache->evict[reason]++;
+	cache->evict_cnt++;
+	cache->evict_size += entry->info.iov.iov_len;
+}
+
+static void util_mr_free_list(struct ofi_mr_cache *cache,
+			      struct dlist_entry *free_list)
+{
+	struct ofi_mr_entry *entry;
+
+	while (!dlist_empty(free_list)) {
+		dlist_pop_front(free_list, struct ofi_mr_entry,
+				entry, list_entry);
+		FI_DBG(cache->prov, FI_LOG_MR, "flush %p (len: %zu)\n",
+			entry->info.iov.iov_base, entry->info.iov.iov_len);
+		util_mr_free_entry(cache, entry);
+	}
+}
+
 static void util_mr_uncache_entry(struct ofi_mr_cache *cache,
-				  struct ofi_mr_entry *entry)
+				  struct ofi_mr_entry *entry, int reason)
 {
 	util_mr_uncache_entry_storage(cache, entry);
+	cache->evict[reason]++;
 
-	if (entry->use_cnt == 0) {
+	if (ofi_atomic_get32(&entry->use_cnt) == 0) {
 		dlist_remove(&entry->list_entry);
 		dlist_insert_tail(&entry->list_entry, &cache->dead_region_list);
 	} else {
@@ -180,6 +324,103 @@ static struct ofi_mr_entry *ofi_mr_rbt_overlap(struct ofi_rbmap *tree,
 	return node->data;
 }
 
+static struct ofi_mr_entry *ofi_mr_rbt_adjacent(struct ofi_rbmap *tree,
+						const struct ofi_mr_info *key)
+{
+	struct ofi_rbnode *node;
+
+	node = ofi_rbmap_search(tree, (void *) key, util_mr_find_adjacent);
+	if (!node)
+		return NULL;
+
+	return node->data;
+}
+
+/* Caller must hold mm_lock.  Only cached entries are remembered. */
+static void util_mr_cache_remember(struct ofi_mr_cache *cache,
+				   struct ofi_mr_entry *entry)
+{
+	struct ofi_mr_cache_tslot *slot;
+
+	slot = &ofi_mr_cache_tslots[cache->id % OFI_MR_CACHE_TSLOTS];
+	if (slot->cache_id != cache->id) {
+		slot->cache_id = cache->id;
+		slot->hits = 0;
+		slot->deletes = 0;
+	}
+	slot->gen = ofi_atomic_get64(&cache->gen);
+	slot->entry = entry;
+}
+
+/*
+ * Fast path hits and lockless deletes are counted per thread and added to
+ * the cache the next time the thread searches it or reads its stats under
+ * mm_lock.  Counts of a slot that is taken over by another cache are
+ * dropped.
+ */
+static void util_mr_cache_add_fast_cnts(struct ofi_mr_cache *cache)
+{
+	struct ofi_mr_cache_tslot *slot;
+
+	slot = &ofi_mr_cache_tslots[cache->id % OFI_MR_CACHE_TSLOTS];
+	if (slot->cache_id == cache->id) {
+		cache->fast_hit_cnt += slot->hits;
+		cache->delete_cnt += slot->deletes;
+		slot->hits = 0;
+		slot->deletes = 0;
+	}
+}
+
+/*
+ * Take another reference on the entry this thread last hit, without
+ * acquiring mm_lock.  This only succeeds if the entry is still in use by
+ * someone, since an idle entry sits on the LRU list and must be removed
+ * from it under the lock.  The generation is checked again once the
+ * reference is held: if the entry left the tree in the meantime, the
+ * reference is dropped and the caller falls back to the locked search.
+ */
+static bool util_mr_cache_fast_hit(struct ofi_mr_cache *cache,
+				   struct ofi_mem_monitor *monitor,
+				   const struct ofi_mr_info *info,
+				   struct ofi_mr_entry **entry)
+{
+	struct ofi_mr_cache_tslot *slot;
+	struct ofi_mr_entry *cur;
+	uint64_t gen;
+	int32_t cnt;
+
+	slot = &ofi_mr_cache_tslots[cache->id % OFI_MR_CACHE_TSLOTS];
+	if (slot->cache_id != cache->id)
+		return false;
+
+	gen = ofi_atomic_get64(&cache->gen);
+	if (slot->gen != gen)
+		return false;
+
+	cur = slot->entry;
+	if (cur->info.peer_id != info->peer_id ||
+	    cur->info.iface != info->iface ||
+	    !ofi_iov_within(&info->iov, &cur->info.iov) ||
+	    !monitor->valid(monitor, info, cur))
+		return false;
+
+	cnt = ofi_atomic_get32(&cur->use_cnt);
+	do {
+		if (cnt <= 0)
+			return false;
+	} while (!ofi_atomic_compare_exchange_weak32(&cur->use_cnt, &cnt,
+						     cnt + 1));
+
+	if (ofi_atomic_get64(&cache->gen) != gen) {
+		ofi_mr_cache_delete(cache, cur);
+		return false;
+	}
+
+	slot->hits++;
+	*entry = cur;
+	return true;
+}
+
 /* Caller must hold ofi_mem_monitor lock as well as unsubscribe from the region */
 void ofi_mr_cache_notify(struct ofi_mr_cache *cache, const void *addr, size_t len)
 {
@@ -192,7 +433,9 @@ void ofi_mr_cache_notify(struct ofi_mr_cache *cache, const void *addr, size_t le
 
 	for (entry = ofi_mr_rbt_overlap(&cache->tree, &iov); entry;
 	     entry = ofi_mr_rbt_overlap(&cache->tree, &iov))
-		util_mr_uncache_entry(cache, entry);
+		util_mr_uncache_entry(cache, entry, FI_MR_CACHE_EVICT_NOTIFY);
+
+	util_mr_cache_kick(cache);
 }
 
 /* Function to remove dead regions and prune MR cache size.
@@ -210,40 +453,229 @@ bool ofi_mr_cache_flush(struct ofi_mr_cache *cache, bool flush_lru)
 
 	dlist_splice_tail(&free_list, &cache->dead_region_list);
 
-	while (flush_lru && !dlist_empty(&cache->lru_list)) {
-		dlist_pop_front(&cache->lru_list, struct ofi_mr_entry,
-				entry, list_entry);
-		dlist_init(&entry->list_entry);
-		util_mr_uncache_entry_storage(cache, entry);
-		dlist_insert_tail(&entry->list_entry, &free_list);
-
+	while (flush_lru && (entry = util_mr_lru_victim(cache))) {
+		util_mr_cache_evict(cache, entry, &free_list,
+				    FI_MR_CACHE_EVICT_FLUSH);
 		flush_lru = ofi_mr_cache_full(cache);
 	}
 
 	pthread_mutex_unlock(&mm_lock);
 
 	entries_freed = !dlist_empty(&free_list);
+	util_mr_free_list(cache, &free_list);
 
-	while(!dlist_empty(&free_list)) {
-		dlist_pop_front(&free_list, struct ofi_mr_entry,
-				entry, list_entry);
-		FI_DBG(cache->prov, FI_LOG_MR, "flush %p (len: %zu)\n",
-			entry->info.iov.iov_base, entry->info.iov.iov_len);
-		util_mr_free_entry(cache, entry);
+	return entries_freed;
+}
+
+static void util_mr_cache_read_stats(struct ofi_mr_cache *cache,
+				     struct fi_mr_cache_stats *stats)
+{
+	int i;
+
+	stats->size = sizeof(*stats);
+	pthread_mutex_lock(&mm_lock);
+	util_mr_cache_add_fast_cnts(cache);
+	stats->cached_cnt = cache->cached_cnt;
+	stats->cached_size = cache->cached_size;
+	stats->uncached_cnt = cache->uncached_cnt;
+	stats->uncached_size = cache->uncached_size;
+	stats->search_cnt = cache->search_cnt;
+	stats->hit_cnt = cache->hit_cnt;
+	stats->delete_cnt = cache->delete_cnt;
+	stats->notify_cnt = cache->notify_cnt;
+	stats->merge_cnt = cache->merge_cnt;
+	stats->evict_cnt = cache->evict_cnt;
+	stats->evict_size = cache->evict_size;
+	stats->reclaim_cnt = cache->reclaim_cnt;
+	stats->fast_hit_cnt = cache->fast_hit_cnt;
+	for (i = 0; i < FI_MR_CACHE_EVICT_MAX; i++)
+		stats->evict[i] = cache->evict[i];
+	for (i = 0; i < FI_MR_CACHE_HIST_SIZE; i++) {
+		stats->hit_nsec[i] = cache->hit_nsec[i];
+		stats->miss_nsec[i] = cache->miss_nsec[i];
 	}
+	pthread_mutex_unlock(&mm_lock);
+}
 
-	return entries_freed;
+static void util_mr_cache_write_stats(struct ofi_mr_cache *cache, FILE *file)
+{
+	struct fi_mr_cache_stats stats;
+	int i;
+
+	util_mr_cache_read_stats(cache, &stats);
+
+	fprintf(file, "provider %s\n", cache->prov->name);
+	fprintf(file, "cached_cnt %" PRIu64 "\n", stats.cached_cnt);
+	fprintf(file, "cached_size %" PRIu64 "\n", stats.cached_size);
+	fprintf(file, "uncached_cnt %" PRIu64 "\n", stats.uncached_cnt);
+	fprintf(file, "uncached_size %" PRIu64 "\n", stats.uncached_size);
+	fprintf(file, "search_cnt %" PRIu64 "\n", stats.search_cnt);
+	fprintf(file, "hit_cnt %" PRIu64 "\n", stats.hit_cnt);
+	fprintf(file, "fast_hit_cnt %" PRIu64 "\n", stats.fast_hit_cnt);
+	fprintf(file, "delete_cnt %" PRIu64 "\n", stats.delete_cnt);
+	fprintf(file, "notify_cnt %" PRIu64 "\n", stats.notify_cnt);
+	fprintf(file, "merge_cnt %" PRIu64 "\n", stats.merge_cnt);
+	fprintf(file, "evict_cnt %" PRIu64 "\n", stats.evict_cnt);
+	fprintf(file, "evict_size %" PRIu64 "\n", stats.evict_size);
+	fprintf(file, "reclaim_cnt %" PRIu64 "\n", stats.reclaim_cnt);
+	fprintf(file, "evict_flush %" PRIu64 "\n",
+		stats.evict[FI_MR_CACHE_EVICT_FLUSH]);
+	fprintf(file, "evict_reclaim %" PRIu64 "\n",
+		stats.evict[FI_MR_CACHE_EVICT_RECLAIM]);
+	fprintf(file, "evict_notify %" PRIu64 "\n",
+		stats.evict[FI_MR_CACHE_EVICT_NOTIFY]);
+	fprintf(file, "evict_invalid %" PRIu64 "\n",
+		stats.evict[FI_MR_CACHE_EVICT_INVALID]);
+	fprintf(file, "evict_overlap %" PRIu64 "\n",
+		stats.evict[FI_MR_CACHE_EVICT_OVERLAP]);
+	fprintf(file, "evict_merge %" PRIu64 "\n",
+		stats.evict[FI_MR_CACHE_EVICT_MERGE]);
+
+	fprintf(file, "hit_nsec");
+	for (i = 0; i < FI_MR_CACHE_HIST_SIZE; i++)
+		fprintf(file, " %" PRIu64, stats.hit_nsec[i]);
+	fprintf(file, "\nmiss_nsec");
+	for (i = 0; i < FI_MR_CACHE_HIST_SIZE; i++)
+		fprintf(file, " %" PRIu64, stats.miss_nsec[i]);
+	fprintf(file, "\n");
+}
+
+/*
+ * Write the cache stats to <FI_MR_CACHE_STATS_FILE>.<pid>.<cache id>.  The
+ * file is written under a temporary name and renamed, so readers never see
+ * a partial update.  Pointing the path at a tmpfs such as /dev/shm keeps
+ * the stats in memory.
+ */
+static void util_mr_cache_dump_stats(struct ofi_mr_cache *cache)
+{
+	char *path, *tmp;
+	size_t len;
+	FILE *file;
+
+	len = strlen(cache_params.stats_file) + 64;
+	path = malloc(len * 2);
+	if (!path)
+		return;
+	tmp = path + len;
+
+	snprintf(path, len, "%s.%d.%" PRIu64, cache_params.stats_file,
+		 getpid(), cache->id);
+	snprintf(tmp, len, "%s.%d.%" PRIu64 ".tmp", cache_params.stats_file,
+		 getpid(), cache->id);
+
+	file = fopen(tmp, "w");
+	if (!file) {
+		FI_WARN(cache->prov, FI_LOG_MR,
+			"unable to write MR cache stats to %s\n", tmp);
+		goto out;
+	}
+
+	util_mr_cache_write_stats(cache, file);
+	fclose(file);
+
+	if (rename(tmp, path)) {
+		FI_WARN(cache->prov, FI_LOG_MR,
+			"unable to write MR cache stats to %s\n", path);
+		remove(tmp);
+	}
+out:
+	free(path);
+}
+
+/* Caller must hold mm_lock */
+static int util_mr_cache_thread_timeout(struct ofi_mr_cache *cache)
+{
+	uint64_t now;
+
+	if (!cache->stats_time)
+		return -1;
+
+	now = ofi_gettime_ms();
+	return now >= cache->stats_time ? 0 : (int) (cache->stats_time - now);
+}
+
+/*
+ * The cache thread runs when background reclaim or periodic stats are
+ * enabled.  Reclaim keeps the cache below its low watermark, so that
+ * registrations do not have to deregister idle regions inline when the
+ * cache fills up.  Entries are removed from the cache in batches under
+ * mm_lock and deregistered after the lock is dropped.  Reclaim is only
+ * used if the provider sets delete_region_mt.
+ */
+static void *util_mr_cache_thread(void *arg)
+{
+	struct ofi_mr_cache *cache = arg;
+	struct ofi_mr_entry *entry;
+	struct dlist_entry free_list;
+	int cnt, timeout;
+
+	dlist_init(&free_list);
+
+	pthread_mutex_lock(&mm_lock);
+	while (!cache->thread_stop) {
+		timeout = util_mr_cache_thread_timeout(cache);
+		if (!timeout) {
+			cache->stats_time = ofi_gettime_ms() +
+					    cache_params.stats_interval * 1000;
+			pthread_mutex_unlock(&mm_lock);
+			util_mr_cache_dump_stats(cache);
+			pthread_mutex_lock(&mm_lock);
+			continue;
+		}
+
+		if (!cache->reclaim || !util_mr_cache_need_reclaim(cache)) {
+			ofi_wait_cond(&cache->thread_cond, &mm_lock, timeout);
+			continue;
+		}
+
+		cache->reclaim_cnt++;
+		dlist_splice_tail(&free_list, &cache->dead_region_list);
+
+		for (cnt = 0; cnt < OFI_MR_CACHE_RECLAIM_BATCH &&
+		     util_mr_cache_above_low(cache); cnt++) {
+			entry = util_mr_lru_victim(cache);
+			if (!entry)
+				break;
+			util_mr_cache_evict(cache, entry, &free_list,
+					    FI_MR_CACHE_EVICT_RECLAIM);
+		}
+		pthread_mutex_unlock(&mm_lock);
+
+		util_mr_free_list(cache, &free_list);
+
+		pthread_mutex_lock(&mm_lock);
+	}
+	pthread_mutex_unlock(&mm_lock);
+
+	return NULL;
 }
 
 void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
 {
+	struct ofi_mr_cache_tslot *slot;
+	int32_t cnt;
+
 	FI_DBG(cache->prov, FI_LOG_MR, "delete %p (len: %zu)\n",
 	       entry->info.iov.iov_base, entry->info.iov.iov_len);
 
+	/*
+	 * Dropping a reference that is not the last one needs no lock.  It is
+	 * counted in the thread's slot, so threads without one take the lock.
+	 */
+	slot = &ofi_mr_cache_tslots[cache->id % OFI_MR_CACHE_TSLOTS];
+	cnt = ofi_atomic_get32(&entry->use_cnt);
+	while (slot->cache_id == cache->id && cnt > 1) {
+		if (ofi_atomic_compare_exchange_weak32(&entry->use_cnt, &cnt,
+						       cnt - 1)) {
+			slot->deletes++;
+			return;
+		}
+	}
+
 	pthread_mutex_lock(&mm_lock);
 	cache->delete_cnt++;
 
-	if (--entry->use_cnt == 0) {
+	if (ofi_atomic_dec32(&entry->use_cnt) == 0) {
 		if (!entry->node) {
 			cache->uncached_cnt--;
 			cache->uncached_size -= entry->info.iov.iov_len;
@@ -251,7 +683,8 @@ void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
 			util_mr_free_entry(cache, entry);
 			return;
 		}
-		dlist_insert_tail(&entry->list_entry, &cache->lru_list);
+		util_mr_lru_insert(cache, entry);
+		util_mr_cache_kick(cache);
 	}
 	pthread_mutex_unlock(&mm_lock);
 }
@@ -268,7 +701,7 @@ void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
  */
 static int
 util_mr_cache_create(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
-		     struct ofi_mr_entry **entry)
+		     uint64_t start, struct ofi_mr_entry **entry)
 {
 	struct ofi_mr_entry *cur;
 	int ret;
@@ -285,7 +718,7 @@ util_mr_cache_create(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
 
 	(*entry)->node = NULL;
 	(*entry)->info = *info;
-	(*entry)->use_cnt = 1;
+	ofi_atomic_initialize32(&(*entry)->use_cnt, 1);
 
 	ret = cache->add_region(cache, *entry);
 	if (ret)
@@ -317,8 +750,12 @@ util_mr_cache_create(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
 			util_mr_uncache_entry_storage(cache, *entry);
 			cache->uncached_cnt++;
 			cache->uncached_size += (*entry)->info.iov.iov_len;
+		} else {
+			util_mr_cache_remember(cache, *entry);
 		}
+		util_mr_cache_kick(cache);
 	}
+	util_mr_cache_record(cache->miss_nsec, start);
 	pthread_mutex_unlock(&mm_lock);
 	return 0;
 
@@ -329,10 +766,41 @@ free:
 	return ret;
 }
 
+/*
+ * With merging enabled, a new host memory region absorbs every cached region
+ * of the same peer that overlaps or abuts it, so that a single registration
+ * covers them all.  Caller must hold mm_lock.
+ */
+static void util_mr_cache_merge(struct ofi_mr_cache *cache,
+				struct ofi_mr_info *info)
+{
+	struct ofi_mr_entry *entry;
+	uintptr_t start, end;
+
+	start = (uintptr_t) info->iov.iov_base;
+	end = start + info->iov.iov_len;
+
+	while ((entry = ofi_mr_rbt_adjacent(&cache->tree, info))) {
+		FI_DBG(cache->prov, FI_LOG_MR, "merge %p (len: %zu)\n",
+		       entry->info.iov.iov_base, entry->info.iov.iov_len);
+
+		start = MIN(start, (uintptr_t) entry->info.iov.iov_base);
+		end = MAX(end, (uintptr_t) entry->info.iov.iov_base +
+			       entry->info.iov.iov_len);
+		info->iov.iov_base = (void *) start;
+		info->iov.iov_len = end - start;
+
+		util_mr_uncache_entry(cache, entry, FI_MR_CACHE_EVICT_MERGE);
+		cache->merge_cnt++;
+	}
+}
+
 int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
 			struct ofi_mr_entry **entry)
 {
 	struct ofi_mem_monitor *monitor;
+	struct ofi_mr_info merged;
+	uint64_t start;
 	bool flush_lru;
 	int ret;
 
@@ -347,10 +815,18 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *in
 	FI_DBG(cache->prov, FI_LOG_MR, "search %p (len: %zu)\n",
 	       info->iov.iov_base, info->iov.iov_len);
 
+	if (util_mr_cache_fast_hit(cache, monitor, info, entry))
+		return 0;
+
+	start = ofi_gettime_ns();
 	do {
 		pthread_mutex_lock(&mm_lock);
+		util_mr_cache_add_fast_cnts(cache);
 		flush_lru = ofi_mr_cache_full(cache);
-		if (flush_lru || !dlist_empty(&cache->dead_region_list)) {
+		if (cache->reclaim) {
+			util_mr_cache_kick(cache);
+		} else if (flush_lru ||
+			   !dlist_empty(&cache->dead_region_list)) {
 			pthread_mutex_unlock(&mm_lock);
 			ofi_mr_cache_flush(cache, flush_lru);
 			pthread_mutex_lock(&mm_lock);
@@ -364,14 +840,27 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *in
 		    monitor->valid(monitor, info, *entry))
 			goto hit;
 
-		/* Purge regions that overlap with new region */
-		while (*entry) {
-			util_mr_uncache_entry(cache, *entry);
+		if (*entry && ofi_iov_within(&info->iov, &(*entry)->info.iov)) {
+			util_mr_uncache_entry(cache, *entry,
+					      FI_MR_CACHE_EVICT_INVALID);
 			*entry = ofi_mr_rbt_find(&cache->tree, info);
 		}
+
+		merged = *info;
+		if (cache_params.merge_regions &&
+		    info->iface == FI_HMEM_SYSTEM) {
+			util_mr_cache_merge(cache, &merged);
+		} else {
+			/* Purge regions that overlap with new region */
+			while (*entry) {
+				util_mr_uncache_entry(cache, *entry,
+						      FI_MR_CACHE_EVICT_OVERLAP);
+				*entry = ofi_mr_rbt_find(&cache->tree, info);
+			}
+		}
 		pthread_mutex_unlock(&mm_lock);
 
-		ret = util_mr_cache_create(cache, info, entry);
+		ret = util_mr_cache_create(cache, &merged, start, entry);
 		if (ret && ret != -FI_EAGAIN) {
 			if (ofi_mr_cache_flush(cache, true))
 				ret = -FI_EAGAIN;
@@ -382,8 +871,10 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *in
 
 hit:
 	cache->hit_cnt++;
-	if ((*entry)->use_cnt++ == 0)
+	if (ofi_atomic_inc32(&(*entry)->use_cnt) == 1)
 		dlist_remove_init(&(*entry)->list_entry);
+	util_mr_cache_remember(cache, *entry);
+	util_mr_cache_record(cache->hit_nsec, start);
 	pthread_mutex_unlock(&mm_lock);
 	return 0;
 }
@@ -414,8 +905,8 @@ struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 	}
 
 	cache->hit_cnt++;
-	if ((entry)->use_cnt++ == 0)
-		dlist_remove_init(&(entry)->list_entry);
+	if (ofi_atomic_inc32(&entry->use_cnt) == 1)
+		dlist_remove_init(&entry->list_entry);
 
 unlock:
 	pthread_mutex_unlock(&mm_lock);
@@ -441,7 +932,7 @@ int ofi_mr_cache_reg(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
 	pthread_mutex_unlock(&mm_lock);
 
 	(*entry)->info.iov = *attr->mr_iov;
-	(*entry)->use_cnt = 1;
+	ofi_atomic_initialize32(&(*entry)->use_cnt, 1);
 	(*entry)->node = NULL;
 
 	ret = cache->add_region(cache, *entry);
@@ -466,9 +957,25 @@ void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 		return;
 
 	FI_INFO(cache->prov, FI_LOG_MR, "MR cache stats: "
-		"searches %zu, deletes %zu, hits %zu notify %zu\n",
+		"searches %zu, deletes %zu, hits %zu notify %zu merges %zu "
+		"evictions %zu reclaims %zu\n",
 		cache->search_cnt, cache->delete_cnt, cache->hit_cnt,
-		cache->notify_cnt);
+		cache->notify_cnt, cache->merge_cnt, cache->evict_cnt,
+		cache->reclaim_cnt);
+
+	if (cache->thread_running) {
+		pthread_mutex_lock(&mm_lock);
+		cache->thread_stop = true;
+		pthread_cond_signal(&cache->thread_cond);
+		pthread_mutex_unlock(&mm_lock);
+		pthread_join(cache->thread, NULL);
+		cache->thread_running = false;
+		cache->reclaim = false;
+	}
+	pthread_cond_destroy(&cache->thread_cond);
+
+	if (cache_params.stats_file)
+		util_mr_cache_dump_stats(cache);
 
 	while (ofi_mr_cache_flush(cache, true))
 		;
@@ -485,20 +992,39 @@ void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 	assert(cache->uncached_size == 0);
 }
 
+/* Split to avoid overflow, limits may be set close to SIZE_MAX */
+static size_t util_mr_cache_pct(size_t limit, size_t pct)
+{
+	pct = MIN(pct, 100);
+	return limit / 100 * pct + limit % 100 * pct / 100;
+}
+
 /* Monitors array must be of size OFI_HMEM_MAX. */
 int ofi_mr_cache_init(struct util_domain *domain,
 		      struct ofi_mem_monitor **monitors,
 		      struct ofi_mr_cache *cache)
 {
-	int ret;
+	bool reclaim;
+	int i, ret;
 
 	assert(cache->add_region && cache->delete_region);
 	if (!cache_params.max_cnt || !cache_params.max_size)
 		return -FI_ENOSPC;
 
 	pthread_mutex_init(&cache->lock, NULL);
-	dlist_init(&cache->lru_list);
+	pthread_cond_init(&cache->thread_cond, NULL);
+	for (i = 0; i < OFI_MR_CACHE_LRU_CLASSES; i++)
+		dlist_init(&cache->lru_list[i]);
+	cache->lru_seq = 0;
 	dlist_init(&cache->dead_region_list);
+	cache->thread_running = false;
+	cache->thread_stop = false;
+	cache->reclaim = false;
+	cache->stats_time = 0;
+	cache->low_cnt = util_mr_cache_pct(cache_params.max_cnt,
+					   cache_params.low_watermark);
+	cache->low_size = util_mr_cache_pct(cache_params.max_size,
+					    cache_params.low_watermark);
 	cache->cached_cnt = 0;
 	cache->cached_size = 0;
 	cache->uncached_cnt = 0;
@@ -507,6 +1033,18 @@ int ofi_mr_cache_init(struct util_domain *domain,
 	cache->delete_cnt = 0;
 	cache->hit_cnt = 0;
 	cache->notify_cnt = 0;
+	cache->merge_cnt = 0;
+	cache->evict_cnt = 0;
+	cache->evict_size = 0;
+	cache->reclaim_cnt = 0;
+	cache->fast_hit_cnt = 0;
+	memset(cache->evict, 0, sizeof(cache->evict));
+	memset(cache->hit_nsec, 0, sizeof(cache->hit_nsec));
+	memset(cache->miss_nsec, 0, sizeof(cache->miss_nsec));
+	ofi_atomic_initialize64(&cache->gen, 0);
+	pthread_mutex_lock(&mm_lock);
+	cache->id = ++ofi_mr_cache_next_id;
+	pthread_mutex_unlock(&mm_lock);
 	cache->domain = domain;
 	if (domain) {
 		cache->prov = domain->prov;
@@ -527,6 +1065,28 @@ int ofi_mr_cache_init(struct util_domain *domain,
 	if (ret)
 		goto del;
 
+	if (cache_params.stats_file && cache_params.stats_interval)
+		cache->stats_time = ofi_gettime_ms() +
+				    cache_params.stats_interval * 1000;
+
+	if (cache_params.reclaim && !cache->delete_region_mt)
+		FI_INFO(cache->prov, FI_LOG_MR, "background reclaim is not "
+			"supported, regions are deregistered inline\n");
+
+	reclaim = cache_params.reclaim && cache->delete_region_mt;
+	if (reclaim || cache->stats_time) {
+		ret = pthread_create(&cache->thread, NULL,
+				     util_mr_cache_thread, cache);
+		if (ret) {
+			FI_WARN(cache->prov, FI_LOG_MR,
+				"failed to start MR cache thread: %s\n",
+				strerror(ret));
+		} else {
+			cache->thread_running = true;
+			cache->reclaim = reclaim;
+		}
+	}
+
 	return 0;
 del:
 	ofi_monitors_del_cache(cache);
@@ -534,10 +1094,32 @@ destroy:
 	ofi_rbmap_cleanup(&cache->tree);
 	if (domain)
 		ofi_atomic_dec32(&cache->domain->ref);
+	cache->domain = NULL;
+	pthread_cond_destroy(&cache->thread_cond);
 	pthread_mutex_destroy(&cache->lock);
 	return ret;
 }
 
+/*
+ * The caller sets stats->size to the size of its structure.  Counters that
+ * do not fit are not returned, and size is set to the bytes written.
+ */
+int ofi_mr_cache_get_stats(struct ofi_mr_cache *cache,
+			   struct fi_mr_cache_stats *stats)
+{
+	struct fi_mr_cache_stats all;
+	size_t size;
+
+	if (stats->size <= offsetof(struct fi_mr_cache_stats, cached_cnt))
+		return -FI_EINVAL;
+
+	util_mr_cache_read_stats(cache, &all);
+	size = MIN(stats->size, sizeof(all));
+	memcpy(stats, &all, size);
+	stats->size = size;
+	return 0;
+}
+
 
 
 static int ofi_close_cache_fid(struct fid *fid)
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "ofi_atomic.h"
+
+/*
+ * Local reduction kernels.
+ *
+ * The atomic write handlers update each element atomically, which is
+ * required when the target buffer may be accessed by a peer, but keeps
+ * the compiler from vectorizing the loops.  Reductions into private
+ * buffers, such as the intermediate results of a software collective,
+ * do not need that guarantee.  The kernels below are plain loops over
+ * non-overlapping buffers, built once per instruction set and selected
+ * at runtime.  Operations and datatypes without a kernel fall back to
+ * the atomic write handlers.
+ */
+
+void (*ofi_reduce_handlers[OFI_REDUCE_OP_CNT][OFI_DATATYPE_CNT])
+	(void *dst, const void *src, size_t cnt);
+
+typedef void (*ofi_reduce_fn)(void *dst, const void *src, size_t cnt);
+
+#define OFI_REDUCE_MIN(dst,src)		((dst) > (src) ? (src) : (dst))
+#define OFI_REDUCE_MAX(dst,src)		((dst) < (src) ? (src) : (dst))
+#define OFI_REDUCE_SUM(dst,src)		((dst) + (src))
+#define OFI_REDUCE_PROD(dst,src)	((dst) * (src))
+#define OFI_REDUCE_BOR(dst,src)		((dst) | (src))
+#define OFI_REDUCE_BAND(dst,src)	((dst) & (src))
+#define OFI_REDUCE_BXOR(dst,src)	((dst) ^ (src))
+
+/* Debug builds compile at -O0, which would leave the kernels scalar. */
+#if defined(__GNUC__) && !defined(__clang__)
+#define OFI_REDUCE_OPTIMIZE	__attribute__((optimize("O3")))
+#else
+#define OFI_REDUCE_OPTIMIZE
+#endif
+
+#define OFI_DEF_REDUCE_FUNC(isa, attr, op, type)			\
+static void attr OFI_REDUCE_OPTIMIZE					\
+ofi_reduce_##isa##_##op##_##type(void *dst, const void *src, size_t cnt)\
+{									\
+	type *OFI_RESTRICT d = dst;					\
+	const type *OFI_RESTRICT s = src;				\
+	size_t i;							\
+									\
+	for (i = 0; i < cnt; i++)					\
+		d[i] = (type) OFI_REDUCE_##op(d[i], s[i]);		\
+}
+
+#define OFI_DEF_REDUCE_INT(isa, attr, op)				\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, int8_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, uint8_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, int16_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, uint16_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, int32_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, uint32_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, int64_t)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, uint64_t)
+
+#define OFI_DEF_REDUCE_ALL(isa, attr, op)				\
+	OFI_DEF_REDUCE_INT(isa, attr, op)				\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, float)			\
+	OFI_DEF_REDUCE_FUNC(isa, attr, op, double)
+
+#define OFI_REDUCE_INT_ENTRIES(isa, op)					\
+	[FI_INT8]   = ofi_reduce_##isa##_##op##_int8_t,			\
+	[FI_UINT8]  = ofi_reduce_##isa##_##op##_uint8_t,		\
+	[FI_INT16]  = ofi_reduce_##isa##_##op##_int16_t,		\
+	[FI_UINT16] = ofi_reduce_##isa##_##op##_uint16_t,		\
+	[FI_INT32]  = ofi_reduce_##isa##_##op##_int32_t,		\
+	[FI_UINT32] = ofi_reduce_##isa##_##op##_uint32_t,		\
+	[FI_INT64]  = ofi_reduce_##isa##_##op##_int64_t,		\
+	[FI_UINT64] = ofi_reduce_##isa##_##op##_uint64_t
+
+#define OFI_REDUCE_ALL_ENTRIES(isa, op)					\
+	OFI_REDUCE_INT_ENTRIES(isa, op),				\
+	[FI_FLOAT]  = ofi_reduce_##isa##_##op##_float,			\
+	[FI_DOUBLE] = ofi_reduce_##isa##_##op##_double
+
+#define OFI_DEF_REDUCE_ISA(isa, attr)					\
+	OFI_DEF_REDUCE_ALL(isa, attr, MIN)				\
+	OFI_DEF_REDUCE_ALL(isa, attr, MAX)				\
+	OFI_DEF_REDUCE_ALL(isa, attr, SUM)				\
+	OFI_DEF_REDUCE_ALL(isa, attr, PROD)				\
+	OFI_DEF_REDUCE_INT(isa, attr, BOR)				\
+	OFI_DEF_REDUCE_INT(isa, attr, BAND)				\
+	OFI_DEF_REDUCE_INT(isa, attr, BXOR)				\
+									\
+static const ofi_reduce_fn						\
+ofi_reduce_##isa##_kernels[OFI_REDUCE_OP_CNT][OFI_DATATYPE_CNT] = {	\
+	[FI_MIN]  = { OFI_REDUCE_ALL_ENTRIES(isa, MIN) },		\
+	[FI_MAX]  = { OFI_REDUCE_ALL_ENTRIES(isa, MAX) },		\
+	[FI_SUM]  = { OFI_REDUCE_ALL_ENTRIES(isa, SUM) },		\
+	[FI_PROD] = { OFI_REDUCE_ALL_ENTRIES(isa, PROD) },		\
+	[FI_BOR]  = { OFI_REDUCE_INT_ENTRIES(isa, BOR) },		\
+	[FI_BAND] = { OFI_REDUCE_INT_ENTRIES(isa, BAND) },		\
+	[FI_BXOR] = { OFI_REDUCE_INT_ENTRIES(isa, BXOR) },		\
+};
+
+/* Built with the compiler's baseline flags */
+OFI_DEF_REDUCE_ISA(generic, )
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_REDUCE_X86 1
+
+OFI_DEF_REDUCE_ISA(sse4, __attribute__((target("sse4.2"))))
+OFI_DEF_REDUCE_ISA(avx2, __attribute__((target("avx2"))))
+OFI_DEF_REDUCE_ISA(avx512, __attribute__((target("avx512f,avx512bw"))))
+#endif
+
+struct ofi_reduce_isa {
+	const char *name;
+	const ofi_reduce_fn (*kernels)[OFI_DATATYPE_CNT];
+	int (*supported)(void);
+};
+
+static int ofi_reduce_generic_supported(void)
+{
+	return 1;
+}
+
+#ifdef HAVE_REDUCE_X86
+/* __builtin_cpu_supports also checks that the OS saves the wide registers */
+static int ofi_reduce_sse4_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+
+static int ofi_reduce_avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static int ofi_reduce_avx512_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") &&
+	       __builtin_cpu_supports("avx512bw");
+}
+#endif
+
+/* Ordered from most to least preferred */
+static const struct ofi_reduce_isa ofi_reduce_isas[] = {
+#ifdef HAVE_REDUCE_X86
+	{ "avx512", ofi_reduce_avx512_kernels, ofi_reduce_avx512_supported },
+	{ "avx2", ofi_reduce_avx2_kernels, ofi_reduce_avx2_supported },
+	{ "sse4", ofi_reduce_sse4_kernels, ofi_reduce_sse4_supported },
+#endif
+	{ "generic", ofi_reduce_generic_kernels, ofi_reduce_generic_supported },
+};
+
+void ofi_reduce_init(void)
+{
+	const struct ofi_reduce_isa *isa = NULL;
+	char *param_val = NULL;
+	int op, dt;
+	size_t i;
+
+	fi_param_define(NULL, "reduce_isa", FI_PARAM_STRING,
+			"Instruction set used by the local reduction kernels "
+			"of software collectives: avx512, avx2, sse4, or "
+			"generic (default: best supported by the CPU)");
+	fi_param_get_str(NULL, "reduce_isa", &param_val);
+
+	for (i = 0; i < ARRAY_SIZE(ofi_reduce_isas); i++) {
+		if (param_val && strcasecmp(param_val, ofi_reduce_isas[i].name))
+			continue;
+		if (ofi_reduce_isas[i].supported()) {
+			isa = &ofi_reduce_isas[i];
+			break;
+		}
+	}
+
+	if (!isa) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"reduce_isa %s is not available, using generic\n",
+			param_val);
+		isa = &ofi_reduce_isas[ARRAY_SIZE(ofi_reduce_isas) - 1];
+	}
+	FI_INFO(&core_prov, FI_LOG_CORE, "reduction kernels: %s\n",
+		isa->name);
+
+	for (op = 0; op < OFI_REDUCE_OP_CNT; op++) {
+		for (dt = 0; dt < OFI_DATATYPE_CNT; dt++) {
+			ofi_reduce_handlers[op][dt] = isa->kernels[op][dt] ?
+				isa->kernels[op][dt] :
+				ofi_atomic_write_handlers[op][dt];
+		}
+	}
+}
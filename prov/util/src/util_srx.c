@@ -53,6 +53,46 @@ static inline void **util_srx_desc(struct util_srx_ctx *srx,
 			(sizeof(struct iovec) * srx->iov_limit));
 }
 
+struct util_srx_match {
+	struct slist		*queue;
+	struct slist_entry	*item;
+	struct slist_entry	*prev;
+	struct util_rx_entry	*entry;
+};
+
+/* MurmurHash3 finalizer, spreads structured tags across the buckets */
+static inline size_t util_tag_bucket(struct util_srx_ctx *srx, uint64_t tag)
+{
+	tag ^= tag >> 33;
+	tag *= 0xff51afd7ed558ccdULL;
+	tag ^= tag >> 33;
+	tag *= 0xc4ceb9fe1a85ec53ULL;
+	tag ^= tag >> 33;
+	return (size_t) tag & (srx->tag_bucket_cnt - 1);
+}
+
+static struct slist *util_posted_tag_queue(struct util_srx_ctx *srx,
+					   fi_addr_t addr, uint64_t tag,
+					   uint64_t ignore)
+{
+	if (addr != FI_ADDR_UNSPEC)
+		return ofi_array_at(&srx->src_trecv_queues, addr);
+
+	if (srx->tag_buckets && !ignore)
+		return &srx->tag_buckets[util_tag_bucket(srx, tag)];
+
+	return &srx->tag_queue;
+}
+
+static void util_record_depth(struct util_srx_match_stats *stats,
+			      uint64_t depth)
+{
+	stats->search_cnt++;
+	stats->depth += depth;
+	if (depth > stats->max_depth)
+		stats->max_depth = depth;
+}
+
 static void util_init_rx_entry(struct util_rx_entry *entry,
 			       const struct iovec *iov, void **desc,
 			       size_t count, fi_addr_t addr, void *context,
@@ -235,27 +275,80 @@ static int util_get_msg(struct fid_peer_srx *srx, fi_addr_t addr,
 	return FI_SUCCESS;
 }
 
-static int util_match_tag(struct fid_peer_srx *srx, fi_addr_t addr,
-			  size_t size, uint64_t tag,
-			  struct fi_peer_rx_entry **rx_entry)
+/* Finds the first receive in queue that matches tag and was posted before
+ * the receive with sequence number seq_limit.
+ */
+static bool util_find_posted(struct slist *queue, uint64_t tag,
+			     uint64_t seq_limit, struct util_srx_match *match,
+			     uint64_t *depth)
 {
-	struct util_srx_ctx *srx_ctx;
 	struct util_rx_entry *util_entry;
 	struct slist_entry *item, *prev;
-	int ret = FI_SUCCESS;
 
-	srx_ctx = srx->ep_fid.fid.context;
-	slist_foreach(&srx_ctx->tag_queue, item, prev) {
+	slist_foreach(queue, item, prev) {
 		util_entry = container_of(item, struct util_rx_entry,
 					  peer_entry);
+		if (util_entry->seq_no > seq_limit)
+			break;
+
+		(*depth)++;
 		if (ofi_match_tag(util_entry->peer_entry.tag,
 				  util_entry->ignore, tag)) {
-			util_entry->peer_entry.srx = srx;
-			srx_ctx->update_func(srx_ctx, util_entry);
-			slist_remove(&srx_ctx->tag_queue, item, prev);
-			goto out;
+			match->queue = queue;
+			match->item = item;
+			match->prev = prev;
+			match->entry = util_entry;
+			return true;
 		}
 	}
+	return false;
+}
+
+/* Searches the receives posted for any source.  With the tag index, the
+ * exact tag bucket and the wildcard queue are searched and the receive
+ * that was posted first wins.
+ */
+static bool util_find_posted_any(struct util_srx_ctx *srx, uint64_t tag,
+				 uint64_t seq_limit,
+				 struct util_srx_match *match, uint64_t *depth)
+{
+	struct util_srx_match exact;
+	bool found;
+
+	found = util_find_posted(&srx->tag_queue, tag, seq_limit, match, depth);
+	if (!srx->tag_buckets)
+		return found;
+
+	if (found)
+		seq_limit = match->entry->seq_no;
+
+	if (util_find_posted(&srx->tag_buckets[util_tag_bucket(srx, tag)],
+			     tag, seq_limit, &exact, depth)) {
+		*match = exact;
+		return true;
+	}
+	return found;
+}
+
+static int util_match_tag(struct fid_peer_srx *srx, fi_addr_t addr,
+			  size_t size, uint64_t tag, uint64_t depth,
+			  struct fi_peer_rx_entry **rx_entry)
+{
+	struct util_srx_ctx *srx_ctx;
+	struct util_rx_entry *util_entry;
+	struct util_srx_match match;
+	int ret = FI_SUCCESS;
+
+	srx_ctx = srx->ep_fid.fid.context;
+	if (util_find_posted_any(srx_ctx, tag, UINT64_MAX, &match, &depth)) {
+		util_record_depth(&srx_ctx->posted_stats, depth);
+		util_entry = match.entry;
+		util_entry->peer_entry.srx = srx;
+		srx_ctx->update_func(srx_ctx, util_entry);
+		slist_remove(match.queue, match.item, match.prev);
+		goto out;
+	}
+	util_record_depth(&srx_ctx->posted_stats, depth);
 
 	util_entry = util_init_unexp(srx_ctx, addr, size, tag);
 	if (!util_entry)
@@ -273,9 +366,9 @@ static int util_get_tag(struct fid_peer_srx *srx, fi_addr_t addr,
 {
 	struct util_srx_ctx *srx_ctx;
 	struct slist *queue;
-	struct slist_entry *any_item, *any_prev;
-	struct slist_entry *item, *prev;
-	struct util_rx_entry *util_entry, *any_entry;
+	struct util_srx_match match, any_match;
+	struct util_rx_entry *util_entry;
+	uint64_t depth = 0;
 	int ret = FI_SUCCESS;
 
 	srx_ctx = srx->ep_fid.fid.context;
@@ -285,37 +378,21 @@ static int util_get_tag(struct fid_peer_srx *srx, fi_addr_t addr,
 		ofi_array_at(&srx_ctx->src_trecv_queues, addr);
 
 	if (!queue || slist_empty(queue))
-		return util_match_tag(srx, addr, size, tag, rx_entry);
+		return util_match_tag(srx, addr, size, tag, depth, rx_entry);
 
-	slist_foreach(queue, item, prev) {
-		util_entry = container_of(item, struct util_rx_entry,
-					  peer_entry);
-		if (ofi_match_tag(util_entry->peer_entry.tag,
-				  util_entry->ignore, tag))
-			goto check_any;
-	}
-	return util_match_tag(srx, addr, size, tag, rx_entry);
+	if (!util_find_posted(queue, tag, UINT64_MAX, &match, &depth))
+		return util_match_tag(srx, addr, size, tag, depth, rx_entry);
 
-check_any:
-	slist_foreach(&srx_ctx->tag_queue, any_item, any_prev) {
-		any_entry = container_of(any_item, struct util_rx_entry,
-					 peer_entry);
-		if (any_entry->seq_no > util_entry->seq_no)
-			break;
+	if (util_find_posted_any(srx_ctx, tag, match.entry->seq_no,
+				 &any_match, &depth))
+		match = any_match;
+	util_record_depth(&srx_ctx->posted_stats, depth);
 
-		if (ofi_match_tag(any_entry->peer_entry.tag, any_entry->ignore,
-				  tag)) {
-			queue = &srx_ctx->tag_queue;
-			util_entry = any_entry;
-			item = any_item;
-			prev = any_prev;
-			break;
-		}
-	}
+	util_entry = match.entry;
 	util_entry->peer_entry.srx = srx;
 	srx_ctx->update_func(srx_ctx, util_entry);
 	*rx_entry = &util_entry->peer_entry;
-	slist_remove(queue, item, prev);
+	slist_remove(match.queue, match.item, match.prev);
 	return ret;
 }
 
@@ -346,6 +423,7 @@ static int util_queue_tag(struct fi_peer_rx_entry *rx_entry)
 {
 	struct util_srx_ctx *srx_ctx = rx_entry->srx->ep_fid.fid.context;
 	struct util_unexp_peer *unexp_peer;
+	struct util_rx_entry *util_entry;
 
 	assert(ofi_genlock_held(srx_ctx->lock));
 
@@ -356,13 +434,21 @@ static int util_queue_tag(struct fi_peer_rx_entry *rx_entry)
 		unexp_peer = ofi_array_at(&srx_ctx->src_unexp_peers,
 					  rx_entry->addr);
 		assert(unexp_peer);
-		slist_insert_tail((struct slist_entry *) rx_entry,
+		dlist_insert_tail((struct dlist_entry *) rx_entry,
 				  &unexp_peer->tag_queue);
 		if (!unexp_peer->cnt++)
 			dlist_insert_tail(&unexp_peer->entry,
 					  &srx_ctx->unexp_peers);
 
 	}
+
+	if (srx_ctx->unexp_tag_buckets) {
+		util_entry = container_of(rx_entry, struct util_rx_entry,
+					  peer_entry);
+		dlist_insert_tail(&util_entry->tag_entry,
+			&srx_ctx->unexp_tag_buckets[util_tag_bucket(srx_ctx,
+							rx_entry->tag)]);
+	}
 	return FI_SUCCESS;
 }
 
@@ -430,8 +516,7 @@ static void util_foreach_unspec(struct fid_peer_srx *srx,
 		unexp_peer = ofi_array_at(&srx_ctx->src_unexp_peers,
 					  rx_entry->addr);
 		assert(unexp_peer);
-		slist_insert_tail((struct slist_entry *) rx_entry,
-				  &unexp_peer->tag_queue);
+		dlist_insert_tail(item, &unexp_peer->tag_queue);
 		if (!unexp_peer->cnt++)
 			dlist_insert_tail(&unexp_peer->entry,
 					  &srx_ctx->unexp_peers);
@@ -544,66 +629,96 @@ out:
 	return ret;
 }
 
-static struct util_rx_entry *util_search_peer_tag(struct util_unexp_peer *peer,
-				uint64_t tag, uint64_t ignore, bool remove)
+static void util_remove_unexp_tag(struct util_srx_ctx *srx,
+				  struct util_rx_entry *rx_entry)
 {
-	struct util_rx_entry *rx_entry;
-	struct slist_entry *item, *prev;
+	struct util_unexp_peer *unexp_peer;
 
-	assert(peer);
-	if (slist_empty(&peer->tag_queue))
-		return NULL;
+	dlist_remove((struct dlist_entry *) &rx_entry->peer_entry);
+	if (srx->unexp_tag_buckets)
+		dlist_remove(&rx_entry->tag_entry);
 
-	slist_foreach(&peer->tag_queue, item, prev) {
-		rx_entry = (struct util_rx_entry *) item;
-		if (!ofi_match_tag(tag, ignore, rx_entry->peer_entry.tag))
-			continue;
+	if (rx_entry->peer_entry.addr == FI_ADDR_UNSPEC)
+		return;
 
-		if (remove) {
-			slist_remove(&peer->tag_queue, item, prev);
-			if (!--peer->cnt) {
-				assert(slist_empty(&peer->tag_queue));
-				dlist_remove(&peer->entry);
-			}
-		}
-		return rx_entry;
+	unexp_peer = ofi_array_at(&srx->src_unexp_peers,
+				  rx_entry->peer_entry.addr);
+	assert(unexp_peer);
+	if (!--unexp_peer->cnt) {
+		assert(slist_empty(&unexp_peer->msg_queue) &&
+		       dlist_empty(&unexp_peer->tag_queue));
+		dlist_remove(&unexp_peer->entry);
 	}
-	return NULL;
 }
 
-static struct util_rx_entry *util_search_unexp_tag(struct util_srx_ctx *srx,
-		fi_addr_t addr, uint64_t tag, uint64_t ignore, bool remove)
+static struct util_rx_entry *util_search_tag_queue(struct dlist_entry *queue,
+				uint64_t tag, uint64_t ignore, uint64_t *depth)
 {
 	struct util_rx_entry *rx_entry;
-	struct util_unexp_peer *unexp_peer;
 	struct dlist_entry *entry;
 
-	if (addr == FI_ADDR_UNSPEC) {
-		dlist_foreach(&srx->unspec_unexp_tag_queue, entry) {
-			rx_entry = container_of(entry, struct util_rx_entry,
-						peer_entry);
-			if (!ofi_match_tag(tag, ignore,
-			    rx_entry->peer_entry.tag))
-				continue;
+	dlist_foreach(queue, entry) {
+		rx_entry = container_of(entry, struct util_rx_entry,
+					peer_entry);
+		(*depth)++;
+		if (ofi_match_tag(tag, ignore, rx_entry->peer_entry.tag))
+			return rx_entry;
+	}
+	return NULL;
+}
 
-			if (remove)
-				dlist_remove(entry);
+/* Bucket entries are in arrival order across all sources */
+static struct util_rx_entry *util_search_tag_bucket(struct util_srx_ctx *srx,
+				fi_addr_t addr, uint64_t tag, uint64_t *depth)
+{
+	struct util_rx_entry *rx_entry;
 
+	dlist_foreach_container(
+		&srx->unexp_tag_buckets[util_tag_bucket(srx, tag)],
+		struct util_rx_entry, rx_entry, tag_entry) {
+		(*depth)++;
+		if (rx_entry->peer_entry.tag == tag &&
+		    (addr == FI_ADDR_UNSPEC ||
+		     addr == rx_entry->peer_entry.addr))
 			return rx_entry;
-		}
+	}
+	return NULL;
+}
 
-		dlist_foreach_container(&srx->unexp_peers,
-				struct util_unexp_peer, unexp_peer, entry) {
-			rx_entry = util_search_peer_tag(unexp_peer, tag,
-							ignore, remove);
-			if (rx_entry)
-				return rx_entry;
+static struct util_rx_entry *util_search_unexp_tag(struct util_srx_ctx *srx,
+		fi_addr_t addr, uint64_t tag, uint64_t ignore, bool remove)
+{
+	struct util_rx_entry *rx_entry = NULL;
+	struct util_unexp_peer *unexp_peer;
+	uint64_t depth = 0;
+
+	if (srx->unexp_tag_buckets && !ignore) {
+		rx_entry = util_search_tag_bucket(srx, addr, tag, &depth);
+	} else if (addr == FI_ADDR_UNSPEC) {
+		rx_entry = util_search_tag_queue(&srx->unspec_unexp_tag_queue,
+						 tag, ignore, &depth);
+		if (!rx_entry) {
+			dlist_foreach_container(&srx->unexp_peers,
+					struct util_unexp_peer, unexp_peer,
+					entry) {
+				rx_entry = util_search_tag_queue(
+						&unexp_peer->tag_queue, tag,
+						ignore, &depth);
+				if (rx_entry)
+					break;
+			}
 		}
-		return NULL;
+	} else {
+		unexp_peer = ofi_array_at(&srx->src_unexp_peers, addr);
+		assert(unexp_peer);
+		rx_entry = util_search_tag_queue(&unexp_peer->tag_queue, tag,
+						 ignore, &depth);
 	}
+	util_record_depth(&srx->unexp_stats, depth);
 
-	return util_search_peer_tag(ofi_array_at(&srx->src_unexp_peers, addr),
-				    tag, ignore, remove);
+	if (rx_entry && remove)
+		util_remove_unexp_tag(srx, rx_entry);
+	return rx_entry;
 }
 
 static ssize_t util_srx_peek(struct util_srx_ctx *srx, const struct iovec *iov,
@@ -684,8 +799,7 @@ ssize_t util_srx_generic_trecv(struct fid_ep *ep_fid, const struct iovec *iov,
 	} else {
 		rx_entry = util_search_unexp_tag(srx, addr, tag, ignore, true);
 		if (!rx_entry) {
-			queue = addr == FI_ADDR_UNSPEC ? &srx->tag_queue:
-				ofi_array_at(&srx->src_trecv_queues, addr);
+			queue = util_posted_tag_queue(srx, addr, tag, ignore);
 			assert(queue);
 			rx_entry = util_get_recv_entry(srx, iov, desc,
 						iov_count, addr, context, tag,
@@ -911,12 +1025,29 @@ static int util_cleanup_queues(struct ofi_dyn_arr *arr, void *list,
 	return FI_SUCCESS;
 }
 
+static void util_srx_log_stats(struct util_srx_ctx *srx)
+{
+	struct util_srx_match_stats *posted = &srx->posted_stats;
+	struct util_srx_match_stats *unexp = &srx->unexp_stats;
+
+	FI_INFO(&core_prov, FI_LOG_EP_CTRL, "SRX tag match stats (index %s): "
+		"posted searches %" PRIu64 ", avg depth %.2f, max depth %"
+		PRIu64 "; unexpected searches %" PRIu64 ", avg depth %.2f, "
+		"max depth %" PRIu64 "\n", srx->tag_buckets ? "on" : "off",
+		posted->search_cnt, posted->search_cnt ?
+		(double) posted->depth / posted->search_cnt : 0.0,
+		posted->max_depth, unexp->search_cnt, unexp->search_cnt ?
+		(double) unexp->depth / unexp->search_cnt : 0.0,
+		unexp->max_depth);
+}
+
 int util_srx_close(struct fid *fid)
 {
 	struct util_srx_ctx *srx;
 	struct util_unexp_peer *unexp_peer;
 	struct util_rx_entry *rx_entry;
 	struct slist_entry *entry;
+	size_t i;
 
 	srx = container_of(fid, struct util_srx_ctx, peer_srx.ep_fid.fid);
 	if (!srx)
@@ -942,6 +1073,15 @@ int util_srx_close(struct fid *fid)
 					     peer_entry));
 	}
 
+	for (i = 0; srx->tag_buckets && i < srx->tag_bucket_cnt; i++) {
+		while (!slist_empty(&srx->tag_buckets[i])) {
+			entry = slist_remove_head(&srx->tag_buckets[i]);
+			(void) util_cancel_entry(srx, FI_SEND | FI_TAGGED,
+					container_of(entry, struct util_rx_entry,
+						     peer_entry));
+		}
+	}
+
 	while (!dlist_empty(&srx->unspec_unexp_msg_queue)) {
 		dlist_pop_front(&srx->unspec_unexp_msg_queue,
 				struct util_rx_entry, rx_entry, peer_entry);
@@ -970,10 +1110,10 @@ int util_srx_close(struct fid *fid)
 			ofi_buf_free(rx_entry);
 			unexp_peer->cnt--;
 		}
-		while (!slist_empty(&unexp_peer->tag_queue)) {
-			rx_entry = container_of(slist_remove_head(
-				&unexp_peer->tag_queue), struct util_rx_entry,
-				peer_entry);
+		while (!dlist_empty(&unexp_peer->tag_queue)) {
+			dlist_pop_front(&unexp_peer->tag_queue,
+					struct util_rx_entry, rx_entry,
+					peer_entry);
 			rx_entry->peer_entry.srx->peer_ops->discard_tag(
 							&rx_entry->peer_entry);
 			ofi_buf_free(rx_entry);
@@ -983,6 +1123,9 @@ int util_srx_close(struct fid *fid)
 	}
 
 	ofi_array_destroy(&srx->src_unexp_peers);
+	util_srx_log_stats(srx);
+	free(srx->tag_buckets);
+	free(srx->unexp_tag_buckets);
 
 	ofi_atomic_dec32(&srx->cq->ref);
 	ofi_bufpool_destroy(srx->rx_pool);
@@ -1036,6 +1179,7 @@ static int util_cancel_src(struct ofi_dyn_arr *arr, void *list, void *context)
 static ssize_t util_srx_cancel(fid_t ep_fid, void *context)
 {
 	struct util_srx_ctx *srx;
+	size_t i;
 
 	srx = container_of(ep_fid, struct util_srx_ctx, peer_srx.ep_fid);
 
@@ -1044,6 +1188,12 @@ static ssize_t util_srx_cancel(fid_t ep_fid, void *context)
 			     context))
 		goto out;
 
+	for (i = 0; srx->tag_buckets && i < srx->tag_bucket_cnt; i++) {
+		if (util_cancel_recv(srx, &srx->tag_buckets[i],
+				     FI_TAGGED | FI_RECV, context))
+			goto out;
+	}
+
 	if (util_cancel_recv(srx, &srx->msg_queue, FI_MSG | FI_RECV, context))
 		goto out;
 
@@ -1117,10 +1267,29 @@ static void util_srx_init_unexp_peer(struct ofi_dyn_arr *arr, void *item)
 	struct util_unexp_peer *unexp_peer = item;
 
 	slist_init(&unexp_peer->msg_queue);
-	slist_init(&unexp_peer->tag_queue);
+	dlist_init(&unexp_peer->tag_queue);
 	unexp_peer->cnt = 0;
 }
 
+static int util_srx_init_tag_index(struct util_srx_ctx *srx, size_t rx_size)
+{
+	size_t i;
+
+	srx->tag_bucket_cnt = roundup_power_of_two(MAX(rx_size, 64));
+	srx->tag_buckets = calloc(srx->tag_bucket_cnt,
+				  sizeof(*srx->tag_buckets));
+	srx->unexp_tag_buckets = calloc(srx->tag_bucket_cnt,
+					sizeof(*srx->unexp_tag_buckets));
+	if (!srx->tag_buckets || !srx->unexp_tag_buckets)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < srx->tag_bucket_cnt; i++) {
+		slist_init(&srx->tag_buckets[i]);
+		dlist_init(&srx->unexp_tag_buckets[i]);
+	}
+	return FI_SUCCESS;
+}
+
 int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 			size_t iov_limit, size_t default_min_multi_recv,
 			ofi_update_func_t update_func,
@@ -1148,6 +1317,12 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 	slist_init(&srx->msg_queue);
 	slist_init(&srx->tag_queue);
 
+	if (ofi_srx_tag_index) {
+		ret = util_srx_init_tag_index(srx, rx_size);
+		if (ret)
+			goto err;
+	}
+
 	//each entry has the iovs and descriptors stored at the end of the entry
 	//calculate how much space each entry needs based on provider iov limits
 	pool_attr.size = sizeof(struct util_rx_entry) +
@@ -1159,10 +1334,8 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 	pool_attr.init_fn = util_rx_entry_init;
 	pool_attr.context = srx;
 	ret = ofi_bufpool_create_attr(&pool_attr, &srx->rx_pool);
-	if (ret) {
-		free(srx);
-		return ret;
-	}
+	if (ret)
+		goto err;
 
 	srx->min_multi_recv_size = default_min_multi_recv;
 	srx->iov_limit = iov_limit;
@@ -1184,4 +1357,10 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 
 	domain->srx = &srx->peer_srx;
 	return FI_SUCCESS;
+
+err:
+	free(srx->tag_buckets);
+	free(srx->unexp_tag_buckets);
+	free(srx);
+	return ret;
 }
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <ofi_mem.h>
+#include "util_unit_test.h"
+
+enum {
+	STATS_CHUNK_CNT	= 16,
+	TCACHE_THREADS	= 4,
+	TCACHE_BUFS	= 256,
+	TCACHE_ITERS	= 1000,
+	TCACHE_BUF_SIZE	= 64,
+};
+
+static struct ofi_bufpool *tcache_pool;
+static void *tcache_bufs[TCACHE_THREADS][TCACHE_BUFS];
+
+static size_t tcache_free_cnt(void)
+{
+	struct slist_entry *entry;
+	size_t cnt = 0;
+
+	for (entry = tcache_pool->free_list.entries.head; entry;
+	     entry = entry->next)
+		cnt++;
+	return cnt;
+}
+
+/* Allocate and free from a private cache, touching every buffer */
+static void *tcache_churn(void *arg)
+{
+	uintptr_t id = (uintptr_t) arg;
+	void **bufs = tcache_bufs[id];
+	int i, j;
+
+	for (i = 0; i < TCACHE_ITERS; i++) {
+		for (j = 0; j < TCACHE_BUFS; j++) {
+			bufs[j] = ofi_buf_alloc(tcache_pool);
+			if (!bufs[j])
+				return (void *) -1;
+			memset(bufs[j], (int) id, TCACHE_BUF_SIZE);
+		}
+		for (j = 0; j < TCACHE_BUFS; j++) {
+			if (((char *) bufs[j])[TCACHE_BUF_SIZE - 1] != (char) id)
+				return (void *) -1;
+			ofi_buf_free(bufs[j]);
+		}
+	}
+	return NULL;
+}
+
+static void *tcache_alloc(void *arg)
+{
+	uintptr_t id = (uintptr_t) arg;
+	int j;
+
+	for (j = 0; j < TCACHE_BUFS; j++) {
+		tcache_bufs[id][j] = ofi_buf_alloc(tcache_pool);
+		if (!tcache_bufs[id][j])
+			return (void *) -1;
+	}
+	return NULL;
+}
+
+/* Free the buffers allocated by the next thread */
+static void *tcache_free(void *arg)
+{
+	uintptr_t id = ((uintptr_t) arg + 1) % TCACHE_THREADS;
+	int j;
+
+	for (j = 0; j < TCACHE_BUFS; j++)
+		ofi_buf_free(tcache_bufs[id][j]);
+	return NULL;
+}
+
+static int tcache_run(void *(*func)(void *))
+{
+	pthread_t threads[TCACHE_THREADS];
+	void *status;
+	uintptr_t i;
+	int ret = 0;
+
+	for (i = 0; i < TCACHE_THREADS; i++) {
+		if (pthread_create(&threads[i], NULL, func, (void *) i))
+			return -1;
+	}
+	for (i = 0; i < TCACHE_THREADS; i++) {
+		pthread_join(threads[i], &status);
+		if (status)
+			ret = -1;
+	}
+	return ret;
+}
+
+/*
+ * Buffers left in the cache of a thread must be back in the pool once
+ * the thread exits, including buffers it freed for other threads.
+ */
+int test_bufpool_tcache(void)
+{
+	struct ofi_bufpool_attr attr = {
+		.size		= TCACHE_BUF_SIZE,
+		.alignment	= 16,
+		.chunk_cnt	= 64,
+		.flags		= OFI_BUFPOOL_THREAD_CACHE,
+	};
+	struct ofi_bufpool_stats stats;
+
+	UT_CHECK(!ofi_bufpool_create_attr(&attr, &tcache_pool));
+
+	UT_CHECK(!tcache_run(tcache_churn));
+	ofi_bufpool_get_stats(tcache_pool, &stats);
+	UT_CHECK(stats.entry_cnt >= TCACHE_BUFS);
+	UT_CHECK(tcache_free_cnt() == stats.entry_cnt);
+
+	UT_CHECK(!tcache_run(tcache_alloc));
+	UT_CHECK(!tcache_run(tcache_free));
+	ofi_bufpool_get_stats(tcache_pool, &stats);
+	UT_CHECK(stats.entry_cnt >= TCACHE_THREADS * TCACHE_BUFS);
+	UT_CHECK(tcache_free_cnt() == stats.entry_cnt);
+
+	ofi_bufpool_destroy(tcache_pool);
+	return 0;
+}
+
+/* Entries are added a region at a time and never released */
+int test_bufpool_stats(void)
+{
+	struct ofi_bufpool *pool;
+	struct ofi_bufpool_stats stats;
+	void *bufs[STATS_CHUNK_CNT + 1];
+	int i;
+
+	UT_CHECK(!ofi_bufpool_create(&pool, 64, 16, 0, STATS_CHUNK_CNT, 0));
+	ofi_bufpool_get_stats(pool, &stats);
+	UT_CHECK(!stats.region_cnt && !stats.entry_cnt);
+
+	for (i = 0; i < STATS_CHUNK_CNT + 1; i++) {
+		bufs[i] = ofi_buf_alloc(pool);
+		UT_CHECK(bufs[i]);
+	}
+	ofi_bufpool_get_stats(pool, &stats);
+	UT_CHECK(stats.region_cnt == 2);
+	UT_CHECK(stats.entry_cnt == 2 * STATS_CHUNK_CNT);
+	UT_CHECK(!stats.hugepage_cnt && !stats.hugepage_miss);
+
+	for (i = 0; i < STATS_CHUNK_CNT + 1; i++)
+		ofi_buf_free(bufs[i]);
+	ofi_bufpool_get_stats(pool, &stats);
+	UT_CHECK(stats.entry_cnt == 2 * STATS_CHUNK_CNT);
+
+	ofi_bufpool_destroy(pool);
+	return 0;
+}
+
+/* Huge page sizes the pool would try for a region, largest first */
+static size_t hugepage_tries(size_t alloc_size)
+{
+	size_t i, cnt = 0;
+
+	for (i = OFI_DEF_HUGEPAGE_SIZE; i < num_page_sizes; i++)
+		cnt += page_sizes[i] <= alloc_size;
+	return cnt;
+}
+
+static int hugepage_check(size_t size, size_t chunk_cnt)
+{
+	struct ofi_bufpool_attr attr = {
+		.size		= size,
+		.alignment	= 64,
+		.chunk_cnt	= chunk_cnt,
+		.flags		= OFI_BUFPOOL_HUGEPAGES,
+	};
+	struct ofi_bufpool *pool;
+	struct ofi_bufpool_stats stats;
+	size_t tries, i;
+	void *buf;
+
+	UT_CHECK(!ofi_bufpool_create_attr(&attr, &pool));
+	tries = hugepage_tries(pool->alloc_size);
+
+	buf = ofi_buf_alloc(pool);
+	UT_CHECK(buf);
+	ofi_bufpool_get_stats(pool, &stats);
+	UT_CHECK(stats.region_cnt == 1);
+	if (stats.hugepage_cnt) {
+		/* The region is rounded up to the page size that worked */
+		UT_CHECK(stats.hugepage_miss < tries);
+		for (i = OFI_DEF_HUGEPAGE_SIZE; i < num_page_sizes; i++) {
+			if (!(pool->alloc_size % page_sizes[i]))
+				break;
+		}
+		UT_CHECK(i < num_page_sizes);
+	} else {
+		/* Each size is tried once, then the pool stops trying */
+		UT_CHECK(stats.hugepage_miss == tries);
+		UT_CHECK(ofi_bufpool_grow(pool) == 0);
+		ofi_bufpool_get_stats(pool, &stats);
+		UT_CHECK(stats.region_cnt == 2);
+		UT_CHECK(stats.hugepage_miss == tries);
+	}
+
+	ofi_buf_free(buf);
+	ofi_bufpool_destroy(pool);
+	return 0;
+}
+
+/*
+ * A region smaller than any huge page skips huge pages without counting
+ * a miss.  A larger one is either backed by huge pages or counts one miss
+ * per page size that fit.
+ */
+int test_bufpool_hugepage(void)
+{
+	UT_CHECK(!hugepage_check(64, 16));
+	UT_CHECK(!hugepage_check(64 * 1024, 64));
+	return 0;
+}
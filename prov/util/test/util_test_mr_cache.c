@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <ofi_mr.h>
+#include <ofi_util.h>
+#include "util_unit_test.h"
+
+enum {
+	STATS_SLEEP_MS	= 1500,
+	STATS_CPU_MS	= 300,
+};
+
+static struct fi_provider test_prov = {
+	.name = "util_unit_test",
+};
+
+static int test_monitor_start(struct ofi_mem_monitor *monitor)
+{
+	return 0;
+}
+
+static void test_monitor_stop(struct ofi_mem_monitor *monitor)
+{
+}
+
+static int test_add_region(struct ofi_mr_cache *cache,
+			   struct ofi_mr_entry *entry)
+{
+	return 0;
+}
+
+static void test_delete_region(struct ofi_mr_cache *cache,
+			       struct ofi_mr_entry *entry)
+{
+}
+
+static uint64_t cpu_time_ms(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+	       (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+
+/*
+ * With periodic stats on, the cache thread must sleep between dumps
+ * rather than spin on mm_lock.
+ */
+int test_mr_cache_stats_sleep(void)
+{
+	struct ofi_mem_monitor monitor = {
+		.iface = FI_HMEM_SYSTEM,
+		.init = ofi_monitor_init,
+		.cleanup = ofi_monitor_cleanup,
+		.start = test_monitor_start,
+		.stop = test_monitor_stop,
+	};
+	struct ofi_mem_monitor *monitors[OFI_HMEM_MAX] = { &monitor };
+	struct ofi_mr_cache_params saved = cache_params;
+	struct util_domain domain = {
+		.prov = &test_prov,
+	};
+	struct ofi_mr_cache cache = {
+		.add_region = test_add_region,
+		.delete_region = test_delete_region,
+	};
+	char dir[] = "/tmp/ofi_ut_XXXXXX";
+	char file[64], path[128];
+	uint64_t cpu;
+	int ret;
+
+	UT_CHECK(mkdtemp(dir));
+	snprintf(file, sizeof(file), "%s/stats", dir);
+	monitor.init(&monitor);
+	ofi_atomic_initialize32(&domain.ref, 0);
+
+	cache_params.max_cnt = 16;
+	cache_params.max_size = 1 << 20;
+	cache_params.reclaim = 0;
+	cache_params.stats_file = file;
+	cache_params.stats_interval = 1;
+
+	ret = ofi_mr_cache_init(&domain, monitors, &cache);
+	if (!ret) {
+		cpu = cpu_time_ms();
+		usleep(STATS_SLEEP_MS * 1000);
+		cpu = cpu_time_ms() - cpu;
+		ofi_mr_cache_cleanup(&cache);
+	}
+	monitor.cleanup(&monitor);
+	cache_params = saved;
+
+	snprintf(path, sizeof(path), "%s.%d.%" PRIu64, file, getpid(),
+		 cache.id);
+	unlink(path);
+	rmdir(dir);
+
+	UT_CHECK(!ret);
+	UT_CHECK(cpu < STATS_CPU_MS);
+	return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Intel Corporation.  All rights reserved.
+ *
+ * This software is available to you under the BSD license
+ * below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ * Unit tests for the utility code shared by the providers.  They use
+ * internal interfaces, so the program links libfabric statically.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ofi_mem.h>
+#include "util_unit_test.h"
+
+static struct {
+	const char *name;
+	int (*run)(void);
+} tests[] = {
+	{ "bufpool_stats", test_bufpool_stats },
+	{ "bufpool_hugepage", test_bufpool_hugepage },
+	{ "bufpool_tcache", test_bufpool_tcache },
+	{ "mr_cache_stats_sleep", test_mr_cache_stats_sleep },
+};
+
+int main(int argc, char **argv)
+{
+	size_t i;
+	int ret, failed = 0;
+
+	ofi_mem_init();
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (argc > 1 && strcmp(argv[1], tests[i].name))
+			continue;
+
+		ret = tests[i].run();
+		printf("%-24s %s\n", tests[i].name, ret ? "FAIL" : "PASS");
+		failed |= ret;
+	}
+	ofi_mem_fini();
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -350,7 +350,7 @@ int vrb_cq_trywait(struct vrb_cq *cq)
 	}
 
 	ofi_genlock_lock(vrb_cq2_progress(cq)->active_lock);
-	if (!ofi_cirque_isempty(cq->util_cq.cirq)) {
+	if (!ofi_cq_isempty(&cq->util_cq)) {
 		ret = -FI_EAGAIN;
 		goto out;
 	}
@@ -367,7 +367,7 @@ int vrb_cq_trywait(struct vrb_cq *cq)
 
 	/* Fetch any completions that we might have missed while rearming */
 	vrb_flush_cq(cq);
-	ret = ofi_cirque_isempty(cq->util_cq.cirq) ? FI_SUCCESS : -FI_EAGAIN;
+	ret = ofi_cq_isempty(&cq->util_cq) ? FI_SUCCESS : -FI_EAGAIN;
 
 out:
 	ofi_genlock_unlock(vrb_cq2_progress(cq)->active_lock);
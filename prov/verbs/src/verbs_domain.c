@@ -270,11 +270,29 @@ static int vrb_open_device_by_name(struct vrb_domain *domain, const char *name)
 	return ret;
 }
 
+static int vrb_domain_control(struct fid *fid, int command, void *arg)
+{
+	struct vrb_domain *domain;
+
+	domain = container_of(fid, struct vrb_domain,
+			      util_domain.domain_fid.fid);
+
+	switch (command) {
+	case FI_MR_CACHE_STATS:
+		/* The cache has no domain if its initialization failed */
+		if (!domain->cache.domain)
+			return -FI_ENOSYS;
+		return ofi_mr_cache_get_stats(&domain->cache, arg);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
 static struct fi_ops vrb_fid_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = vrb_domain_close,
 	.bind = vrb_domain_bind,
-	.control = fi_no_control,
+	.control = vrb_domain_control,
 	.ops_open = vrb_domain_ops_open,
 };
 
@@ -367,6 +385,7 @@ vrb_domain(struct fid_fabric *fabric, struct fi_info *info,
 	_domain->cache.entry_data_size = sizeof(struct vrb_mem_desc);
 	_domain->cache.add_region = vrb_mr_cache_add_region;
 	_domain->cache.delete_region = vrb_mr_cache_delete_region;
+	_domain->cache.delete_region_mt = true;
 	ret = ofi_mr_cache_init(&_domain->util_domain, memory_monitors,
 				&_domain->cache);
 	if (ret) {
@@ -86,6 +86,8 @@ struct ofi_common_locks common_locks = {
 
 size_t ofi_universe_size = 1024;
 int ofi_av_remove_cleanup;
+int ofi_cq_lockless;
+int ofi_srx_tag_index;
 char *ofi_offload_coll_prov_name = NULL;
 
 
@@ -1191,6 +1193,8 @@ int ofi_bsock_send(struct ofi_bsock *bsock, const void *buf, size_t *len)
 			bsock->async_index++;
 			*len = ret;
 			return -OFI_EINPROGRESS_ASYNC;
+		} else if (ret == -OFI_EINPROGRESS_URING) {
+			bsock->async_index++;
 		}
 	} else {
 		ret = bsock->sockapi->send(bsock->sockapi, bsock->sock, buf, *len,
@@ -1251,6 +1255,8 @@ int ofi_bsock_sendv(struct ofi_bsock *bsock, const struct iovec *iov,
 			bsock->async_index++;
 			*len = ret;
 			return -OFI_EINPROGRESS_ASYNC;
+		} else if (ret == -OFI_EINPROGRESS_URING) {
+			bsock->async_index++;
 		}
 	} else {
 		ret = bsock->sockapi->sendv(bsock->sockapi, bsock->sock, iov, cnt,
@@ -1273,11 +1279,80 @@ int ofi_bsock_sendv(struct ofi_bsock *bsock, const struct iovec *iov,
 	return 0;
 }
 
+void ofi_bsock_recv_buf_done(struct ofi_bsock *bsock, int res, uint32_t flags)
+{
+	struct ofi_uring_buf *buf;
+
+	assert(bsock->bufring);
+	if (flags & IORING_CQE_F_BUFFER) {
+		assert(res > 0);
+		buf = &bsock->bufring->bufs[flags >> IORING_CQE_BUFFER_SHIFT];
+		buf->offset = 0;
+		buf->len = (uint32_t) res;
+		bsock->bufring->avail--;
+		slist_insert_tail(&buf->entry, &bsock->rx_bufs);
+		bsock->rx_buf_bytes += res;
+	} else if (!res) {
+		bsock->rx_buf_status = -FI_ENOTCONN;
+	} else if (res != -FI_ENOBUFS && res != -FI_ECANCELED) {
+		bsock->rx_buf_status = res;
+	}
+}
+
+void ofi_bsock_discard_bufs(struct ofi_bsock *bsock)
+{
+	struct ofi_uring_buf *buf;
+
+	while (!slist_empty(&bsock->rx_bufs)) {
+		buf = container_of(slist_remove_head(&bsock->rx_bufs),
+				   struct ofi_uring_buf, entry);
+		ofi_uring_bufring_put(bsock->bufring, buf);
+	}
+	bsock->rx_buf_bytes = 0;
+}
+
+/* Data is copied directly out of the provided buffers, bypassing the
+ * prefetch queue.  Buffers are returned to the ring once consumed.
+ */
+static int ofi_bsock_recv_bufs(struct ofi_bsock *bsock, struct iovec *iov,
+			       size_t cnt, size_t *len)
+{
+	struct ofi_uring_buf *buf;
+	size_t total, bytes, copied = 0;
+
+	total = ofi_total_iov_len(iov, cnt);
+	while (copied < total && !slist_empty(&bsock->rx_bufs)) {
+		buf = container_of(bsock->rx_bufs.head, struct ofi_uring_buf,
+				   entry);
+		bytes = ofi_copy_to_iov(iov, cnt, copied,
+					ofi_uring_buf_data(bsock->bufring, buf),
+					MIN(buf->len - buf->offset,
+					    total - copied));
+		copied += bytes;
+		buf->offset += (uint32_t) bytes;
+		bsock->rx_buf_bytes -= bytes;
+		if (buf->offset == buf->len) {
+			slist_remove_head(&bsock->rx_bufs);
+			ofi_uring_bufring_put(bsock->bufring, buf);
+		}
+	}
+
+	*len = copied;
+	return copied ? 0 : bsock->rx_buf_status;
+}
+
 int ofi_bsock_recv(struct ofi_bsock *bsock, void *buf, size_t *len)
 {
+	struct iovec iov;
 	size_t bytes, avail = 0;
 	ssize_t ret;
 
+	if (bsock->bufring) {
+		iov.iov_base = buf;
+		iov.iov_len = *len;
+		return ofi_bsock_recv_bufs(bsock, &iov, 1, len);
+	}
+
 	bytes = ofi_byteq_read(&bsock->rq, buf, *len);
 	if (bytes) {
 		if (bytes == *len) {
@@ -1331,6 +1406,9 @@ int ofi_bsock_recvv(struct ofi_bsock *bsock, struct iovec *iov, size_t cnt,
 	size_t bytes, avail = 0;
 	ssize_t ret;
 
+	if (bsock->bufring)
+		return ofi_bsock_recv_bufs(bsock, iov, cnt, len);
+
 	if (cnt == 1) {
 		*len = iov[0].iov_len;
 		return ofi_bsock_recv(bsock, iov[0].iov_base, len);
@@ -50,6 +50,7 @@
 #include "ofi_prov.h"
 #include "ofi_perf.h"
 #include "ofi_hmem.h"
+#include "ofi_atomic.h"
 #include <ofi_shm_p2p.h>
 #include <rdma/fi_ext.h>
 
@@ -844,6 +845,7 @@ void fi_ini(void)
 	ofi_osd_init();
 	ofi_mem_init();
 	ofi_pmem_init();
+	ofi_reduce_init();
 	ofi_perf_init();
 	ofi_hook_init();
 	ofi_hmem_init();
@@ -878,6 +880,20 @@ void fi_ini(void)
 			"(default: false)");
 	fi_param_get_bool(NULL, "av_remove_cleanup", &ofi_av_remove_cleanup);
 
+	fi_param_define(NULL, "cq_lockless", FI_PARAM_BOOL,
+			"Store completions of thread safe CQs in a lock-free "
+			"ring, so that multiple threads can write and read "
+			"completions concurrently.  Only applies to providers "
+			"that use the utility CQ.  (default: false)");
+	fi_param_get_bool(NULL, "cq_lockless", &ofi_cq_lockless);
+
+	fi_param_define(NULL, "srx_tag_index", FI_PARAM_BOOL,
+			"Index posted receives and unexpected messages of the "
+			"utility shared receive context by tag, so that exact "
+			"tag matches do not walk the full queues.  Only applies "
+			"to providers that use the utility SRX.  (default: false)");
+	fi_param_get_bool(NULL, "srx_tag_index", &ofi_srx_tag_index);
+
 	fi_param_define(NULL, "offload_coll_provider", FI_PARAM_STRING,
 			"The name of a colective offload provider (default: \
 			empty - no provider)");
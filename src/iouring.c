@@ -99,6 +99,13 @@ ssize_t ofi_sockapi_send_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 	if (!sqe)
 		return -FI_EOVERFLOW;
 
+#ifdef HAVE_LIBURING_SEND_ZC
+	if (flags & OFI_ZEROCOPY) {
+		io_uring_prep_send_zc(sqe, sock, buf, len,
+				      flags & ~OFI_ZEROCOPY, 0);
+		ctx->uring_sqe_zc = true;
+	} else
+#endif
 	io_uring_prep_send(sqe, sock, buf, len, flags);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
@@ -124,6 +131,17 @@ ssize_t ofi_sockapi_sendv_uring(struct ofi_sockapi *sockapi, SOCKET sock,
 	if (!sqe)
 		return -FI_EOVERFLOW;
 
+#ifdef HAVE_LIBURING_SEND_ZC
+	if (flags & OFI_ZEROCOPY) {
+		/* The msghdr must remain valid until the SQE is submitted */
+		memset(&ctx->msg, 0, sizeof(ctx->msg));
+		ctx->msg.msg_iov = (struct iovec *) iov;
+		ctx->msg.msg_iovlen = cnt;
+		io_uring_prep_sendmsg_zc(sqe, sock, &ctx->msg,
+					 flags & ~OFI_ZEROCOPY);
+		ctx->uring_sqe_zc = true;
+	} else
+#endif
 	io_uring_prep_writev(sqe, sock, iov, cnt, flags);
 	io_uring_sqe_set_data(sqe, ctx);
 	ctx->uring_sqe_inuse = true;
@@ -221,6 +239,95 @@ int ofi_sockctx_uring_poll_add(struct ofi_sockapi_uring *uring,
 	return -OFI_EINPROGRESS_URING;
 }
 
+#ifdef HAVE_LIBURING_BUF_RING
+int ofi_sockctx_uring_recv_multishot(struct ofi_sockapi_uring *uring,
+				     SOCKET sock,
+				     struct ofi_uring_bufring *bufring,
+				     struct ofi_sockctx *ctx)
+{
+	struct io_uring_sqe *sqe;
+
+	if (ctx->uring_sqe_inuse || uring->credits == 0)
+		return -FI_EAGAIN;
+
+	sqe = io_uring_get_sqe(uring->io_uring);
+	if (!sqe)
+		return -FI_EOVERFLOW;
+
+	io_uring_prep_recv_multishot(sqe, sock, NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = bufring->bgid;
+	io_uring_sqe_set_data(sqe, ctx);
+	ctx->uring_sqe_inuse = true;
+	uring->credits--;
+	return -OFI_EINPROGRESS_URING;
+}
+
+void ofi_uring_bufring_put(struct ofi_uring_bufring *bufring,
+			   struct ofi_uring_buf *buf)
+{
+	uint16_t bid;
+
+	bid = ofi_uring_buf_id(bufring, buf);
+	io_uring_buf_ring_add(bufring->br, &bufring->data[bid * bufring->buf_size],
+			      (unsigned int) bufring->buf_size, bid,
+			      io_uring_buf_ring_mask(bufring->cnt), 0);
+	io_uring_buf_ring_advance(bufring->br, 1);
+	bufring->avail++;
+	assert(bufring->avail <= bufring->cnt);
+}
+
+int ofi_uring_bufring_init(ofi_io_uring_t *io_uring,
+			   struct ofi_uring_bufring *bufring,
+			   unsigned int cnt, size_t buf_size, int bgid)
+{
+	unsigned int i;
+	int ret;
+
+	/* The kernel requires a power of 2 entries, and buffer ids are 16 bits */
+	if (!cnt || (cnt & (cnt - 1)) || cnt > (1 << 15) || !buf_size)
+		return -FI_EINVAL;
+
+	bufring->bufs = calloc(cnt, sizeof(*bufring->bufs));
+	if (!bufring->bufs)
+		return -FI_ENOMEM;
+
+	bufring->data = malloc(cnt * buf_size);
+	if (!bufring->data) {
+		ret = -FI_ENOMEM;
+		goto free_bufs;
+	}
+
+	bufring->br = io_uring_setup_buf_ring(io_uring, cnt, bgid, 0, &ret);
+	if (!bufring->br)
+		goto free_data;
+
+	bufring->buf_size = buf_size;
+	bufring->cnt = cnt;
+	bufring->avail = 0;
+	bufring->bgid = bgid;
+	for (i = 0; i < cnt; i++)
+		ofi_uring_bufring_put(bufring, &bufring->bufs[i]);
+	return 0;
+
+free_data:
+	free(bufring->data);
+free_bufs:
+	free(bufring->bufs);
+	return ret;
+}
+
+void ofi_uring_bufring_destroy(ofi_io_uring_t *io_uring,
+			       struct ofi_uring_bufring *bufring)
+{
+	assert(bufring->avail == bufring->cnt);
+	io_uring_free_buf_ring(io_uring, bufring->br, bufring->cnt,
+			       bufring->bgid);
+	free(bufring->data);
+	free(bufring->bufs);
+}
+#endif
+
 int ofi_uring_init(ofi_io_uring_t *io_uring, size_t entries)
 {
 	struct io_uring_params params;
@@ -243,6 +350,25 @@ int ofi_uring_init(ofi_io_uring_t *io_uring, size_t entries)
 	return 0;
 }
 
+bool ofi_uring_send_zc_supported(ofi_io_uring_t *io_uring)
+{
+#ifdef HAVE_LIBURING_SEND_ZC
+	struct io_uring_probe *probe;
+	bool ret;
+
+	probe = io_uring_get_probe_ring(io_uring);
+	if (!probe)
+		return false;
+
+	ret = io_uring_opcode_supported(probe, IORING_OP_SEND_ZC) &&
+	      io_uring_opcode_supported(probe, IORING_OP_SENDMSG_ZC);
+	io_uring_free_probe(probe);
+	return ret;
+#else
+	return false;
+#endif
+}
+
 int ofi_uring_destroy(ofi_io_uring_t *io_uring)
 {
 	if (io_uring_sq_ready(io_uring) || io_uring_cq_ready(io_uring))
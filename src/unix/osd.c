@@ -110,15 +110,19 @@ int fi_fd_block(int fd)
 
 int ofi_wait_cond(pthread_cond_t *cond, pthread_mutex_t *mut, int timeout_ms)
 {
-	uint64_t t;
 	struct timespec ts;
 
 	if (timeout_ms < 0)
 		return pthread_cond_wait(cond, mut);
 
-	t = ofi_gettime_ms() + timeout_ms;
-	ts.tv_sec = t / 1000;
-	ts.tv_nsec = (t % 1000) * 1000000;
+	/* Conditions use the default clock, which is CLOCK_REALTIME */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout_ms / 1000;
+	ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
 	return pthread_cond_timedwait(cond, mut, &ts);
 }
 